@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "alloc_stats.hpp"
+#include "env.hpp"
+#include "eval.hpp"
+#include "lexical.hpp"
+#include "lisp.hpp"
+
+// vendor
+#include "cxxopts.hpp"
+
+namespace austlisp {
+
+// 一个 workload：先跑 setup，再把 op 重复执行 iterations 次计时
+struct Workload {
+    const char* name;
+    std::vector<std::string> setup;
+    std::string op;
+    size_t iterations;
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+    size_t peak_rss_kb;
+    double mb_per_s; // 只有 tokenize 有意义，其他为 0
+};
+
+static Token run_line(Eval& e, const std::string& line) {
+    Tokenize tokenize(line);
+    size_t t = 0;
+    auto ast = e.compile(tokenize.tokens_list, t);
+    auto res = e.eval(ast);
+    e.clear_status();
+    return res;
+}
+
+static std::string number_list(size_t n) {
+    std::string s = "'(";
+    for (size_t i = 1; i <= n; ++i) {
+        s += std::to_string(i);
+        s += i == n ? ")" : " ";
+    }
+    return s;
+}
+
+static std::vector<Workload> workloads() {
+    return {
+        {"fib",
+            {"(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))"},
+            "(fib 15)",
+            20},
+        {"tak",
+            {"(define tak (lambda (x y z) (if (< y x) (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y)) z)))"},
+            "(tak 12 8 4)",
+            20},
+        {"while_loop",
+            {"(define spin (lambda (n) (while (< n 10000) (setq n (+ n 1)))))"},
+            "(spin 0)",
+            20},
+        {"list_build",
+            {},
+            "(cdr " + number_list(200) + ")",
+            2000},
+        {"list_walk",
+            {"(define lst " + number_list(200) + ")",
+                "(define walk (lambda (l n acc) (if (< n 1) acc (walk (cdr l) (- n 1) (+ acc (car l))))))"},
+            "(walk lst 200 0)",
+            50},
+        // 比 JitFunction::MAX_DEPTH 深的递归，机器码会放弃，交给解释器
+        {"deep_recursion",
+            {"(define dsum (lambda (n) (if (< n 1) 0 (+ n (dsum (- n 1))))))"},
+            "(dsum 3000)",
+            20},
+        {"string_concat",
+            {"(define cat (lambda (s n) (if (< n 1) s (cat (+ s \"xxxxxxxx\") (- n 1)))))"},
+            "(cat \"\" 200)",
+            100},
+    };
+}
+
+template <typename F>
+static BenchResult measure(const std::string& name, size_t iterations, F&& op) {
+    op(); // 预热
+    alloc_stats_reset_peak();
+    auto before = alloc_stats();
+    auto start  = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        op();
+    }
+    auto stop  = std::chrono::steady_clock::now();
+    auto after = alloc_stats();
+    double ns  = std::chrono::duration<double, std::nano>(stop - start).count();
+    return BenchResult{name, iterations, ns / iterations, double(after.allocs - before.allocs) / iterations,
+        double(after.bytes - before.bytes) / iterations, peak_rss_kb(), 0.0};
+}
+
+static BenchResult run_workload(const Workload& w, double scale) {
+    auto env = std::make_unique<Env>();
+    Eval e(env.get());
+    for (const auto& line : w.setup) {
+        run_line(e, line);
+    }
+    size_t iterations = std::max<size_t>(1, size_t(w.iterations * scale));
+    return measure(w.name, iterations, [&] { run_line(e, w.op); });
+}
+
+// 生成一份大源文件，逐行分词，衡量 Tokenize 的吞吐
+static BenchResult run_tokenize(double scale) {
+    std::vector<std::string> lines;
+    size_t total = 0;
+    for (size_t i = 0; total < 4 * 1024 * 1024; ++i) {
+        std::string line = "(define item_" + std::to_string(i) + " (lambda (x y) (if (< x y) (+ x " + std::to_string(i)
+                         + ".5) (* y \"str_" + std::to_string(i) + "\"))))";
+        total += line.size() + 1;
+        lines.emplace_back(std::move(line));
+    }
+    size_t passes = std::max<size_t>(1, size_t(3 * scale));
+    size_t cursor = 0;
+    auto res      = measure("tokenize", passes * lines.size(), [&] {
+        Tokenize tokenize(lines[cursor++ % lines.size()]);
+    });
+    res.mb_per_s  = (double(total) / lines.size()) / res.ns_per_op * 1e9 / (1024 * 1024);
+    return res;
+}
+
+static void write_json(std::ostream& os, const std::vector<BenchResult>& results) {
+    os << "{\n  \"version\": \"0.1\",\n  \"workloads\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op
+           << ", \"allocs_per_op\": " << r.allocs_per_op << ", \"bytes_per_op\": " << r.bytes_per_op
+           << ", \"peak_rss_kb\": " << r.peak_rss_kb;
+        if (r.mb_per_s > 0) {
+            os << ", \"mb_per_s\": " << r.mb_per_s;
+        }
+        os << (i + 1 == results.size() ? "}\n" : "},\n");
+    }
+    os << "  ],\n  \"peak_rss_kb\": " << peak_rss_kb() << "\n}\n";
+}
+
+} // namespace austlisp
+
+int main(int argc, const char* argv[]) {
+    cxxopts::Options options("austlisp_bench", "austlisp benchmark suite, prints JSON");
+
+    options.add_options()("w,workload", "only run these workloads", cxxopts::value<std::vector<std::string>>())(
+        "s,scale", "multiply iteration counts", cxxopts::value<double>()->default_value("1.0"))(
+        "o,output", "write JSON to file instead of stdout", cxxopts::value<std::string>())(
+        "O,opt", "optimization level 0-2", cxxopts::value<int>()->default_value("2"))("h,help", "Print usage");
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::vector<std::string> only;
+    if (result.count("workload")) {
+        only = result["workload"].as<std::vector<std::string>>();
+    }
+    auto selected = [&](const std::string& name) {
+        return only.empty() || std::find(only.begin(), only.end(), name) != only.end();
+    };
+    double scale = result["scale"].as<double>();
+    austlisp::Eval::set_opt_level(result["opt"].as<int>());
+
+    std::vector<austlisp::BenchResult> results;
+    for (const auto& w : austlisp::workloads()) {
+        if (selected(w.name)) {
+            results.emplace_back(austlisp::run_workload(w, scale));
+        }
+    }
+    if (selected("tokenize")) {
+        results.emplace_back(austlisp::run_tokenize(scale));
+    }
+
+    if (result.count("output")) {
+        std::ofstream out(result["output"].as<std::string>());
+        austlisp::write_json(out, results);
+    } else {
+        austlisp::write_json(std::cout, results);
+    }
+    return 0;
+}
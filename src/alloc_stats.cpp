@@ -0,0 +1,252 @@
+#include "alloc_stats.hpp"
+
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace austlisp {
+
+namespace {
+
+// 每个线程一个槽位，只有本线程写，自增不需要加锁前缀，读的时候把所有槽位加起来。
+// live_bytes 先攒在槽位的 pending 里，攒够 _FLUSH_BYTES 才合并到全局的 _live 并更新峰值，
+// 这样共享的原子变量每分配/释放几十 KB 才碰一次，峰值的误差不超过 线程数 * _FLUSH_BYTES。
+// thread_local 只存一个指针(平凡类型，没有初始化守卫)，在 operator new 里用是安全的。
+struct alignas(64) Slot {
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<int64_t> pending{0};
+};
+
+constexpr size_t _MAX_SLOTS    = 256;
+constexpr int64_t _FLUSH_BYTES = 64 * 1024;
+
+Slot _slots[_MAX_SLOTS];
+Slot _overflow; // 槽位用完之后的线程共用这个，只能老老实实用 fetch_add
+std::atomic<size_t> _next_slot{0};
+std::atomic<int64_t> _live{0};
+std::atomic<int64_t> _peak{0};
+thread_local Slot* _slot           = nullptr;
+thread_local uint64_t _thread_allocs = 0;
+thread_local int64_t _thread_live    = 0;
+thread_local int64_t _thread_limit   = INT64_MAX;
+thread_local void (*_on_exceeded)()  = nullptr;
+
+Slot* _local() noexcept {
+    if (_slot == nullptr) {
+        size_t index = _next_slot.fetch_add(1, std::memory_order_relaxed);
+        _slot        = index < _MAX_SLOTS ? &_slots[index] : &_overflow;
+    }
+    return _slot;
+}
+
+template <typename T>
+void _bump(Slot* slot, std::atomic<T>& counter, T n) noexcept {
+    if (slot == &_overflow) {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    } else {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+}
+
+void _flush_live(int64_t delta) noexcept {
+    int64_t live = _live.fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t peak = _peak.load(std::memory_order_relaxed);
+    while (live > peak && !_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void _on_live(Slot* slot, int64_t delta) noexcept {
+    if (slot == &_overflow) {
+        _flush_live(delta);
+        return;
+    }
+    int64_t pending = slot->pending.load(std::memory_order_relaxed) + delta;
+    if (pending >= _FLUSH_BYTES || pending <= -_FLUSH_BYTES) {
+        slot->pending.store(0, std::memory_order_relaxed);
+        _flush_live(pending);
+    } else {
+        slot->pending.store(pending, std::memory_order_relaxed);
+    }
+}
+
+void _on_alloc(void* p) noexcept {
+    // 用 malloc_usable_size 而不是请求的大小，这样释放时不需要知道大小也能对上
+    size_t size = malloc_usable_size(p);
+    Slot* slot  = _local();
+    _thread_allocs++;
+    _thread_live += int64_t(size);
+    _bump<uint64_t>(slot, slot->allocs, 1);
+    _bump<uint64_t>(slot, slot->bytes, size);
+    _on_live(slot, static_cast<int64_t>(size));
+}
+
+void _on_free(void* p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    Slot* slot  = _local();
+    size_t size = malloc_usable_size(p);
+    _thread_live -= int64_t(size);
+    _bump<uint64_t>(slot, slot->frees, 1);
+    _on_live(slot, -static_cast<int64_t>(size));
+}
+
+int64_t _current_live() noexcept {
+    int64_t live = _live.load(std::memory_order_relaxed);
+    for (auto& slot : _slots) {
+        live += slot.pending.load(std::memory_order_relaxed);
+    }
+    return live < 0 ? 0 : live; // 跨线程释放时单个槽位可能是负的，总和正常不会
+}
+
+// 在 malloc 之前看，make-bytevector 这种一次要很多的根本不会真的分配
+void _check_limit(size_t size) {
+    if (_thread_live + int64_t(std::min<size_t>(size, INT64_MAX / 2)) > _thread_limit) [[unlikely]] {
+        _thread_limit = INT64_MAX;
+        _on_exceeded();
+    }
+}
+
+void* _alloc(size_t size) {
+    _check_limit(size);
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    _on_alloc(p);
+    return p;
+}
+
+void* _alloc_aligned(size_t size, std::align_val_t align) {
+    size_t a    = static_cast<size_t>(align);
+    _check_limit(size);
+    size_t need = (size + a - 1) / a * a; // aligned_alloc 要求大小是对齐的整数倍
+    void* p     = std::aligned_alloc(a, need == 0 ? a : need);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    _on_alloc(p);
+    return p;
+}
+
+void _free(void* p) noexcept {
+    _on_free(p);
+    std::free(p);
+}
+
+} // namespace
+
+AllocStats alloc_stats() noexcept {
+    AllocStats stats{};
+    auto add = [&stats](const Slot& slot) {
+        stats.allocs += slot.allocs.load(std::memory_order_relaxed);
+        stats.frees += slot.frees.load(std::memory_order_relaxed);
+        stats.bytes += slot.bytes.load(std::memory_order_relaxed);
+    };
+    for (auto& slot : _slots) {
+        add(slot);
+    }
+    add(_overflow);
+    auto live        = _current_live();
+    stats.live_bytes = live;
+    stats.peak_bytes = std::max(live, _peak.load(std::memory_order_relaxed));
+    return stats;
+}
+
+uint64_t thread_alloc_count() noexcept {
+    return _thread_allocs;
+}
+
+int64_t thread_live_bytes() noexcept {
+    return _thread_live;
+}
+
+void set_thread_heap_limit(int64_t limit, void (*on_exceeded)()) noexcept {
+    _thread_limit = on_exceeded != nullptr ? limit : INT64_MAX;
+    _on_exceeded  = on_exceeded;
+}
+
+void alloc_stats_reset_peak() noexcept {
+    _peak.store(_current_live(), std::memory_order_relaxed);
+}
+
+size_t current_rss_kb() noexcept {
+    FILE* f = std::fopen("/proc/self/statm", "r");
+    if (f == nullptr) {
+        return 0;
+    }
+    long pages = 0, resident = 0;
+    if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    std::fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+size_t peak_rss_kb() noexcept {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // linux 上单位是 KB
+}
+
+} // namespace austlisp
+
+// 替换全局的 operator new/delete
+void* operator new(size_t size) {
+    return austlisp::_alloc(size);
+}
+void* operator new[](size_t size) {
+    return austlisp::_alloc(size);
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return austlisp::_alloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return austlisp::_alloc(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new(size_t size, std::align_val_t align) {
+    return austlisp::_alloc_aligned(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align) {
+    return austlisp::_alloc_aligned(size, align);
+}
+void operator delete(void* p) noexcept {
+    austlisp::_free(p);
+}
+void operator delete[](void* p) noexcept {
+    austlisp::_free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    austlisp::_free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    austlisp::_free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+    austlisp::_free(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept {
+    austlisp::_free(p);
+}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    austlisp::_free(p);
+}
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    austlisp::_free(p);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef _ALLOC_STATS_HPP_
+#define _ALLOC_STATS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  全局 operator new/delete 的计数，链接了 alloc_stats.cpp 的程序都会统计。
+ *  计数按线程分开存，只有本线程写，读的时候再加起来；live_bytes/peak_bytes 按 64 KB 一批合并，
+ *  峰值可能比真实值低一点(每个线程最多 64 KB)。
+ */
+struct AllocStats {
+    uint64_t allocs; // 分配次数
+    uint64_t frees; // 释放次数
+    uint64_t bytes; // 累计分配的字节数
+    uint64_t live_bytes; // 当前还没释放的字节数
+    uint64_t peak_bytes; // live_bytes 的峰值
+};
+
+AllocStats alloc_stats() noexcept;
+uint64_t thread_alloc_count() noexcept; // 当前线程的分配次数，profiler 按线程归属用
+int64_t thread_live_bytes() noexcept; // 当前线程分配减去当前线程释放的字节数，求值的内存限制用
+void alloc_stats_reset_peak() noexcept; // 把峰值重置为当前值，方便分段统计
+// 当前线程的 thread_live_bytes() 要超过 limit 时，在真正分配之前调 on_exceeded，由它抛异常。
+// 调之前先把限制撤掉，报错路径上还能分配；INT64_MAX 表示不限
+void set_thread_heap_limit(int64_t limit, void (*on_exceeded)()) noexcept;
+
+size_t current_rss_kb() noexcept;
+size_t peak_rss_kb() noexcept;
+
+} // namespace austlisp
+
+#endif
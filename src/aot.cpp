@@ -0,0 +1,455 @@
+#include "aot.hpp"
+
+#include <unistd.h>
+
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "budget.hpp"
+#include "eval.hpp"
+#include "loader.hpp"
+#include "output.hpp"
+
+namespace austlisp {
+
+namespace {
+
+char _type_char(JitType type) {
+    switch (type) {
+    case JitType::INT:
+        return 'i';
+    case JitType::DBL:
+        return 'd';
+    case JitType::BOOL:
+        return 'b';
+    default:
+        return 'n';
+    }
+}
+
+JitType _char_type(char c) {
+    switch (c) {
+    case 'i':
+        return JitType::INT;
+    case 'd':
+        return JitType::DBL;
+    case 'b':
+        return JitType::BOOL;
+    default:
+        return JitType::NONE;
+    }
+}
+
+// C++ 字符串字面量，控制字符和引号转义，UTF-8 原样保留
+std::string _quote(std::string_view text) {
+    std::string out = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += char(c);
+        } else if (c < 0x20 || c == 0x7f) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\%03o", c);
+            out += buf;
+        } else {
+            out += char(c);
+        }
+    }
+    return out + "\"";
+}
+
+std::string _int_literal(int64_t v) {
+    return v == INT64_MIN ? std::string("INT64_MIN") : "int64_t(" + std::to_string(v) + ")";
+}
+
+// 有限值用十六进制浮点字面量，一位不差；inf/nan 按位模式还原
+std::string _double_literal(int64_t bits) {
+    auto v = std::bit_cast<double>(bits);
+    if (!std::isfinite(v)) {
+        return "std::bit_cast<double>(" + _int_literal(bits) + ")";
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "(%a)", v);
+    return buf;
+}
+
+/**
+ * JitExpr -> C++：和 jit.cpp 的 Emitter 一一对应，只是输出的是源码。
+ * 每个子表达式的值先存进一个新的局部变量，求值顺序和机器码完全一样(递归调用的实参从右往左)；
+ * 帧还是 int64_t 数组，浮点按位模式存，交给 C++ 编译器放进寄存器。
+ */
+class CppWriter {
+public:
+    CppWriter(std::string function, size_t nparams, size_t nslots)
+        : _function(std::move(function)), _nparams(nparams), _nslots(nslots) {}
+
+    std::string write(const JitExpr& body) {
+        _line("int64_t " + _function + "(int64_t* args, JitContext* ctx) {");
+        _indent++;
+        _line("if (++ctx->depth > JitFunction::MAX_DEPTH) {");
+        _line("    ctx->too_deep = 1;");
+        _line("    return aot_bail(ctx);");
+        _line("}");
+        if (_nslots > 0) {
+            _line("int64_t f[" + std::to_string(_nslots) + "] = {};");
+        }
+        for (size_t i = 0; i < _nparams; ++i) {
+            _line("f[" + std::to_string(i) + "] = args[" + std::to_string(i) + "];");
+        }
+        auto result = _value(body);
+        _line("--ctx->depth;");
+        _line("return " + (body.type == JitType::NONE ? std::string("0") : _to_slot(body.type, result)) + ";");
+        _indent--;
+        _line("}");
+        return std::move(_out);
+    }
+
+private:
+    // 生成求 e 的语句，返回装着结果的变量名或者字面量；没有值的返回空串
+    std::string _value(const JitExpr& e) {
+        switch (e.op) {
+        case JitExpr::CONST:
+            return e.type == JitType::INT ? _int_literal(e.value)
+                 : e.type == JitType::DBL ? _double_literal(e.value)
+                                          : std::string(e.value != 0 ? "true" : "false");
+        case JitExpr::ARG:
+            return _temp(e.type, _from_slot(e.type, "f[" + std::to_string(e.value) + "]"));
+        case JitExpr::SETQ:
+            {
+                auto v = _value(*e.kids[0]);
+                _line("f[" + std::to_string(e.value) + "] = " + _to_slot(e.kids[0]->type, v) + ";");
+                return "";
+            }
+        case JitExpr::ADD:
+        case JitExpr::SUB:
+        case JitExpr::MUL:
+        case JitExpr::DIV:
+        case JitExpr::LT:
+        case JitExpr::GT:
+            return _binary(e);
+        case JitExpr::IF:
+            {
+                auto cond = _value(*e.kids[0]);
+                std::string result;
+                if (e.type != JitType::NONE) {
+                    result = _name("t", _temps++);
+                    _line(std::string(_cpp_type(e.type)) + " " + result + ";");
+                }
+                _line("if (" + cond + ") {");
+                _branch(*e.kids[1], result);
+                _line("} else {");
+                _branch(*e.kids[2], result);
+                _line("}");
+                return result;
+            }
+        case JitExpr::WHILE:
+            {
+                _line("for (;;) {");
+                _indent++;
+                auto cond = _value(*e.kids[0]);
+                _line("if (!" + cond + ") {");
+                _line("    break;");
+                _line("}");
+                _value(*e.kids[1]);
+                _indent--;
+                _line("}");
+                return "";
+            }
+        case JitExpr::SELF_CALL:
+            return _self_call(e);
+        case JitExpr::SEQ:
+            {
+                std::string result;
+                for (const auto& kid : e.kids) {
+                    result = _value(*kid);
+                }
+                return result;
+            }
+        case JitExpr::FOR:
+            return _counted_loop(e);
+        }
+        return "";
+    }
+
+    void _branch(const JitExpr& e, const std::string& result) {
+        _indent++;
+        auto v = _value(e);
+        if (!result.empty()) {
+            _line(result + " = " + v + ";");
+        }
+        _indent--;
+    }
+
+    std::string _binary(const JitExpr& e) {
+        const auto& lhs = *e.kids[0];
+        const auto& rhs = *e.kids[1];
+        auto l = _value(lhs);
+        auto r = _value(rhs);
+        if (lhs.type == JitType::INT && rhs.type == JitType::INT) {
+            switch (e.op) {
+            case JitExpr::ADD:
+                // 和机器码一样溢出回绕
+                return _temp(JitType::INT, "int64_t(uint64_t(" + l + ") + uint64_t(" + r + "))");
+            case JitExpr::SUB:
+                return _temp(JitType::INT, "int64_t(uint64_t(" + l + ") - uint64_t(" + r + "))");
+            case JitExpr::MUL:
+                return _temp(JitType::INT, "int64_t(uint64_t(" + l + ") * uint64_t(" + r + "))");
+            case JitExpr::DIV:
+                // 除 0 和 INT64_MIN / -1 交给解释器
+                _line("if (" + r + " == 0 || (" + l + " == INT64_MIN && " + r + " == -1)) {");
+                _line("    return aot_bail(ctx);");
+                _line("}");
+                return _temp(JitType::INT, l + " / " + r);
+            case JitExpr::LT:
+                return _temp(JitType::BOOL, l + " < " + r);
+            default:
+                return _temp(JitType::BOOL, l + " > " + r);
+            }
+        }
+        // 有一边是浮点就都转成 double；NaN 比较的结果是 false，和 do_compare 一致
+        if (lhs.type == JitType::INT) {
+            l = "double(" + l + ")";
+        }
+        if (rhs.type == JitType::INT) {
+            r = "double(" + r + ")";
+        }
+        switch (e.op) {
+        case JitExpr::ADD:
+            return _temp(JitType::DBL, l + " + " + r);
+        case JitExpr::SUB:
+            return _temp(JitType::DBL, l + " - " + r);
+        case JitExpr::MUL:
+            return _temp(JitType::DBL, l + " * " + r);
+        case JitExpr::DIV:
+            return _temp(JitType::DBL, l + " / " + r);
+        case JitExpr::LT:
+            return _temp(JitType::BOOL, l + " < " + r);
+        default:
+            return _temp(JitType::BOOL, l + " > " + r);
+        }
+    }
+
+    // 计数器和终点放在 C++ 局部变量里，循环变量每轮从计数器拷一份，溢出就停
+    std::string _counted_loop(const JitExpr& e) {
+        auto from    = _value(*e.kids[0]);
+        auto to      = _value(*e.kids[1]);
+        auto counter = _name("c", _temps);
+        auto end     = _name("e", _temps++);
+        _line("for (int64_t " + counter + " = " + from + ", " + end + " = " + to + "; " + counter
+              + (e.step > 0 ? " < " : " > ") + end + ";) {");
+        _indent++;
+        _line("f[" + std::to_string(e.value) + "] = " + counter + ";");
+        _value(*e.kids[2]);
+        _line("if (__builtin_add_overflow(" + counter + ", " + _int_literal(e.step) + ", &" + counter + ")) {");
+        _line("    break;");
+        _line("}");
+        _indent--;
+        _line("}");
+        return "";
+    }
+
+    std::string _self_call(const JitExpr& e) {
+        size_t n = e.kids.size();
+        std::vector<std::string> args(n);
+        for (size_t i = n; i-- > 0;) {
+            args[i] = _to_slot(e.kids[i]->type, _value(*e.kids[i]));
+        }
+        std::string frame = "nullptr";
+        if (n > 0) {
+            frame = _name("a", _temps++);
+            std::string init;
+            for (const auto& a : args) {
+                init += (init.empty() ? "" : ", ") + a;
+            }
+            _line("int64_t " + frame + "[] = {" + init + "};");
+        }
+        auto raw = _name("r", _temps++);
+        _line("const int64_t " + raw + " = " + _function + "(" + frame + ", ctx);");
+        // 被调用的那层 deopt 了，这层也放弃
+        _line("if (ctx->deopt != 0) {");
+        _line("    return aot_bail(ctx);");
+        _line("}");
+        return e.type == JitType::NONE ? std::string() : _from_slot(e.type, raw);
+    }
+
+    // 生成的变量名。不写成 "t" + std::to_string(n)，GCC 12 对这种写法会误报 -Wrestrict
+    static std::string _name(const char* prefix, size_t n) {
+        std::string name = prefix;
+        name += std::to_string(n);
+        return name;
+    }
+
+    std::string _temp(JitType type, const std::string& init) {
+        auto name = _name("t", _temps++);
+        _line("const " + std::string(_cpp_type(type)) + " " + name + " = " + init + ";");
+        return name;
+    }
+
+    static const char* _cpp_type(JitType type) {
+        return type == JitType::INT ? "int64_t" : type == JitType::DBL ? "double" : "bool";
+    }
+    static std::string _from_slot(JitType type, const std::string& slot) {
+        return type == JitType::DBL ? "std::bit_cast<double>(" + slot + ")"
+             : type == JitType::BOOL ? "(" + slot + " != 0)"
+                                     : slot;
+    }
+    static std::string _to_slot(JitType type, const std::string& v) {
+        return type == JitType::DBL ? "std::bit_cast<int64_t>(" + v + ")"
+             : type == JitType::BOOL ? "int64_t(" + v + ")"
+                                     : v;
+    }
+
+    void _line(const std::string& text) {
+        _out.append(size_t(_indent) * 4, ' ');
+        _out += text;
+        _out += '\n';
+    }
+
+    std::string _function;
+    size_t _nparams;
+    size_t _nslots;
+    std::string _out;
+    int _indent = 0;
+    size_t _temps = 0;
+};
+
+bool _has_self_call(const JitExpr& e) {
+    if (e.op == JitExpr::SELF_CALL) {
+        return true;
+    }
+    for (const auto& kid : e.kids) {
+        if (_has_self_call(*kid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 函数名里只留字母数字，C++ 函数名前面加上序号保证不重名
+std::string _cpp_name(size_t index, const std::string& name) {
+    std::string out = "fn" + std::to_string(index) + "_";
+    for (char c : name) {
+        out += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return out;
+}
+
+void _attach(Env* env, const AotFunction& fn) {
+    auto bound = env->find(fn.name);
+    // 那一行求值失败了，或者名字绑定的不是 lambda
+    if (bound == nullptr || bound->token_type != Tokens::K_LAMBDA
+        || !std::holds_alternative<_Ptr_Lambda_t>(bound->value)) {
+        return;
+    }
+    auto func = std::get<_Ptr_Lambda_t>(bound->value).get();
+    if (func->params.size() != std::strlen(fn.sig)) {
+        return;
+    }
+    std::vector<JitType> sig;
+    for (const char* c = fn.sig; *c != '\0'; ++c) {
+        sig.emplace_back(_char_type(*c));
+    }
+    auto result = _char_type(fn.result);
+    std::lock_guard<std::mutex> lock(func->jit.m);
+    func->jit.variants.emplace_back(JitState::Variant{sig, fn.name, JitFunction::native(fn.entry, result)});
+    if (!fn.self_calls) {
+        // 没有递归，换个名字调用也是同一份代码
+        func->jit.variants.emplace_back(JitState::Variant{sig, "", JitFunction::native(fn.entry, result)});
+    }
+    // 不用再攒调用次数，第一次调用就走编译好的版本
+    func->jit.calls.store(JitState::HOT_CALLS, std::memory_order_relaxed);
+}
+
+} // namespace
+
+size_t emit_cpp(std::string_view source, const std::string& origin, std::ostream& out) {
+    // 只解析不求值：每个顶层 (define f (lambda ...)) 按参数的标注(没有标注的当成 int)翻译一份
+    Env global;
+    Eval e(&global);
+    auto lines = Loader::split_lines(source);
+    std::string functions, table;
+    size_t count = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        std::string text(lines[i]);
+        Tokenize tokenize(text);
+        size_t t = 0;
+        auto ast = e.parser(tokenize.tokens_list, t);
+        e.clear_status();
+        if (!ast || ast->t.token_type != Tokens::K_DEFINE || !ast->right
+            || ast->right->t.token_type != Tokens::K_LAMBDA) {
+            continue;
+        }
+        auto node        = static_cast<const AST_lambda*>(ast->right.get());
+        const auto& name = *std::get<_Ptr_Str_t>(ast->left->t.value);
+        Lambda func(List(*std::get<std::unique_ptr<List>>(node->left->t.value)),
+            List(*std::get<std::unique_ptr<List>>(node->right->t.value)));
+        func.param_types = node->param_types;
+        std::vector<JitType> sig(func.params.size(), JitType::INT);
+        std::string sig_text;
+        for (size_t p = 0; p < sig.size(); ++p) {
+            if (p < func.param_types.size() && func.param_types[p] == StaticType::DBL) {
+                sig[p] = JitType::DBL;
+            }
+            sig_text += _type_char(sig[p]);
+        }
+        size_t nslots = 0;
+        auto ir       = e.lower_lambda(&func, name, sig, nslots);
+        if (!ir) {
+            continue;
+        }
+        auto cpp_name = _cpp_name(count++, name);
+        functions += "// 第 " + std::to_string(i + 1) + " 行的 " + name + "\n";
+        functions += CppWriter(cpp_name, sig.size(), nslots).write(*ir) + "\n";
+        table += "    {" + _quote(name) + ", " + std::to_string(i) + ", " + _quote(sig_text) + ", '"
+               + _type_char(ir->type) + "', " + (_has_self_call(*ir) ? "true" : "false") + ", " + cpp_name + "},\n";
+    }
+
+    out << "// 由 austlisp --emit-cpp " << origin << " 生成，不要手改\n";
+    out << "// 编译: c++ -std=c++20 -O2 -I<austlisp>/src 这个文件 libaustlisp_rt.a -pthread\n";
+    out << "#include <bit>\n#include <cstdint>\n#include <iterator>\n\n#include \"aot.hpp\"\n\n";
+    out << "namespace {\n\nusing austlisp::aot_bail;\nusing austlisp::JitContext;\nusing austlisp::JitFunction;\n\n";
+    out << functions;
+    // 源码按行拆成相邻的字符串字面量，编译器会拼起来
+    out << "const char source[] =";
+    if (lines.empty()) {
+        out << " \"\"";
+    }
+    for (auto line : Loader::split_lines(source)) {
+        size_t offset = size_t(line.data() - source.data());
+        bool newline  = offset + line.size() < source.size();
+        out << "\n    " << _quote(std::string(line) + (newline ? "\n" : ""));
+    }
+    out << ";\n\n";
+    if (count > 0) {
+        out << "const austlisp::AotFunction functions[] = {\n" << table << "};\n\n";
+    }
+    out << "} // namespace\n\nint main() {\n";
+    out << "    return austlisp::aot_main({std::string_view(source, sizeof(source) - 1), "
+        << (count > 0 ? "functions, std::size(functions)" : "nullptr, 0") << "});\n}\n";
+    return count;
+}
+
+int aot_main(const AotProgram& program) {
+    Output::line_buffered = isatty(STDOUT_FILENO) != 0;
+    auto global_env       = std::make_unique<Env>();
+    // 和 austlisp -f 一样在大栈上求值
+    run_with_stack(Budget::EVAL_STACK_SIZE, [&] {
+        size_t next = 0;
+        Loader::load(global_env.get(), program.source, [&](size_t line) {
+            for (; next < program.function_count && program.functions[next].line <= line; ++next) {
+                _attach(global_env.get(), program.functions[next]);
+            }
+        });
+    });
+    Output::local().flush();
+    return 0;
+}
+
+} // namespace austlisp
@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef _AOT_HPP_
+#define _AOT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "jit.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  --emit-cpp 生成的程序和运行时库之间的接口。生成的 C++ 只包含这个头文件。
+ *  脚本的源码原样编进程序里，运行时和 -f 一样逐行求值、打印结果，所以输出和解释器一致；
+ *  顶层 (define f (lambda ...)) 里能按 JIT 的规则翻译的数值函数另外生成成普通的 C++ 函数，
+ *  入口和 JitFunction 的机器码一样。定义它的那一行求值完以后挂到 lambda 上，当成已经编译好的 JIT 版本，
+ *  第一次调用就直接跑，除 0、递归太深时同样回到解释器重算。
+ */
+struct AotFunction {
+    const char* name;
+    size_t line; // 定义它的那一行，从 0 开始
+    const char* sig; // 每个参数一个字符：i 整数，d 浮点
+    char result; // i 整数，d 浮点，b 真假，n 没有值
+    bool self_calls; // 函数体里有调用自己，只有名字还绑定在这个 lambda 上时才能用
+    JitFunction::Entry entry;
+};
+
+struct AotProgram {
+    std::string_view source;
+    const AotFunction* functions;
+    size_t function_count;
+};
+
+// 生成的 main 直接调用它，返回值是进程的退出码
+int aot_main(const AotProgram& program);
+
+// 生成的函数里要放弃时调用，和机器码的 bail 一样：标记 deopt，退出这一层
+inline int64_t aot_bail(JitContext* ctx) noexcept {
+    ctx->deopt = 1;
+    --ctx->depth;
+    return 0;
+}
+
+// 把 source 翻译成一个 C++ 源文件写进 out，origin 只用在注释里；返回生成成 C++ 函数的个数
+size_t emit_cpp(std::string_view source, const std::string& origin, std::ostream& out);
+
+} // namespace austlisp
+
+#endif
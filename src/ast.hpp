@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef _AST_HPP_
+#define _AST_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lexical.hpp"
+#include "runtime_stats.hpp"
+
+namespace austlisp {
+
+// 类型推断的结果，也是参数标注 (n int) / (x double) 的类型。
+// NONE 是还没有赋过值，ANY 是推不出来，运行时照常按 token_type 分派
+enum class StaticType : uint8_t {
+    NONE,
+    INT,
+    DBL,
+    BOOL,
+    ANY,
+};
+
+/**
+ * @brief
+ *  语法树节点。求值只读不改，所以 lambda 的函数体解析一次以后可以一直复用，
+ *  pmap 的多个 worker 同时求值同一棵树也没问题。
+ */
+struct AST_base {
+    AST_base() {
+        RuntimeCounters::bump(runtime_counters.ast_nodes);
+    }
+    AST_base(Token&& _t) : t(std::move(_t)) {
+        RuntimeCounters::bump(runtime_counters.ast_nodes);
+    }
+    virtual ~AST_base() = default; // 没有什么意义，就是为了用 dynmaic_cast
+    Token t;
+    std::unique_ptr<AST_base> left;
+    std::unique_ptr<AST_base> right;
+};
+
+struct AST_if : public AST_base {
+    std::unique_ptr<AST_base> cond;
+};
+
+// (f a b ...)：t 里是函数名，实参在解析时就建好子树，调用时直接求值
+struct AST_call : public AST_base {
+    std::vector<std::unique_ptr<AST_base>> args;
+    // 函数名是全局变量时，和 AST_global 一样缓存绑定的地址
+    bool global = false;
+    mutable std::atomic<Token*> cell{nullptr};
+};
+
+// 全局变量的引用：第一次求值时找到全局环境里的那个 Token，之后直接读写它。
+// 全局绑定不会被删除，setq 也是原地改，std::map 的节点地址不变，所以缓存的指针一直有效
+struct AST_global : public AST_base {
+    using AST_base::AST_base;
+    mutable std::atomic<Token*> cell{nullptr};
+};
+
+// (let ((a 1) (b 2)) body...)：第 i 个绑定存在帧的 slot[base + i]，下标在解析时就分配好
+struct AST_let : public AST_base {
+    size_t base = 0;
+    std::vector<std::string> names; // 只给类型推断的报告用
+    std::vector<std::unique_ptr<AST_base>> inits;
+    std::vector<std::unique_ptr<AST_base>> body;
+};
+
+// (dotimes (i n) body...) / (for (i from to [step]) body...)：计数器是 C++ 里的 int64，
+// 每一轮开始时写进 slot，body 里改 i 不影响循环次数
+struct AST_loop : public AST_base {
+    size_t slot = 0;
+    std::string name;
+    std::unique_ptr<AST_base> from; // dotimes 没有，从 0 开始
+    std::unique_ptr<AST_base> to;
+    std::unique_ptr<AST_base> step; // 可选，默认 1
+    std::vector<std::unique_ptr<AST_base>> body;
+};
+
+// 函数体要到调用时才解析，所以创建 lambda 时看得见的 let 绑定记在这里，闭包转换按值捕获它们
+struct AST_lambda : public AST_base {
+    std::vector<std::pair<std::string, size_t>> let_scope;
+    std::vector<StaticType> param_types; // 和参数一一对应，没有标注的是 ANY；一个都没标注时为空
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,136 @@
+#include "budget.hpp"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+#include "alloc_stats.hpp"
+
+namespace austlisp {
+
+static std::string _budget_message(BudgetExceeded::Kind kind, uint64_t limit) {
+    switch (kind) {
+    case BudgetExceeded::STEPS:
+        return "超出求值步数限制 " + std::to_string(limit);
+    case BudgetExceeded::HEAP:
+        return "超出内存限制 " + std::to_string(limit) + " 字节";
+    case BudgetExceeded::DEPTH:
+        return "超出调用深度限制 " + std::to_string(limit);
+    case BudgetExceeded::DEADLINE:
+        return "超时 " + std::to_string(limit) + " ms";
+    default:
+        return "递归太深，栈快用完了";
+    }
+}
+
+BudgetExceeded::BudgetExceeded(Kind kind, uint64_t limit)
+    : std::runtime_error(_budget_message(kind, limit)), kind(kind), limit(limit) {}
+
+Budget::Budget() {
+    // 当前线程栈的下界；主线程的大小是按 RLIMIT_STACK 算的
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* low   = nullptr;
+        size_t size = 0;
+        if (pthread_attr_getstack(&attr, &low, &size) == 0 && size > STACK_RESERVE) {
+            _stack_limit = static_cast<const char*>(low) + STACK_RESERVE;
+        }
+        pthread_attr_destroy(&attr);
+    }
+}
+
+void Budget::_reset(const Limits& limits) {
+    _limits     = limits;
+    _steps      = 0;
+    _depth      = 0;
+    _max_depth  = limits.max_depth != 0 ? int64_t(std::min<uint64_t>(limits.max_depth, INT64_MAX)) : INT64_MAX;
+    _heap_base  = thread_live_bytes();
+    _deadline   = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.timeout_ms);
+    _ticks      = 0;
+    _next_check = limits.timeout_ms != 0 ? CHECK_EVERY : UINT64_MAX; // 时钟要定期去看
+    _next_tick  = _next_check;
+    if (limits.max_steps != 0) {
+        _next_check = std::min(_next_check, limits.max_steps + 1);
+    }
+    // 堆的上限由 operator new 在分配前检查
+    if (limits.max_heap_bytes != 0) {
+        set_thread_heap_limit(_heap_base + int64_t(std::min<uint64_t>(limits.max_heap_bytes, INT64_MAX / 2)),
+            &Budget::_heap_exceeded);
+    } else {
+        set_thread_heap_limit(INT64_MAX, nullptr);
+    }
+}
+
+Budget::Scope::Scope(const Limits& limits) : _budget(local()) {
+    _budget._reset(limits);
+}
+
+Budget::Scope::~Scope() {
+    _budget._reset(Limits{});
+}
+
+void Budget::_check() {
+    if (_limits.max_steps != 0 && _steps > _limits.max_steps) {
+        throw BudgetExceeded(BudgetExceeded::STEPS, _limits.max_steps);
+    }
+    if (_limits.timeout_ms != 0 && std::chrono::steady_clock::now() >= _deadline) {
+        throw BudgetExceeded(BudgetExceeded::DEADLINE, _limits.timeout_ms);
+    }
+    _next_check = _steps + CHECK_EVERY;
+    if (_limits.max_steps != 0) {
+        _next_check = std::min(_next_check, _limits.max_steps + 1);
+    }
+}
+
+void Budget::poll() {
+    if (_limits.timeout_ms != 0 && std::chrono::steady_clock::now() >= _deadline) {
+        throw BudgetExceeded(BudgetExceeded::DEADLINE, _limits.timeout_ms);
+    }
+    _next_tick = _limits.timeout_ms != 0 ? _ticks + CHECK_EVERY : UINT64_MAX;
+}
+
+void Budget::_heap_exceeded() {
+    throw BudgetExceeded(BudgetExceeded::HEAP, local()._limits.max_heap_bytes);
+}
+
+void Budget::_enter_failed(const char* sp) {
+    --_depth; // DepthGuard 没构造完，析构函数不会执行
+    if (sp < _stack_limit) {
+        throw BudgetExceeded(BudgetExceeded::STACK, 0);
+    }
+    throw BudgetExceeded(BudgetExceeded::DEPTH, _limits.max_depth);
+}
+
+void run_with_stack(size_t stack_size, const std::function<void()>& fn) {
+    struct Call {
+        const std::function<void()>& fn;
+        std::exception_ptr error;
+    } call{fn, nullptr};
+    auto entry = [](void* arg) -> void* {
+        auto c = static_cast<Call*>(arg);
+        try {
+            c->fn();
+        } catch (...) {
+            c->error = std::current_exception();
+        }
+        return nullptr;
+    };
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, stack_size);
+    pthread_t thread;
+    int err = pthread_create(&thread, &attr, entry, &call);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        fn(); // 开不了线程就在当前栈上跑，深递归由栈检查兜底
+        return;
+    }
+    pthread_join(thread, nullptr);
+    if (call.error) {
+        std::rethrow_exception(call.error);
+    }
+}
+
+} // namespace austlisp
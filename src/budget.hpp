@@ -0,0 +1,146 @@
+#pragma once
+
+#ifndef _BUDGET_HPP_
+#define _BUDGET_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+namespace austlisp {
+
+// 一次顶层求值的资源限制，0 表示不限
+struct Limits {
+    uint64_t max_steps      = 0; // 求值的节点数
+    uint64_t max_heap_bytes = 0; // 这次求值里本线程净分配的字节数
+    uint64_t max_depth      = 0; // lambda 调用的嵌套深度
+    uint64_t timeout_ms     = 0; // 墙钟时间
+};
+
+// 超限时抛出，一直传到顶层，由 Eval::eval_top 报错
+class BudgetExceeded : public std::runtime_error {
+public:
+    enum Kind {
+        STEPS,
+        HEAP,
+        DEPTH,
+        DEADLINE,
+        STACK, // 不是配置的限制：C++ 栈快用完了，再递归就会段错误
+    };
+
+    BudgetExceeded(Kind kind, uint64_t limit);
+
+    Kind kind;
+    uint64_t limit;
+};
+
+/**
+ * @brief
+ *  当前线程上正在进行的那次求值的预算。每个求值节点调一次 step()，只是一次自增和比较；
+ *  每 CHECK_EVERY 步(或者到了步数上限)才去看时钟。堆的上限挂在 operator new 上，每次分配前都看。
+ *  collect、sort、load-csv 这些不经过求值节点的原生长循环每处理一个元素调一次 tick()，
+ *  不算步数，同样每 CHECK_EVERY 次看一下时钟；一整块做完的(排序、填充)之后调 poll() 马上看。
+ *  调用深度和 C++ 栈在每次 lambda 调用时检查，栈检查不需要配置，总是开着，深递归报错而不是段错误。
+ *  只管当前线程：pmap 这些在线程池里跑的部分不计步数，但栈检查照样生效。
+ */
+class Budget {
+public:
+    static constexpr uint64_t CHECK_EVERY = 1024;
+    // 离栈底还剩这么多时就报错，留给内建函数和库函数用
+    static constexpr size_t STACK_RESERVE = 512 * 1024;
+    // -f 和 repl 在这么大的栈上求值，几万层的递归也不会碰到栈检查
+    static constexpr size_t EVAL_STACK_SIZE = 256 * 1024 * 1024;
+
+    // 命令行给的限制，每次顶层求值都从这里开始
+    static inline Limits defaults;
+
+    // 每个求值节点都要取一次，放在头文件里内联
+    static Budget& local() noexcept {
+        thread_local Budget budget;
+        return budget;
+    }
+
+    // 开始一次顶层求值，析构时恢复成没有限制
+    class Scope {
+    public:
+        explicit Scope(const Limits& limits = defaults);
+        ~Scope();
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Budget& _budget;
+    };
+
+    void step() {
+        if (++_steps >= _next_check) [[unlikely]] {
+            _check();
+        }
+    }
+    void tick() {
+        if (++_ticks >= _next_tick) [[unlikely]] {
+            poll();
+        }
+    }
+    void poll();
+    void enter() {
+        char probe;
+        if (++_depth > _max_depth || &probe < _stack_limit) [[unlikely]] {
+            _enter_failed(&probe);
+        }
+    }
+    void leave() noexcept {
+        --_depth;
+    }
+
+    // 有步数或时间限制时不能跑机器码，机器码里的循环不经过 step()
+    bool limited() const noexcept {
+        return _limits.max_steps != 0 || _limits.timeout_ms != 0;
+    }
+
+    // 调度器切到任务栈上时换成任务栈的下界，切回来时恢复；返回原来的
+    const char* swap_stack_limit(const char* limit) noexcept {
+        auto old     = _stack_limit;
+        _stack_limit = limit;
+        return old;
+    }
+
+private:
+    Budget();
+
+    void _reset(const Limits& limits);
+    void _check();
+    [[noreturn]] void _enter_failed(const char* sp);
+    [[noreturn]] static void _heap_exceeded();
+
+    Limits _limits;
+    uint64_t _steps      = 0;
+    uint64_t _next_check = UINT64_MAX;
+    uint64_t _ticks      = 0;
+    uint64_t _next_tick  = UINT64_MAX;
+    int64_t _depth       = 0; // 跨顶层求值还没跑完的任务退出时可能减到负数，无所谓
+    int64_t _max_depth   = INT64_MAX;
+    int64_t _heap_base   = 0;
+    std::chrono::steady_clock::time_point _deadline;
+    const char* _stack_limit = nullptr;
+};
+
+// lambda 调用的深度，异常退出时也会减回去
+struct DepthGuard {
+    DepthGuard() : budget(Budget::local()) {
+        budget.enter();
+    }
+    ~DepthGuard() {
+        budget.leave();
+    }
+    Budget& budget;
+};
+
+// 在一个有 stack_size 字节栈的新线程上跑 fn 并等它结束
+void run_with_stack(size_t stack_size, const std::function<void()>& fn);
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,130 @@
+#include "bytevector.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace austlisp {
+
+ByteStorage::~ByteStorage() {
+    if (mapped) {
+        munmap(data, size);
+    } else {
+        delete[] data;
+    }
+}
+
+std::shared_ptr<Bytevector> read_file_bytes(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "error!: 无法读取 " << path << ": " << std::strerror(errno) << '\n';
+        return nullptr;
+    }
+    auto storage = std::make_shared<ByteStorage>();
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            storage->data   = static_cast<uint8_t*>(p);
+            storage->size   = size_t(st.st_size);
+            storage->mapped = true;
+        }
+    }
+    if (!storage->mapped) {
+        // 不能映射的(空文件、管道、设备)就一块块读
+        std::vector<uint8_t> buf;
+        uint8_t chunk[1 << 16];
+        for (;;) {
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                std::cerr << "error!: 无法读取 " << path << ": " << std::strerror(errno) << '\n';
+                close(fd);
+                return nullptr;
+            }
+            if (n == 0) {
+                break;
+            }
+            buf.insert(buf.end(), chunk, chunk + n);
+        }
+        storage = std::make_shared<ByteStorage>(buf.size());
+        if (!buf.empty()) {
+            std::memcpy(storage->data, buf.data(), buf.size());
+        }
+    }
+    close(fd);
+    size_t size = storage->size;
+    return std::make_shared<Bytevector>(std::move(storage), 0, size);
+}
+
+static bool _write_all(int fd, const Bytevector& bytes) {
+    const uint8_t* p = bytes.data();
+    size_t left      = bytes.size;
+    while (left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        p += n;
+        left -= size_t(n);
+    }
+    return true;
+}
+
+bool write_file_bytes(const std::string& path, const Bytevector& bytes) {
+    auto fail = [&](const std::string& target) {
+        std::cerr << "error!: 无法写入 " << target << ": " << std::strerror(errno) << '\n';
+        return false;
+    };
+    struct stat st;
+    bool exists = stat(path.c_str(), &st) == 0;
+    if (exists && !S_ISREG(st.st_mode)) {
+        // 管道、设备这些不能换掉，直接写
+        int fd = open(path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+        if (fd < 0 || !_write_all(fd, bytes)) {
+            int err = errno;
+            if (fd >= 0) {
+                close(fd);
+            }
+            errno = err;
+            return fail(path);
+        }
+        return close(fd) == 0 || fail(path);
+    }
+    // bytes 可能就是 read-file-bytes 映射的这个文件(MAP_PRIVATE)，原地截断会把它还没改过的页一起清掉。
+    // 先写到同一目录下的临时文件，再 rename 过去，旧文件的映射一直有效
+    std::string tmp = path + ".XXXXXX";
+    int fd          = mkostemp(tmp.data(), O_CLOEXEC);
+    if (fd < 0) {
+        return fail(tmp);
+    }
+    if (fchmod(fd, exists ? st.st_mode & 07777 : 0644) != 0 || !_write_all(fd, bytes)) {
+        int err = errno;
+        close(fd);
+        unlink(tmp.c_str());
+        errno = err;
+        return fail(path);
+    }
+    if (close(fd) == 0 && rename(tmp.c_str(), path.c_str()) == 0) {
+        return true;
+    }
+    int err = errno;
+    unlink(tmp.c_str());
+    errno = err;
+    return fail(path);
+}
+
+} // namespace austlisp
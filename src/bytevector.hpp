@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef _BYTEVECTOR_HPP_
+#define _BYTEVECTOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "lisp.hpp"
+
+namespace austlisp {
+
+// 字节的存储：文件读进来的是 MAP_PRIVATE 映射(写时复制，改了也不会写回文件)，其他是堆上的数组
+struct ByteStorage {
+    uint8_t* data = nullptr;
+    size_t size   = 0;
+    bool mapped   = false;
+
+    ByteStorage() = default;
+    explicit ByteStorage(size_t n) : data(n > 0 ? new uint8_t[n]() : nullptr), size(n) {}
+    ~ByteStorage();
+    ByteStorage(const ByteStorage&)            = delete;
+    ByteStorage& operator=(const ByteStorage&) = delete;
+};
+
+/**
+ * @brief
+ *  bytevector 的值：一段共享存储上的 [offset, offset + size)。
+ *  bytevector-slice 只是再开一个视图，不拷贝，所以对切片的修改原来的 bytevector 也能看到。
+ */
+struct Bytevector : Handle {
+    Bytevector(std::shared_ptr<ByteStorage> storage, size_t offset, size_t size)
+        : storage(std::move(storage)), offset(offset), size(size) {}
+
+    uint8_t* data() const noexcept {
+        return storage->data + offset;
+    }
+
+    std::shared_ptr<ByteStorage> storage;
+    size_t offset;
+    size_t size;
+};
+
+// 普通文件直接 mmap，管道之类的读到堆上；失败时打印原因返回 nullptr
+std::shared_ptr<Bytevector> read_file_bytes(const std::string& path);
+// 覆盖写整个文件
+bool write_file_bytes(const std::string& path, const Bytevector& bytes);
+
+} // namespace austlisp
+
+#endif
@@ -1,11 +1,24 @@
 #include "env.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
+#include "budget.hpp"
+#include "bytevector.hpp"
 #include "lisp.hpp"
+#include "memo.hpp"
+#include "output.hpp"
+#include "sched.hpp"
+#include "seq.hpp"
+#include "table.hpp"
 
 namespace austlisp {
 
@@ -17,15 +30,36 @@ void Env::add(std::string name, Token&& token) {
     }
 }
 
+Token* Env::find_lexical(const std::string& name) {
+    if (auto it = sym_table.find(name); it != sym_table.end()) {
+        return &it->second;
+    }
+    if (_closure != nullptr) {
+        if (auto i = _closure->capture_index(name); i >= 0) {
+            return &_closure->captures[i];
+        }
+    }
+    return nullptr;
+}
+
 Token* Env::find(const std::string& name) {
-    Token* token = nullptr;
-    if (sym_table.find(name) != sym_table.end()) {
-        token = &sym_table[name];
+    RuntimeCounters::bump(runtime_counters.symbol_lookups);
+    // 先词法(本层 + 捕获的变量)，再全局
+    if (auto t = find_lexical(name)) {
+        return t;
+    }
+    if (_global != this) {
+        if (auto it = _global->sym_table.find(name); it != _global->sym_table.end()) {
+            return &it->second;
+        }
     }
-    if (_outer != nullptr && !token && _outer->sym_table.find(name) != _outer->sym_table.end()) {
-        token = &_outer->sym_table[name];
+    // 最后才沿调用链找：函数体里 define 的局部递归函数创建时还没绑定自己，只能这样找到
+    for (Env* e = _outer; e != nullptr && e != _global; e = e->_outer) {
+        if (auto t = e->find_lexical(name)) {
+            return t;
+        }
     }
-    return token;
+    return nullptr;
 }
 
 bool Env::update(const std::string& name, Tokens token_type, Value&& new_value) {
@@ -34,11 +68,52 @@ bool Env::update(const std::string& name, Tokens token_type, Value&& new_value)
         std::cerr << "can't find symbol: " << name << ", " << "updata failure.\n";
         return false;
     }
-    t->token_type = token_type;
-    t->value      = std::move(new_value);
+    assign(*t, token_type, std::move(new_value));
     return true;
 }
 
+void Env::assign(Token& cell, Tokens token_type, Value&& new_value) {
+    if (std::string_view(Tokens_str[int(cell.token_type)]).starts_with("_BUILDIN")) {
+        _buildin_epoch.fetch_add(1, std::memory_order_release);
+    }
+    cell.token_type = token_type;
+    cell.value      = std::move(new_value);
+}
+
+// lambda 和列表里的 lambda 都复制一份；编译好的函数体和 JIT 代码不带过去，新环境里第一次调用时再生成
+static Token _clone_token(const Token& t) {
+    if (t.token_type == Tokens::K_LAMBDA && std::holds_alternative<_Ptr_Lambda_t>(t.value)) {
+        const auto& func = *std::get<_Ptr_Lambda_t>(t.value);
+        auto copy        = std::make_shared<Lambda>(List(func.params), List(func.body));
+        copy->param_types   = func.param_types;
+        copy->capture_names = func.capture_names;
+        for (const auto& c : func.captures) {
+            copy->captures.emplace_back(_clone_token(c));
+        }
+        if (func.memo) {
+            copy->memo = std::make_shared<MemoCache>(func.memo->capacity);
+        }
+        return Token{Tokens::K_LAMBDA, std::move(copy)};
+    }
+    if (t.token_type == Tokens::LIST && std::holds_alternative<_Ptr_List_t>(t.value)) {
+        auto items = std::make_unique<List>();
+        items->reserve(std::get<_Ptr_List_t>(t.value)->size());
+        for (const auto& item : *std::get<_Ptr_List_t>(t.value)) {
+            items->emplace_back(_clone_token(item));
+        }
+        return Token{Tokens::LIST, std::move(items)};
+    }
+    return t.copy();
+}
+
+std::unique_ptr<Env> Env::clone() const {
+    auto env = std::make_unique<Env>();
+    for (const auto& [name, token] : sym_table) {
+        env->sym_table[name] = _clone_token(token);
+    }
+    return env;
+}
+
 const Token& Env::operator[](const std::string& name) {
     return sym_table[name];
 }
@@ -46,12 +121,37 @@ const Token& Env::last() noexcept {
     return (--sym_table.end())->second;
 }
 
+// 扁平列表里从 i 开始的那个元素的最后一个 token：原子就是它自己，子列表是匹配的 ')'
+static size_t _element_end(const List& list, size_t i) noexcept {
+    if (list[i].token_type != Tokens::LPAREN) {
+        return i;
+    }
+    int parens = 0;
+    for (; i + 1 < list.size(); ++i) {
+        if (list[i].token_type == Tokens::LPAREN) {
+            parens++;
+        } else if (list[i].token_type == Tokens::RPAREN && --parens == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
 Token Env::_buildin_func_car(const List& token_list) noexcept {
     if (token_list.size() != 2 || token_list[1].token_type != Tokens::LIST) {
         std::cerr << "error!: car接受一个列表.\n";
         return Token{};
     }
-    return (*std::get<_Ptr_List_t>(token_list[1].value))[1].copy();
+    const auto& _list = *std::get<_Ptr_List_t>(token_list[1].value);
+    if (_list.size() < 3) { // ( )
+        return Token{};
+    }
+    if (_list[1].token_type != Tokens::LPAREN) {
+        return _list[1].copy();
+    }
+    // 第一个元素是子列表，整个取出来
+    auto end = _element_end(_list, 1);
+    return Token{Tokens::LIST, std::make_unique<List>(_list.begin() + 1, _list.begin() + end + 1)};
 }
 
 Token Env::_buildin_func_cdr(const List& token_list) {
@@ -62,7 +162,8 @@ Token Env::_buildin_func_cdr(const List& token_list) {
     const auto& _list = *std::get<_Ptr_List_t>(token_list[1].value);
     List ret;
     ret.emplace_back(_list[0]);
-    for (int i = 2; i < _list.size(); ++i) {
+    // 跳过第一个元素，它可能是一个子列表
+    for (size_t i = _list.size() < 3 ? 1 : _element_end(_list, 1) + 1; i < _list.size(); ++i) {
         ret.emplace_back(_list[i].copy());
     }
     return Token{Tokens::LIST, std::make_unique<List>(ret)};
@@ -71,7 +172,7 @@ Token Env::_buildin_func_cdr(const List& token_list) {
 Token Env::_buildin_func_eq(const List& token_list) {
     if (token_list[1].is_complex_type() && token_list[2].is_complex_type()) {
         if (token_list[1].token_type == Tokens::STRING && token_list[2].token_type == Tokens::STRING
-            && std::get<_Ptr_Str_t>(token_list[1].value) == std::get<_Ptr_Str_t>(token_list[2].value)) {
+            && std::get<Str>(token_list[1].value).same(std::get<Str>(token_list[2].value))) {
             return Token{Tokens::TRUE, 1};
         } else {
             return Token{Tokens::FALSE, 0};
@@ -124,27 +225,999 @@ Token Env::_buildin_func_equal(const List& token_list) {
                 }
             }
         } else if (token_list[1].token_type == Tokens::STRING && token_list[2].token_type == Tokens::STRING) {
-            auto& lhs = *std::get<_Ptr_Str_t>(token_list[1].value);
-            auto& rhs = *std::get<_Ptr_Str_t>(token_list[2].value);
-            if (lhs.size() != rhs.size()) {
+            if (!(std::get<Str>(token_list[1].value) == std::get<Str>(token_list[2].value))) {
                 return Token{Tokens::FALSE, 0};
             }
-            for (int i = 0; i < lhs.size(); ++i) {
-                if (lhs[i] != rhs[i]) {
-                    return Token{Tokens::FALSE, 0};
-                }
-            }
         }
         return Token{Tokens::TRUE, 1};
     }
     return _buildin_func_eq(token_list);
 }
 
+// 任务和channel在脚本里是句柄，没有引用了调度器就会回收它们
+static int64_t _sched_id(const Token& t) {
+    return static_cast<const Scheduler::Ref&>(*std::get<_Ptr_Handle_t>(t.value)).id;
+}
+
+Token Env::_buildin_func_await(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::TASK) {
+        std::cerr << "error!: await接受一个任务.\n";
+        return Token{};
+    }
+    return Scheduler::instance().await(_sched_id(token_list[1]));
+}
+
+Token Env::_buildin_func_channel(const List& token_list) {
+    int64_t capacity = 1;
+    if (token_list.size() == 2 && token_list[1].token_type == Tokens::INTEGER) {
+        capacity = std::get<int64_t>(token_list[1].value);
+    } else if (token_list.size() != 1) {
+        std::cerr << "error!: channel接受一个可选的容量.\n";
+        return Token{};
+    }
+    if (capacity <= 0) {
+        std::cerr << "error!: channel容量必须大于0.\n";
+        return Token{};
+    }
+    return Token{Tokens::CHANNEL, Scheduler::instance().make_channel(capacity)};
+}
+
+Token Env::_buildin_func_send(List& token_list) {
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::CHANNEL) {
+        std::cerr << "error!: send接受一个channel和一个值.\n";
+        return Token{};
+    }
+    if (Scheduler::instance().send(_sched_id(token_list[1]), std::move(token_list[2]))) {
+        return Token{Tokens::TRUE, 1};
+    }
+    return Token{Tokens::FALSE, 0};
+}
+
+Token Env::_buildin_func_recv(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::CHANNEL) {
+        std::cerr << "error!: recv接受一个channel.\n";
+        return Token{};
+    }
+    return Scheduler::instance().recv(_sched_id(token_list[1]));
+}
+
+Token Env::_buildin_func_yield(const List& token_list) {
+    if (token_list.size() != 1) {
+        std::cerr << "error!: yield不接受参数.\n";
+        return Token{};
+    }
+    Scheduler::instance().yield();
+    return Token{};
+}
+
+// (memoize f [capacity])，返回带缓存的新 lambda，原来的 f 不受影响
+Token Env::_buildin_func_memoize(const List& token_list) {
+    if (token_list.size() < 2 || token_list.size() > 3 || token_list[1].token_type != Tokens::K_LAMBDA
+        || (token_list.size() == 3 && token_list[2].token_type != Tokens::INTEGER)) {
+        std::cerr << "error!: memoize接受一个lambda和一个可选的缓存上限.\n";
+        return Token{};
+    }
+    int64_t capacity = token_list.size() == 3 ? std::get<int64_t>(token_list[2].value) : 4096;
+    if (capacity <= 0) {
+        std::cerr << "error!: 缓存上限必须大于0.\n";
+        return Token{};
+    }
+    const auto& func = *std::get<_Ptr_Lambda_t>(token_list[1].value);
+    auto memoized    = std::make_shared<Lambda>(List(func.params), List(func.body));
+    memoized->memo   = std::make_shared<MemoCache>(capacity);
+
+    memoized->param_types   = func.param_types;
+    memoized->capture_names = func.capture_names;
+    for (const auto& t : func.captures) {
+        memoized->captures.emplace_back(t.copy());
+    }
+    return Token{Tokens::K_LAMBDA, std::move(memoized)};
+}
+
+static MemoCache* _memo_of(const List& token_list, const char* name) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::K_LAMBDA
+        || !std::get<_Ptr_Lambda_t>(token_list[1].value)->memo) {
+        std::cerr << "error!: " << name << "接受一个memoize过的lambda.\n";
+        return nullptr;
+    }
+    return std::get<_Ptr_Lambda_t>(token_list[1].value)->memo.get();
+}
+
+// (memo-stats f) => (hits misses size capacity)
+Token Env::_buildin_func_memo_stats(const List& token_list) {
+    auto memo = _memo_of(token_list, "memo-stats");
+    if (memo == nullptr) {
+        return Token{};
+    }
+    std::lock_guard<std::mutex> lock(memo->m);
+    List stats;
+    stats.emplace_back(Token{Tokens::INTEGER, int64_t(memo->hits)});
+    stats.emplace_back(Token{Tokens::INTEGER, int64_t(memo->misses)});
+    stats.emplace_back(Token{Tokens::INTEGER, int64_t(memo->lru.size())});
+    stats.emplace_back(Token{Tokens::INTEGER, int64_t(memo->capacity)});
+    return _make_list(std::move(stats));
+}
+
+Token Env::_buildin_func_memo_clear(const List& token_list) {
+    auto memo = _memo_of(token_list, "memo-clear");
+    if (memo == nullptr) {
+        return Token{};
+    }
+    memo->clear();
+    return Token{Tokens::TRUE, 1};
+}
+
+// (runtime-stats) => ((token-copies n) (list-bytes-copied n) ...)
+Token Env::_buildin_func_runtime_stats(const List& token_list) {
+    if (token_list.size() != 1) {
+        std::cerr << "error!: runtime-stats不接受参数.\n";
+        return Token{};
+    }
+    auto s = runtime_stats();
+    std::pair<const char*, uint64_t> fields[] = {
+        {"token-copies", s.token_copies},
+        {"list-bytes-copied", s.list_bytes_copied},
+        {"string-bytes-copied", s.string_bytes_copied},
+        {"env-frames", s.env_frames},
+        {"symbol-lookups", s.symbol_lookups},
+        {"ast-nodes", s.ast_nodes},
+        {"heap-bytes", s.heap_bytes},
+        {"peak-heap-bytes", s.peak_heap_bytes},
+        {"rss-kb", s.rss_kb},
+        {"peak-rss-kb", s.peak_rss_kb},
+    };
+    List items;
+    for (const auto& [name, value] : fields) {
+        List pair;
+        pair.emplace_back(Token{Tokens::IDENT, std::make_unique<std::string>(name)});
+        pair.emplace_back(Token{Tokens::INTEGER, int64_t(value)});
+        items.emplace_back(_make_list(std::move(pair)));
+    }
+    return _make_list(std::move(items));
+}
+
+// (range end) / (range start end) / (range start end step)，不含 end
+Token Env::_buildin_func_range(const List& token_list) {
+    if (token_list.size() < 2 || token_list.size() > 4) {
+        std::cerr << "error!: range接受一到三个整数.\n";
+        return Token{};
+    }
+    for (size_t i = 1; i < token_list.size(); ++i) {
+        if (token_list[i].token_type != Tokens::INTEGER) {
+            std::cerr << "error!: range的参数必须是整数.\n";
+            return Token{};
+        }
+    }
+    auto seq = std::make_shared<Seq>(Seq::RANGE);
+    if (token_list.size() == 2) {
+        seq->end = std::get<int64_t>(token_list[1].value);
+    } else {
+        seq->start = std::get<int64_t>(token_list[1].value);
+        seq->end   = std::get<int64_t>(token_list[2].value);
+    }
+    if (token_list.size() == 4) {
+        seq->step = std::get<int64_t>(token_list[3].value);
+        if (seq->step == 0) {
+            std::cerr << "error!: range的步长不能是0.\n";
+            return Token{};
+        }
+    }
+    return Token{Tokens::SEQ, _Ptr_Handle_t(std::move(seq))};
+}
+
+// lazy-map/lazy-filter 共用：(name f seq)
+static Token _lazy_transform(const List& token_list, Seq::Kind kind, const char* name) {
+    std::shared_ptr<const Seq> source;
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::K_LAMBDA
+        || !(source = _seq_source(token_list[2]))) {
+        std::cerr << "error!: " << name << "接受一个lambda和一个序列.\n";
+        return Token{};
+    }
+    auto seq    = std::make_shared<Seq>(kind);
+    seq->fn     = token_list[1].copy();
+    seq->source = std::move(source);
+    return Token{Tokens::SEQ, _Ptr_Handle_t(std::move(seq))};
+}
+
+Token Env::_buildin_func_lazy_map(const List& token_list) {
+    return _lazy_transform(token_list, Seq::MAP, "lazy-map");
+}
+
+Token Env::_buildin_func_lazy_filter(const List& token_list) {
+    return _lazy_transform(token_list, Seq::FILTER, "lazy-filter");
+}
+
+// (take n seq)，结果还是惰性的，用来截断 iterate 这种无限序列
+Token Env::_buildin_func_take(const List& token_list) {
+    std::shared_ptr<const Seq> source;
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::INTEGER
+        || !(source = _seq_source(token_list[2]))) {
+        std::cerr << "error!: take接受一个整数和一个序列.\n";
+        return Token{};
+    }
+    auto seq    = std::make_shared<Seq>(Seq::TAKE);
+    seq->count  = std::max<int64_t>(0, std::get<int64_t>(token_list[1].value));
+    seq->source = std::move(source);
+    return Token{Tokens::SEQ, _Ptr_Handle_t(std::move(seq))};
+}
+
+// (iterate f x) => x, (f x), (f (f x)) ...，没有尽头
+Token Env::_buildin_func_iterate(const List& token_list) {
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::K_LAMBDA) {
+        std::cerr << "error!: iterate接受一个lambda和初值.\n";
+        return Token{};
+    }
+    auto seq     = std::make_shared<Seq>(Seq::ITERATE);
+    seq->fn      = token_list[1].copy();
+    seq->init    = token_list[2].copy();
+    seq->bounded = false;
+    return Token{Tokens::SEQ, _Ptr_Handle_t(std::move(seq))};
+}
+
+// (length list)，只数顶层元素，不拷贝
+Token Env::_buildin_func_length(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::LIST) {
+        std::cerr << "error!: length接受一个列表.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[1].value);
+    int64_t n        = 0;
+    for (size_t i = 1; i + 1 < list.size(); i = _element_end(list, i) + 1) {
+        n++;
+    }
+    return Token{Tokens::INTEGER, n};
+}
+
+// 从 begin 到 end(含)这一段作为一个值：原子就是它自己，子列表拷成一个 LIST
+static Token _element_at(const List& list, size_t begin, size_t end) {
+    if (begin == end) {
+        return list[begin].copy();
+    }
+    return Token{Tokens::LIST, std::make_unique<List>(list.begin() + begin, list.begin() + end + 1)};
+}
+
+// (nth n list)，从 0 开始，越界是 nil
+Token Env::_buildin_func_nth(const List& token_list) {
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::INTEGER
+        || token_list[2].token_type != Tokens::LIST) {
+        std::cerr << "error!: nth接受一个整数和一个列表.\n";
+        return Token{};
+    }
+    auto n = std::get<int64_t>(token_list[1].value);
+    if (n < 0) {
+        std::cerr << "error!: nth的下标不能是负数.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[2].value);
+    for (size_t i = 1; i + 1 < list.size(); i = _element_end(list, i) + 1) {
+        if (n-- == 0) {
+            return _element_at(list, i, _element_end(list, i));
+        }
+    }
+    return Token{};
+}
+
+// (append l1 l2 ...)，先算好总长度，一次分配
+Token Env::_buildin_func_append(const List& token_list) {
+    size_t total = 2;
+    for (size_t i = 1; i < token_list.size(); ++i) {
+        if (token_list[i].token_type != Tokens::LIST) {
+            std::cerr << "error!: append的参数必须都是列表.\n";
+            return Token{};
+        }
+        total += std::get<_Ptr_List_t>(token_list[i].value)->size() - 2;
+    }
+    auto out = std::make_unique<List>();
+    out->reserve(total);
+    out->emplace_back(Token{Tokens::LPAREN, std::make_unique<std::string>("(")});
+    for (size_t i = 1; i < token_list.size(); ++i) {
+        const auto& list = *std::get<_Ptr_List_t>(token_list[i].value);
+        for (size_t j = 1; j + 1 < list.size(); ++j) {
+            out->emplace_back(list[j].copy());
+        }
+    }
+    out->emplace_back(Token{Tokens::RPAREN, std::make_unique<std::string>(")")});
+    return Token{Tokens::LIST, std::move(out)};
+}
+
+// (reverse list)，子列表整体挪位置，内部顺序不变
+Token Env::_buildin_func_reverse(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::LIST) {
+        std::cerr << "error!: reverse接受一个列表.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[1].value);
+    auto out         = std::make_unique<List>();
+    out->reserve(list.size());
+    out->emplace_back(Token{Tokens::LPAREN, std::make_unique<std::string>("(")});
+    // 从后往前找元素的开头：原子就是自己，')' 要找到匹配的 '('
+    for (size_t end = list.size() - 1; end-- > 1;) {
+        size_t begin = end;
+        if (list[end].token_type == Tokens::RPAREN) {
+            int parens = 0;
+            for (;; --begin) {
+                if (list[begin].token_type == Tokens::RPAREN) {
+                    parens++;
+                } else if (list[begin].token_type == Tokens::LPAREN && --parens == 0) {
+                    break;
+                }
+            }
+        }
+        for (size_t i = begin; i <= end; ++i) {
+            out->emplace_back(list[i].copy());
+        }
+        end = begin;
+    }
+    out->emplace_back(Token{Tokens::RPAREN, std::make_unique<std::string>(")")});
+    return Token{Tokens::LIST, std::move(out)};
+}
+
+// list 里 begin 到 end 这个元素是否和 x 相等(equal 的语义)，不用先把元素拷出来
+static bool _element_same(const List& list, size_t begin, size_t end, const Token& x) {
+    // 'b 求值出来是只有一个符号、不带括号的 LIST
+    if (x.token_type == Tokens::LIST && std::get<_Ptr_List_t>(x.value)->size() == 1) {
+        return begin == end && _token_same(list[begin], std::get<_Ptr_List_t>(x.value)->front());
+    }
+    if (begin == end) {
+        return _token_same(list[begin], x);
+    }
+    if (x.token_type != Tokens::LIST) {
+        return false;
+    }
+    const auto& other = *std::get<_Ptr_List_t>(x.value);
+    if (other.size() != end - begin + 1) {
+        return false;
+    }
+    for (size_t i = 0; i < other.size(); ++i) {
+        if (!_token_same(list[begin + i], other[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// (member x list)，返回从第一个等于 x 的元素开始的剩余部分，找不到是 false
+Token Env::_buildin_func_member(const List& token_list) {
+    if (token_list.size() != 3 || token_list[2].token_type != Tokens::LIST) {
+        std::cerr << "error!: member接受一个值和一个列表.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[2].value);
+    for (size_t i = 1; i + 1 < list.size(); i = _element_end(list, i) + 1) {
+        if (_element_same(list, i, _element_end(list, i), token_list[1])) {
+            auto out = std::make_unique<List>();
+            out->reserve(list.size() - i + 1);
+            out->emplace_back(list[0].copy());
+            for (size_t j = i; j < list.size(); ++j) {
+                out->emplace_back(list[j].copy());
+            }
+            return Token{Tokens::LIST, std::move(out)};
+        }
+    }
+    return Token{Tokens::FALSE, 0};
+}
+
+// (assoc key alist)，返回第一个 car 等于 key 的子列表，找不到是 false
+Token Env::_buildin_func_assoc(const List& token_list) {
+    if (token_list.size() != 3 || token_list[2].token_type != Tokens::LIST) {
+        std::cerr << "error!: assoc接受一个键和一个关联列表.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[2].value);
+    for (size_t i = 1; i + 1 < list.size(); i = _element_end(list, i) + 1) {
+        size_t end = _element_end(list, i);
+        if (end == i || end - i < 2) { // 原子或者 ()
+            continue;
+        }
+        if (_element_same(list, i + 1, _element_end(list, i + 1), token_list[1])) {
+            return _element_at(list, i, end);
+        }
+    }
+    return Token{Tokens::FALSE, 0};
+}
+
+// 可变的字符串缓冲，append 均摊 O(1)，最后 builder-string 一次性变成不可变的 Str
+struct StrBuilder : Handle {
+    std::string buf;
+};
+
+// 字符串原样追加，数字和布尔按 display 的格式；其他类型返回 false
+static bool _append_text(std::string& out, const Token& t) {
+    switch (t.token_type) {
+    case Tokens::STRING:
+    case Tokens::INTEGER:
+    case Tokens::DOUBLE:
+    case Tokens::TRUE:
+    case Tokens::FALSE:
+        display(out, t);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// (string-builder)
+Token Env::_buildin_func_string_builder(const List& token_list) {
+    if (token_list.size() != 1) {
+        std::cerr << "error!: string-builder不接受参数.\n";
+        return Token{};
+    }
+    return Token{Tokens::STRING_BUILDER, _Ptr_Handle_t(std::make_shared<StrBuilder>())};
+}
+
+// (builder-append b x...)，返回 b 本身，可以接着 append
+Token Env::_buildin_func_builder_append(const List& token_list) {
+    if (token_list.size() < 2 || token_list[1].token_type != Tokens::STRING_BUILDER) {
+        std::cerr << "error!: builder-append接受一个string-builder和要追加的值.\n";
+        return Token{};
+    }
+    auto& buf = static_cast<StrBuilder&>(*std::get<_Ptr_Handle_t>(token_list[1].value)).buf;
+    for (size_t i = 2; i < token_list.size(); ++i) {
+        if (!_append_text(buf, token_list[i])) {
+            std::cerr << "error!: builder-append只能追加字符串、数字和布尔值.\n";
+            return Token{};
+        }
+    }
+    return token_list[1].copy();
+}
+
+// (builder-string b)，builder 之后还能继续用
+Token Env::_buildin_func_builder_string(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::STRING_BUILDER) {
+        std::cerr << "error!: builder-string接受一个string-builder.\n";
+        return Token{};
+    }
+    return Token{Tokens::STRING, Str::from(static_cast<const StrBuilder&>(*std::get<_Ptr_Handle_t>(token_list[1].value)).buf)};
+}
+
+// (string-join list [sep])，先算好字符串部分的总长度再拼
+Token Env::_buildin_func_string_join(const List& token_list) {
+    if (token_list.size() < 2 || token_list.size() > 3 || token_list[1].token_type != Tokens::LIST
+        || (token_list.size() == 3 && token_list[2].token_type != Tokens::STRING)) {
+        std::cerr << "error!: string-join接受一个列表和一个可选的分隔字符串.\n";
+        return Token{};
+    }
+    const auto& list = *std::get<_Ptr_List_t>(token_list[1].value);
+    auto sep         = token_list.size() == 3 ? std::get<Str>(token_list[2].value).view() : std::string_view();
+    size_t total     = 0;
+    for (size_t i = 1; i + 1 < list.size(); ++i) {
+        total += sep.size() + (list[i].token_type == Tokens::STRING ? std::get<Str>(list[i].value).size() : 20);
+    }
+    std::string out;
+    out.reserve(total);
+    for (size_t i = 1; i + 1 < list.size(); ++i) {
+        if (i > 1) {
+            out += sep;
+        }
+        if (!_append_text(out, list[i])) {
+            std::cerr << "error!: string-join的元素只能是字符串、数字和布尔值.\n";
+            return Token{};
+        }
+    }
+    return Token{Tokens::STRING, Str::from(out)};
+}
+
+// (substring s start [end])，按字节，和原字符串共用存储
+Token Env::_buildin_func_substring(const List& token_list) {
+    if (token_list.size() < 3 || token_list.size() > 4 || token_list[1].token_type != Tokens::STRING
+        || token_list[2].token_type != Tokens::INTEGER
+        || (token_list.size() == 4 && token_list[3].token_type != Tokens::INTEGER)) {
+        std::cerr << "error!: substring接受一个字符串、起点和可选的终点.\n";
+        return Token{};
+    }
+    const auto& s = std::get<Str>(token_list[1].value);
+    auto start    = std::get<int64_t>(token_list[2].value);
+    auto end      = token_list.size() == 4 ? std::get<int64_t>(token_list[3].value) : int64_t(s.size());
+    if (start < 0 || end < start || size_t(end) > s.size()) {
+        std::cerr << "error!: substring的范围越界.\n";
+        return Token{};
+    }
+    return Token{Tokens::STRING, s.substr(size_t(start), size_t(end - start))};
+}
+
+Token Env::_buildin_func_string_length(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::STRING) {
+        std::cerr << "error!: string-length接受一个字符串.\n";
+        return Token{};
+    }
+    return Token{Tokens::INTEGER, int64_t(std::get<Str>(token_list[1].value).size())};
+}
+
+// (display x...)，直接写进输出缓冲，不换行
+Token Env::_buildin_func_display(const List& token_list) {
+    auto& output = Output::local();
+    for (size_t i = 1; i < token_list.size(); ++i) {
+        display(output.buffer(), token_list[i]);
+    }
+    output.commit();
+    return Token{};
+}
+
+// (print x...)，参数之间一个空格，最后换行
+Token Env::_buildin_func_print(const List& token_list) {
+    auto& output = Output::local();
+    for (size_t i = 1; i < token_list.size(); ++i) {
+        if (i > 1) {
+            output.buffer() += ' ';
+        }
+        display(output.buffer(), token_list[i]);
+    }
+    output.buffer() += '\n';
+    output.commit();
+    return Token{};
+}
+
+// (format "x=~a~%" x)：~a 换成下一个参数的 display 格式，~% 是换行，~~ 是 ~
+Token Env::_buildin_func_format(const List& token_list) {
+    if (token_list.size() < 2 || token_list[1].token_type != Tokens::STRING) {
+        std::cerr << "error!: format的第一个参数必须是格式字符串.\n";
+        return Token{};
+    }
+    auto fmt   = std::get<Str>(token_list[1].value).view();
+    size_t arg = 2;
+    std::string out;
+    out.reserve(fmt.size() + 16 * (token_list.size() - 2));
+    for (size_t i = 0; i < fmt.size(); ++i) {
+        if (fmt[i] != '~' || i + 1 == fmt.size()) {
+            out += fmt[i];
+            continue;
+        }
+        switch (fmt[++i]) {
+        case 'a':
+            if (arg >= token_list.size()) {
+                std::cerr << "error!: format的参数不够.\n";
+                return Token{};
+            }
+            display(out, token_list[arg++]);
+            break;
+        case '%':
+            out += '\n';
+            break;
+        case '~':
+            out += '~';
+            break;
+        default:
+            std::cerr << "error!: format不认识 ~" << fmt[i] << ".\n";
+            return Token{};
+        }
+    }
+    if (arg != token_list.size()) {
+        std::cerr << "error!: format的参数太多.\n";
+        return Token{};
+    }
+    return Token{Tokens::STRING, Str::from(out)};
+}
+
+// (load-csv "file" [sep])，第一行是列名，sep 默认是逗号
+Token Env::_buildin_func_load_csv(const List& token_list) {
+    if (token_list.size() < 2 || token_list.size() > 3 || token_list[1].token_type != Tokens::STRING
+        || (token_list.size() == 3
+            && (token_list[2].token_type != Tokens::STRING || std::get<Str>(token_list[2].value).size() != 1))) {
+        std::cerr << "error!: load-csv接受一个文件名和一个可选的单字符分隔符.\n";
+        return Token{};
+    }
+    char sep   = token_list.size() == 3 ? std::get<Str>(token_list[2].value).view()[0] : ',';
+    auto table = load_csv(std::get<Str>(token_list[1].value).str(), sep);
+    if (!table) {
+        return Token{};
+    }
+    return Token{Tokens::TABLE, _Ptr_Handle_t(std::move(table))};
+}
+
+static const Table* _table_arg(const List& token_list, size_t argc, const char* usage) {
+    if (token_list.size() != argc || token_list[1].token_type != Tokens::TABLE) {
+        std::cerr << "error!: " << usage << ".\n";
+        return nullptr;
+    }
+    return static_cast<const Table*>(std::get<_Ptr_Handle_t>(token_list[1].value).get());
+}
+
+// 列名参数在表里的下标，不是字符串或者没有这一列返回 -1
+static int _table_column_arg(const Table& table, const Token& name) {
+    if (name.token_type != Tokens::STRING) {
+        std::cerr << "error!: 列名必须是字符串.\n";
+        return -1;
+    }
+    int col = table.find(std::get<Str>(name.value).view());
+    if (col < 0) {
+        std::cerr << "error!: 表里没有列 " << std::get<Str>(name.value) << ".\n";
+    }
+    return col;
+}
+
+Token Env::_buildin_func_table_rows(const List& token_list) {
+    auto table = _table_arg(token_list, 2, "table-rows接受一个表");
+    if (!table) {
+        return Token{};
+    }
+    return Token{Tokens::INTEGER, int64_t(table->rows)};
+}
+
+Token Env::_buildin_func_table_columns(const List& token_list) {
+    auto table = _table_arg(token_list, 2, "table-columns接受一个表");
+    if (!table) {
+        return Token{};
+    }
+    List names;
+    names.reserve(table->columns.size());
+    for (const auto& column : table->columns) {
+        names.emplace_back(Token{Tokens::STRING, Str(column.name)});
+    }
+    return _make_list(std::move(names));
+}
+
+// (table-column t "name")，返回惰性序列，reduce/lazy-map 一个个取，不把整列变成 Token 列表
+Token Env::_buildin_func_table_column(const List& token_list) {
+    auto table = _table_arg(token_list, 3, "table-column接受一个表和一个列名");
+    if (!table) {
+        return Token{};
+    }
+    int col = _table_column_arg(*table, token_list[2]);
+    if (col < 0) {
+        return Token{};
+    }
+    auto seq    = std::make_shared<Seq>(Seq::COLUMN);
+    seq->table  = std::static_pointer_cast<const Table>(std::get<_Ptr_Handle_t>(token_list[1].value));
+    seq->column = size_t(col);
+    return Token{Tokens::SEQ, _Ptr_Handle_t(std::move(seq))};
+}
+
+// (table-ref t "name" row)
+Token Env::_buildin_func_table_ref(const List& token_list) {
+    auto table = _table_arg(token_list, 4, "table-ref接受一个表、一个列名和行号");
+    if (!table) {
+        return Token{};
+    }
+    int col = _table_column_arg(*table, token_list[2]);
+    if (col < 0) {
+        return Token{};
+    }
+    if (token_list[3].token_type != Tokens::INTEGER) {
+        std::cerr << "error!: table-ref的行号必须是整数.\n";
+        return Token{};
+    }
+    auto row = std::get<int64_t>(token_list[3].value);
+    if (row < 0 || size_t(row) >= table->rows) {
+        std::cerr << "error!: table-ref的行号越界.\n";
+        return Token{};
+    }
+    return table->columns[size_t(col)].at(size_t(row));
+}
+
+static Bytevector* _bytevector_arg(const Token& t) {
+    if (t.token_type != Tokens::BYTEVECTOR) {
+        return nullptr;
+    }
+    return static_cast<Bytevector*>(std::get<_Ptr_Handle_t>(t.value).get());
+}
+
+// (make-bytevector n [fill])
+Token Env::_buildin_func_make_bytevector(const List& token_list) {
+    if (token_list.size() < 2 || token_list.size() > 3 || token_list[1].token_type != Tokens::INTEGER
+        || std::get<int64_t>(token_list[1].value) < 0
+        || (token_list.size() == 3
+            && (token_list[2].token_type != Tokens::INTEGER
+                || !std::in_range<uint8_t>(std::get<int64_t>(token_list[2].value))))) {
+        std::cerr << "error!: make-bytevector接受一个非负的长度和一个可选的0-255的初值.\n";
+        return Token{};
+    }
+    auto n       = size_t(std::get<int64_t>(token_list[1].value));
+    auto storage = std::make_shared<ByteStorage>(n);
+    if (token_list.size() == 3 && n > 0) {
+        std::memset(storage->data, int(std::get<int64_t>(token_list[2].value)), n);
+    }
+    Budget::local().poll(); // 填几个 GB 也不经过求值节点
+    return Token{Tokens::BYTEVECTOR, _Ptr_Handle_t(std::make_shared<Bytevector>(std::move(storage), 0, n))};
+}
+
+Token Env::_buildin_func_bytevector_length(const List& token_list) {
+    Bytevector* bv;
+    if (token_list.size() != 2 || !(bv = _bytevector_arg(token_list[1]))) {
+        std::cerr << "error!: bytevector-length接受一个bytevector.\n";
+        return Token{};
+    }
+    return Token{Tokens::INTEGER, int64_t(bv->size)};
+}
+
+// (bytevector-slice bv start [end])，和 bv 共用存储，不拷贝
+Token Env::_buildin_func_bytevector_slice(const List& token_list) {
+    Bytevector* bv;
+    if (token_list.size() < 3 || token_list.size() > 4 || !(bv = _bytevector_arg(token_list[1]))
+        || token_list[2].token_type != Tokens::INTEGER
+        || (token_list.size() == 4 && token_list[3].token_type != Tokens::INTEGER)) {
+        std::cerr << "error!: bytevector-slice接受一个bytevector、起点和可选的终点.\n";
+        return Token{};
+    }
+    auto start = std::get<int64_t>(token_list[2].value);
+    auto end   = token_list.size() == 4 ? std::get<int64_t>(token_list[3].value) : int64_t(bv->size);
+    if (start < 0 || end < start || size_t(end) > bv->size) {
+        std::cerr << "error!: bytevector-slice的范围越界.\n";
+        return Token{};
+    }
+    auto slice = std::make_shared<Bytevector>(bv->storage, bv->offset + size_t(start), size_t(end - start));
+    return Token{Tokens::BYTEVECTOR, _Ptr_Handle_t(std::move(slice))};
+}
+
+Token Env::_buildin_func_read_file_bytes(const List& token_list) {
+    if (token_list.size() != 2 || token_list[1].token_type != Tokens::STRING) {
+        std::cerr << "error!: read-file-bytes接受一个文件名.\n";
+        return Token{};
+    }
+    auto bv = read_file_bytes(std::get<Str>(token_list[1].value).str());
+    if (!bv) {
+        return Token{};
+    }
+    return Token{Tokens::BYTEVECTOR, _Ptr_Handle_t(std::move(bv))};
+}
+
+Token Env::_buildin_func_write_file_bytes(const List& token_list) {
+    Bytevector* bv;
+    if (token_list.size() != 3 || token_list[1].token_type != Tokens::STRING
+        || !(bv = _bytevector_arg(token_list[2]))) {
+        std::cerr << "error!: write-file-bytes接受一个文件名和一个bytevector.\n";
+        return Token{};
+    }
+    if (!write_file_bytes(std::get<Str>(token_list[1].value).str(), *bv)) {
+        return Token{};
+    }
+    return Token{Tokens::TRUE, 0};
+}
+
+static uint8_t _bswap(uint8_t v) {
+    return v;
+}
+static uint32_t _bswap(uint32_t v) {
+    return __builtin_bswap32(v);
+}
+static uint64_t _bswap(uint64_t v) {
+    return __builtin_bswap64(v);
+}
+
+// 可选的字节序参数，"little"(默认)或者 "big"；不认识返回 false
+static bool _endian_arg(const List& token_list, size_t i, bool& swap) {
+    bool big = false;
+    if (i < token_list.size()) {
+        if (token_list[i].token_type != Tokens::STRING) {
+            return false;
+        }
+        auto s = std::get<Str>(token_list[i].value).view();
+        if (s != "big" && s != "little") {
+            return false;
+        }
+        big = s == "big";
+    }
+    swap = big != (std::endian::native == std::endian::big);
+    return true;
+}
+
+// 取出 offset 处 sizeof(T) 个字节的位置，参数不对或者越界返回 nullptr
+static uint8_t* _bytevector_at(const List& token_list, size_t size, size_t argc, size_t endian_at, bool& swap,
+    const char* name, const char* usage) {
+    Bytevector* bv;
+    // u8 没有字节序参数
+    size_t max_argc = size == 1 ? argc : argc + 1;
+    if (token_list.size() < argc || token_list.size() > max_argc || !(bv = _bytevector_arg(token_list[1]))
+        || token_list[2].token_type != Tokens::INTEGER || !_endian_arg(token_list, endian_at, swap)) {
+        std::cerr << "error!: " << name << "接受" << usage << (size == 1 ? "" : "和可选的字节序(\"little\"或\"big\")")
+                  << ".\n";
+        return nullptr;
+    }
+    auto offset = std::get<int64_t>(token_list[2].value);
+    if (offset < 0 || size_t(offset) > bv->size || bv->size - size_t(offset) < size) {
+        std::cerr << "error!: " << name << "的偏移越界.\n";
+        return nullptr;
+    }
+    return bv->data() + offset;
+}
+
+// (bytevector-xx-ref bv offset [endian])，U 是和 T 一样大的无符号整数，用来换字节序
+template <class T, class U>
+static Token _bytevector_ref(const List& token_list, const char* name) {
+    static_assert(sizeof(T) == sizeof(U));
+    bool swap;
+    uint8_t* p = _bytevector_at(token_list, sizeof(T), 3, 3, swap, name, "一个bytevector、字节偏移");
+    if (p == nullptr) {
+        return Token{};
+    }
+    U bits;
+    std::memcpy(&bits, p, sizeof(U));
+    if (swap) {
+        bits = _bswap(bits);
+    }
+    T v;
+    std::memcpy(&v, &bits, sizeof(T));
+    if constexpr (std::is_floating_point_v<T>) {
+        return Token{Tokens::DOUBLE, double(v)};
+    } else {
+        return Token{Tokens::INTEGER, int64_t(v)};
+    }
+}
+
+// (bytevector-xx-set bv offset value [endian])，返回 bv
+template <class T, class U>
+static Token _bytevector_set(const List& token_list, const char* name) {
+    bool swap;
+    uint8_t* p = _bytevector_at(token_list, sizeof(T), 4, 4, swap, name, "一个bytevector、字节偏移、值");
+    if (p == nullptr) {
+        return Token{};
+    }
+    const auto& arg = token_list[3];
+    T v;
+    if constexpr (std::is_floating_point_v<T>) {
+        if (arg.token_type != Tokens::INTEGER && arg.token_type != Tokens::DOUBLE) {
+            std::cerr << "error!: " << name << "的值必须是数字.\n";
+            return Token{};
+        }
+        v = arg.token_type == Tokens::INTEGER ? T(std::get<int64_t>(arg.value)) : T(std::get<double>(arg.value));
+    } else {
+        if (arg.token_type != Tokens::INTEGER || !std::in_range<T>(std::get<int64_t>(arg.value))) {
+            std::cerr << "error!: " << name << "的值超出范围.\n";
+            return Token{};
+        }
+        v = T(std::get<int64_t>(arg.value));
+    }
+    U bits;
+    std::memcpy(&bits, &v, sizeof(U));
+    if (swap) {
+        bits = _bswap(bits);
+    }
+    std::memcpy(p, &bits, sizeof(U));
+    return token_list[1].copy();
+}
+
+Token Env::_buildin_func_bytevector_u8_ref(const List& token_list) {
+    return _bytevector_ref<uint8_t, uint8_t>(token_list, "bytevector-u8-ref");
+}
+Token Env::_buildin_func_bytevector_u8_set(const List& token_list) {
+    return _bytevector_set<uint8_t, uint8_t>(token_list, "bytevector-u8-set");
+}
+Token Env::_buildin_func_bytevector_u32_ref(const List& token_list) {
+    return _bytevector_ref<uint32_t, uint32_t>(token_list, "bytevector-u32-ref");
+}
+Token Env::_buildin_func_bytevector_u32_set(const List& token_list) {
+    return _bytevector_set<uint32_t, uint32_t>(token_list, "bytevector-u32-set");
+}
+Token Env::_buildin_func_bytevector_i64_ref(const List& token_list) {
+    return _bytevector_ref<int64_t, uint64_t>(token_list, "bytevector-i64-ref");
+}
+Token Env::_buildin_func_bytevector_i64_set(const List& token_list) {
+    return _bytevector_set<int64_t, uint64_t>(token_list, "bytevector-i64-set");
+}
+Token Env::_buildin_func_bytevector_f64_ref(const List& token_list) {
+    return _bytevector_ref<double, uint64_t>(token_list, "bytevector-f64-ref");
+}
+Token Env::_buildin_func_bytevector_f64_set(const List& token_list) {
+    return _bytevector_set<double, uint64_t>(token_list, "bytevector-f64-set");
+}
+
+List Env::_list_items(List&& list) {
+    List items;
+    if (list.size() < 2) {
+        return items;
+    }
+    for (size_t i = 1; i + 1 < list.size(); ++i) {
+        if (list[i].token_type != Tokens::LPAREN) {
+            items.emplace_back(std::move(list[i]));
+            continue;
+        }
+        size_t end = _element_end(list, i);
+        auto sub   = std::make_unique<List>(std::make_move_iterator(list.begin() + i),
+            std::make_move_iterator(list.begin() + end + 1));
+        items.emplace_back(Token{Tokens::LIST, std::move(sub)});
+        i = end;
+    }
+    return items;
+}
+
+List Env::_list_items(const List& list) {
+    List items;
+    if (list.size() < 2) {
+        return items;
+    }
+    for (size_t i = 1; i + 1 < list.size(); ++i) {
+        if (list[i].token_type != Tokens::LPAREN) {
+            items.emplace_back(list[i].copy());
+            continue;
+        }
+        // 子列表：找到匹配的 ')'，整体作为一个 LIST 元素
+        auto sub   = std::make_unique<List>();
+        int parens = 0;
+        do {
+            if (list[i].token_type == Tokens::LPAREN) {
+                parens++;
+            } else if (list[i].token_type == Tokens::RPAREN) {
+                parens--;
+            }
+            sub->emplace_back(list[i].copy());
+        } while (parens != 0 && ++i + 1 < list.size());
+        items.emplace_back(Token{Tokens::LIST, std::move(sub)});
+    }
+    return items;
+}
+
+void Env::_list_push(List& list, Token&& item) {
+    if (item.token_type == Tokens::LIST) {
+        for (auto& t : *std::get<_Ptr_List_t>(item.value)) {
+            list.emplace_back(std::move(t));
+        }
+    } else {
+        list.emplace_back(std::move(item));
+    }
+}
+
+Token Env::_make_list(List&& items) {
+    auto list = std::make_unique<List>();
+    list->reserve(items.size() + 2);
+    list->emplace_back(Token{Tokens::LPAREN, std::make_unique<std::string>("(")});
+    for (auto& t : items) {
+        _list_push(*list, std::move(t));
+    }
+    list->emplace_back(Token{Tokens::RPAREN, std::make_unique<std::string>(")")});
+    return Token{Tokens::LIST, std::move(list)};
+}
+
 void Env::_init_buildin_function() {
     this->add("car", Token{Tokens::_BUILDIN_CAR, 0});
     this->add("cdr", Token{Tokens::_BUILDIN_CDR, 0});
     this->add("eq", Token{Tokens::_BUILDIN_EQ, 0});
     this->add("equal", Token{Tokens::_BUILDIN_EQUAL, 0});
+    this->add("pmap", Token{Tokens::_BUILDIN_PMAP, 0});
+    this->add("preduce", Token{Tokens::_BUILDIN_PREDUCE, 0});
+    this->add("pfor-each", Token{Tokens::_BUILDIN_PFOREACH, 0});
+    this->add("spawn", Token{Tokens::_BUILDIN_SPAWN, 0});
+    this->add("await", Token{Tokens::_BUILDIN_AWAIT, 0});
+    this->add("channel", Token{Tokens::_BUILDIN_CHANNEL, 0});
+    this->add("send", Token{Tokens::_BUILDIN_SEND, 0});
+    this->add("recv", Token{Tokens::_BUILDIN_RECV, 0});
+    this->add("yield", Token{Tokens::_BUILDIN_YIELD, 0});
+    this->add("memoize", Token{Tokens::_BUILDIN_MEMOIZE, 0});
+    this->add("memo-stats", Token{Tokens::_BUILDIN_MEMO_STATS, 0});
+    this->add("memo-clear", Token{Tokens::_BUILDIN_MEMO_CLEAR, 0});
+    this->add("runtime-stats", Token{Tokens::_BUILDIN_RUNTIME_STATS, 0});
+    this->add("range", Token{Tokens::_BUILDIN_RANGE, 0});
+    this->add("lazy-map", Token{Tokens::_BUILDIN_LAZY_MAP, 0});
+    this->add("lazy-filter", Token{Tokens::_BUILDIN_LAZY_FILTER, 0});
+    this->add("take", Token{Tokens::_BUILDIN_TAKE, 0});
+    this->add("iterate", Token{Tokens::_BUILDIN_ITERATE, 0});
+    this->add("reduce", Token{Tokens::_BUILDIN_REDUCE, 0});
+    this->add("collect", Token{Tokens::_BUILDIN_COLLECT, 0});
+    this->add("length", Token{Tokens::_BUILDIN_LENGTH, 0});
+    this->add("nth", Token{Tokens::_BUILDIN_NTH, 0});
+    this->add("append", Token{Tokens::_BUILDIN_APPEND, 0});
+    this->add("reverse", Token{Tokens::_BUILDIN_REVERSE, 0});
+    this->add("map", Token{Tokens::_BUILDIN_MAP, 0});
+    this->add("filter", Token{Tokens::_BUILDIN_FILTER, 0});
+    this->add("member", Token{Tokens::_BUILDIN_MEMBER, 0});
+    this->add("assoc", Token{Tokens::_BUILDIN_ASSOC, 0});
+    this->add("string-builder", Token{Tokens::_BUILDIN_STRING_BUILDER, 0});
+    this->add("builder-append", Token{Tokens::_BUILDIN_BUILDER_APPEND, 0});
+    this->add("builder-string", Token{Tokens::_BUILDIN_BUILDER_STRING, 0});
+    this->add("string-join", Token{Tokens::_BUILDIN_STRING_JOIN, 0});
+    this->add("substring", Token{Tokens::_BUILDIN_SUBSTRING, 0});
+    this->add("string-length", Token{Tokens::_BUILDIN_STRING_LENGTH, 0});
+    this->add("display", Token{Tokens::_BUILDIN_DISPLAY, 0});
+    this->add("print", Token{Tokens::_BUILDIN_PRINT, 0});
+    this->add("format", Token{Tokens::_BUILDIN_FORMAT, 0});
+    this->add("load-csv", Token{Tokens::_BUILDIN_LOAD_CSV, 0});
+    this->add("table-rows", Token{Tokens::_BUILDIN_TABLE_ROWS, 0});
+    this->add("table-columns", Token{Tokens::_BUILDIN_TABLE_COLUMNS, 0});
+    this->add("table-column", Token{Tokens::_BUILDIN_TABLE_COLUMN, 0});
+    this->add("table-ref", Token{Tokens::_BUILDIN_TABLE_REF, 0});
+    this->add("make-bytevector", Token{Tokens::_BUILDIN_MAKE_BYTEVECTOR, 0});
+    this->add("bytevector-length", Token{Tokens::_BUILDIN_BYTEVECTOR_LENGTH, 0});
+    this->add("bytevector-slice", Token{Tokens::_BUILDIN_BYTEVECTOR_SLICE, 0});
+    this->add("read-file-bytes", Token{Tokens::_BUILDIN_READ_FILE_BYTES, 0});
+    this->add("write-file-bytes", Token{Tokens::_BUILDIN_WRITE_FILE_BYTES, 0});
+    this->add("bytevector-u8-ref", Token{Tokens::_BUILDIN_BYTEVECTOR_U8_REF, 0});
+    this->add("bytevector-u8-set", Token{Tokens::_BUILDIN_BYTEVECTOR_U8_SET, 0});
+    this->add("bytevector-u32-ref", Token{Tokens::_BUILDIN_BYTEVECTOR_U32_REF, 0});
+    this->add("bytevector-u32-set", Token{Tokens::_BUILDIN_BYTEVECTOR_U32_SET, 0});
+    this->add("bytevector-i64-ref", Token{Tokens::_BUILDIN_BYTEVECTOR_I64_REF, 0});
+    this->add("bytevector-i64-set", Token{Tokens::_BUILDIN_BYTEVECTOR_I64_SET, 0});
+    this->add("bytevector-f64-ref", Token{Tokens::_BUILDIN_BYTEVECTOR_F64_REF, 0});
+    this->add("bytevector-f64-set", Token{Tokens::_BUILDIN_BYTEVECTOR_F64_SET, 0});
+    this->add("type-report", Token{Tokens::_BUILDIN_TYPE_REPORT, 0});
+    this->add("sort", Token{Tokens::_BUILDIN_SORT, 0});
 }
 
 } // namespace austlisp
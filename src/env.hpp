@@ -1,45 +1,171 @@
 #ifndef _ENV_HPP_
 #define _ENV_HPP_
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "ast.hpp"
+#include "jit.hpp"
 #include "lexical.hpp"
+#include "runtime_stats.hpp"
 
 namespace austlisp {
 
 using std::get;
 
+struct Lambda;
+
 struct Env {
-    Env(Env* outer = nullptr) : _outer(outer) {
-        _init_buildin_function();
+    // closure 是正在执行的 lambda，它捕获的变量在这一层可见
+    Env(Env* outer = nullptr, Lambda* closure = nullptr)
+        : _outer(outer), _global(outer == nullptr ? this : outer->_global), _closure(closure) {
+        RuntimeCounters::bump(runtime_counters.env_frames);
+        if (outer == nullptr) { // 内建函数只放在全局环境里，不用每次调用都插一遍
+            _init_buildin_function();
+        }
     }
     ~Env() {
         _outer = nullptr;
     }
+    // 复制一个新的全局环境：绑定逐个深拷贝，lambda 也复制一份，两边 setq 捕获的变量互不影响。
+    // 服务模式下每个会话都从预加载好的基础环境复制
+    std::unique_ptr<Env> clone() const;
     void add(std::string name, Token&& token);
     Token* find(const std::string& name);
+    // 只看词法上可见的：本层和本层 lambda 捕获的变量，不看全局和调用链
+    Token* find_lexical(const std::string& name);
     bool update(const std::string& name, Tokens, Value&& new_value);
+    // 全局环境里 name 的绑定，没有返回 nullptr；不看词法作用域和调用链
+    Token* global_cell(const std::string& name) {
+        auto it = _global->sym_table.find(name);
+        return it == _global->sym_table.end() ? nullptr : &it->second;
+    }
+    // 原地改一个绑定，update 和缓存了全局绑定的 setq 共用
+    static void assign(Token& cell, Tokens token_type, Value&& new_value);
     const Token& operator[](const std::string& name);
     const Token& last() noexcept;
+    Env* global() noexcept {
+        return _global; // 最外层的环境
+    }
+    Lambda* closure() noexcept {
+        return _closure;
+    }
+    // let/let* 的绑定，按解析时分配的下标存取
+    List& slots() noexcept {
+        return _slots;
+    }
+    // 内建函数被 setq 重新绑定一次就加一，依赖内建函数的优化结果(常量折叠)要重新生成
+    static uint64_t buildin_epoch() noexcept {
+        return _buildin_epoch.load(std::memory_order_acquire);
+    }
 
     static Token _buildin_func_car(const List& token_list) noexcept;
     static Token _buildin_func_cdr(const List& token_list);
     static Token _buildin_func_eq(const List& token_list);
     static Token _buildin_func_equal(const List& token_list);
+    static Token _buildin_func_await(const List& token_list);
+    static Token _buildin_func_channel(const List& token_list);
+    static Token _buildin_func_send(List& token_list);
+    static Token _buildin_func_recv(const List& token_list);
+    static Token _buildin_func_yield(const List& token_list);
+    static Token _buildin_func_memoize(const List& token_list);
+    static Token _buildin_func_memo_stats(const List& token_list);
+    static Token _buildin_func_memo_clear(const List& token_list);
+    static Token _buildin_func_runtime_stats(const List& token_list);
+    static Token _buildin_func_range(const List& token_list);
+    static Token _buildin_func_lazy_map(const List& token_list);
+    static Token _buildin_func_lazy_filter(const List& token_list);
+    static Token _buildin_func_take(const List& token_list);
+    static Token _buildin_func_iterate(const List& token_list);
+    static Token _buildin_func_length(const List& token_list);
+    static Token _buildin_func_nth(const List& token_list);
+    static Token _buildin_func_append(const List& token_list);
+    static Token _buildin_func_reverse(const List& token_list);
+    static Token _buildin_func_member(const List& token_list);
+    static Token _buildin_func_assoc(const List& token_list);
+    static Token _buildin_func_string_builder(const List& token_list);
+    static Token _buildin_func_builder_append(const List& token_list);
+    static Token _buildin_func_builder_string(const List& token_list);
+    static Token _buildin_func_string_join(const List& token_list);
+    static Token _buildin_func_substring(const List& token_list);
+    static Token _buildin_func_string_length(const List& token_list);
+    static Token _buildin_func_display(const List& token_list);
+    static Token _buildin_func_print(const List& token_list);
+    static Token _buildin_func_format(const List& token_list);
+    static Token _buildin_func_load_csv(const List& token_list);
+    static Token _buildin_func_table_rows(const List& token_list);
+    static Token _buildin_func_table_columns(const List& token_list);
+    static Token _buildin_func_table_column(const List& token_list);
+    static Token _buildin_func_table_ref(const List& token_list);
+    static Token _buildin_func_make_bytevector(const List& token_list);
+    static Token _buildin_func_bytevector_length(const List& token_list);
+    static Token _buildin_func_bytevector_slice(const List& token_list);
+    static Token _buildin_func_read_file_bytes(const List& token_list);
+    static Token _buildin_func_write_file_bytes(const List& token_list);
+    static Token _buildin_func_bytevector_u8_ref(const List& token_list);
+    static Token _buildin_func_bytevector_u8_set(const List& token_list);
+    static Token _buildin_func_bytevector_u32_ref(const List& token_list);
+    static Token _buildin_func_bytevector_u32_set(const List& token_list);
+    static Token _buildin_func_bytevector_i64_ref(const List& token_list);
+    static Token _buildin_func_bytevector_i64_set(const List& token_list);
+    static Token _buildin_func_bytevector_f64_ref(const List& token_list);
+    static Token _buildin_func_bytevector_f64_set(const List& token_list);
+
+    // 列表在内部是带括号的扁平序列, '(1 (2 3)) 存为 ( 1 ( 2 3 ) )
+    static List _list_items(const List& list); // 拆出顶层元素，子列表成为一个 LIST
+    static List _list_items(List&& list); // 同上，元素直接移出来，不拷贝
+    static void _list_push(List& list, Token&& item); // 追加一个元素，LIST 会被展开
+    static Token _make_list(List&& items);
 
 protected:
     void _init_buildin_function();
 
 private:
     std::map<std::string, Token> sym_table;
-    Env* _outer;
+    Env* _outer; // 调用者，只在词法上找不到时才往这边找
+    Env* _global;
+    Lambda* _closure;
+    List _slots;
+    static inline std::atomic<uint64_t> _buildin_epoch{0};
 };
 
+struct MemoCache;
+
 struct Lambda {
     Lambda(List&& _p, List&& _b) : params(std::move(_p)), body(std::move(_b)) {}
+
+    int capture_index(const std::string& name) const noexcept {
+        for (size_t i = 0; i < capture_names.size(); ++i) {
+            if (capture_names[i] == name) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+
     List params;
     List body;
+    std::vector<StaticType> param_types; // 参数的类型标注，调用时检查；没有标注时为空
+    // 创建时把用到的外层局部变量按值拷进来，函数体里按下标访问；全局变量不捕获，调用时再找
+    std::vector<std::string> capture_names;
+    List captures;
+    std::shared_ptr<MemoCache> memo; // memoize 过的函数才有
+    JitState jit;
+
+    // 解析并优化过的函数体，第一次调用时生成，之后只读
+    struct CompiledBody {
+        std::unique_ptr<AST_base> ast;
+        uint64_t epoch; // 生成时的 Env::buildin_epoch()
+        bool loops = false; // 有 dotimes/for，第一次调用就值得编成机器码
+    };
+    std::atomic<const CompiledBody*> compiled{nullptr};
+    std::mutex compile_mutex;
+    // 重新生成后旧版本可能还有别的线程在求值，跟着 lambda 一起释放
+    std::vector<std::unique_ptr<CompiledBody>> compiled_history;
 };
 
 } // namespace austlisp
@@ -3,16 +3,30 @@
 #ifndef _EVAL_HPP_
 #define _EVAL_HPP_
 
+#include <algorithm>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "ast.hpp"
+#include "budget.hpp"
 #include "env.hpp"
+#include "infer.hpp"
 #include "lexical.hpp"
 #include "lisp.hpp"
+#include "memo.hpp"
+#include "output.hpp"
+#include "profile.hpp"
+#include "sched.hpp"
+#include "seq.hpp"
+#include "sort.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 
 #define NO_MATCHING_RPAREN std::cerr << "no matching ')'.\n"
 #define UNEXCEPTED_RPAREN  std::cerr << "unexcepted ')'.\n"
@@ -36,20 +50,6 @@ struct Eval {
 
     Eval(Env* env) : env(env), paren_stack(0) {}
 
-private:
-    struct AST_base {
-        AST_base() = default;
-        AST_base(Token&& _t) : t(std::move(_t)) {}
-        virtual ~AST_base() = default; // 没有什么意义，就是为了用 dynmaic_cast
-        Token t;
-        std::unique_ptr<AST_base> left;
-        std::unique_ptr<AST_base> right;
-    };
-    struct AST_if : public AST_base {
-        std::unique_ptr<AST_base> cond;
-    };
-
-public:
     constexpr bool match_rparen(const Token& t) noexcept {
         return t.token_type == Tokens::RPAREN;
     }
@@ -98,6 +98,14 @@ public:
             node->right        = parser(token_list, ++t);
             paren_handler();
             break;
+        case Tokens::LOW:
+        case Tokens::GREAT:
+            node               = std::make_unique<AST_base>();
+            node->t.token_type = token_list[t].token_type;
+            node->left         = parser(token_list, ++t);
+            node->right        = parser(token_list, ++t);
+            paren_handler();
+            break;
         case Tokens::INTEGER:
             node               = std::make_unique<AST_base>();
             node->t.token_type = Tokens::INTEGER;
@@ -120,7 +128,7 @@ public:
             return node;
         case Tokens::FALSE:
             node               = std::make_unique<AST_base>();
-            node->t.token_type = Tokens::TRUE;
+            node->t.token_type = Tokens::FALSE;
             node->t.value      = 0;
             return node;
         case Tokens::K_IF:
@@ -129,16 +137,25 @@ public:
                 if_node->t.token_type = Tokens::K_IF;
                 if_node->cond         = parser(token_list, ++t);
                 if_node->left         = parser(token_list, ++t);
-                if_node->right        = parser(token_list, ++t);
-                return if_node;
+                // 没有 else 分支时结果是 nil
+                if (t + 1 < token_list.size() && match_rparen(token_list[t + 1])) {
+                    if_node->right = std::make_unique<AST_base>(Token{});
+                } else {
+                    if_node->right = parser(token_list, ++t);
+                }
+                node = std::move(if_node);
+                // 把自己的 ')' 吃掉，这样 if 才能出现在 (+ (if ...) 1) 这样的位置
+                paren_handler();
+                break;
             }
         case Tokens::K_WHILE:
             {
-                auto loop_node = std::make_unique<AST_base>();
-                loop_node->t.token_type = Tokens::K_WHILE;
-                loop_node->left = parser(token_list, ++t);
-                loop_node->right = parser(token_list, ++t);
-                return loop_node;
+                node               = std::make_unique<AST_base>();
+                node->t.token_type = Tokens::K_WHILE;
+                node->left         = parser(token_list, ++t);
+                node->right        = parser(token_list, ++t);
+                paren_handler();
+                break;
             }
         case Tokens::QUOTE:
             {
@@ -205,7 +222,13 @@ public:
                     std::cerr << "error!: setq后必须跟一个符号名称.\n";
                     return std::make_unique<AST_base>(Token{});
                 }
-                node->left  = std::make_unique<AST_base>(std::move(token_list[t]));
+                if (auto slot = _let_slot(*std::get<_Ptr_Str_t>(token_list[t].value)); slot >= 0) {
+                    node->left = std::make_unique<AST_base>(Token{Tokens::IDENT_LOCAL, int64_t(slot)});
+                } else if (!_locally_bound(*std::get<_Ptr_Str_t>(token_list[t].value))) {
+                    node->left = std::make_unique<AST_global>(Token{Tokens::IDENT_GLOBAL, std::move(token_list[t].value)});
+                } else {
+                    node->left = std::make_unique<AST_base>(std::move(token_list[t]));
+                }
                 node->right = parser(token_list, ++t);
                 if (node->right->t.token_type == Tokens::NONE) {
                     std::cerr << "error!: setq需要一个赋给变量的值.\n";
@@ -220,7 +243,11 @@ public:
                  *      /      \
                  * [params]   [body] */
 
-                node               = std::make_unique<AST_base>();
+                auto lambda_node = std::make_unique<AST_lambda>();
+                for (size_t i = 0; i < _let_names.size(); ++i) {
+                    lambda_node->let_scope.emplace_back(_let_names[i], i);
+                }
+                node               = std::move(lambda_node);
                 node->t.token_type = Tokens::K_LAMBDA;
 
                 // params
@@ -229,8 +256,31 @@ public:
                     return std::make_unique<AST_base>(Token{});
                 }
                 auto params = std::make_unique<List>();
+                std::vector<StaticType> types;
+                bool annotated = false;
                 while (token_list[++t].token_type != Tokens::RPAREN && t < token_list.size()) {
-                    params->emplace_back(std::move(token_list[t]));
+                    if (token_list[t].token_type != Tokens::LPAREN) {
+                        params->emplace_back(std::move(token_list[t]));
+                        types.emplace_back(StaticType::ANY);
+                        continue;
+                    }
+                    // (n int) / (x double)：带类型标注的参数
+                    auto type = t + 3 < token_list.size() && token_list[t + 1].token_type == Tokens::IDENT
+                                     && token_list[t + 2].token_type == Tokens::IDENT
+                                     && match_rparen(token_list[t + 3])
+                                  ? _annotation(*std::get<_Ptr_Str_t>(token_list[t + 2].value))
+                                  : StaticType::NONE;
+                    if (type == StaticType::NONE) {
+                        std::cerr << "error!: 参数的类型标注必须是 (名字 int) 或者 (名字 double).\n";
+                        return std::make_unique<AST_base>(Token{});
+                    }
+                    params->emplace_back(std::move(token_list[t + 1]));
+                    types.emplace_back(type);
+                    annotated = true;
+                    t += 3;
+                }
+                if (annotated) {
+                    static_cast<AST_lambda*>(node.get())->param_types = std::move(types);
                 }
                 node->left = std::make_unique<AST_base>(Token{Tokens::LIST, std::move(params)});
 
@@ -259,39 +309,139 @@ public:
                 if (paren_holder != paren_stack) {
                     NO_MATCHING_RPAREN;
                     return std::make_unique<AST_base>(Token{});
-                } else if (t + paren_stack != token_list.size() - 1) {
-                    UNEXCEPTED_RPAREN;
-                    return std::make_unique<AST_base>(Token{});
                 }
                 node->right = std::make_unique<AST_base>(Token{Tokens::LIST, std::move(body)});
-                return node;
+                // 和其他形式一样把自己的 ')' 吃掉，这样 lambda 才能作为实参出现在调用中间
+                paren_handler();
+                break;
+            }
+        case Tokens::K_LET:
+        case Tokens::K_LET_STAR:
+            {
+                // (let ((a 1) (b (+ a 1))) body...)，名字在解析时就换成帧里的 slot 下标
+                auto let_node          = std::make_unique<AST_let>();
+                let_node->t.token_type = token_list[t].token_type;
+                bool sequential        = let_node->t.token_type == Tokens::K_LET_STAR;
+                size_t scope           = _let_names.size();
+                auto fail              = [&](const char* msg) {
+                    std::cerr << msg;
+                    _let_names.resize(scope);
+                    return std::make_unique<AST_base>(Token{});
+                };
+                if (t + 1 >= token_list.size() || token_list[++t].token_type != Tokens::LPAREN) {
+                    return fail("error!: let后面必须是一个绑定列表.\n");
+                }
+                let_node->base = scope;
+                std::vector<std::string> names;
+                while (t + 1 < token_list.size() && token_list[++t].token_type == Tokens::LPAREN) {
+                    if (t + 2 >= token_list.size() || token_list[++t].token_type != Tokens::IDENT) {
+                        return fail("error!: let的每个绑定必须是 (名字 初值).\n");
+                    }
+                    auto name = *std::get<_Ptr_Str_t>(token_list[t].value);
+                    let_node->names.emplace_back(name);
+                    let_node->inits.emplace_back(parser(token_list, ++t));
+                    if (t + 1 >= token_list.size() || !match_rparen(token_list[++t])) {
+                        return fail("error!: let的每个绑定必须是 (名字 初值).\n");
+                    }
+                    // let 的初值都在外层作用域里求值，let* 的初值能看到前面的绑定
+                    if (sequential) {
+                        _let_names.emplace_back(std::move(name));
+                    } else {
+                        names.emplace_back(std::move(name));
+                    }
+                }
+                if (!match_rparen(token_list[t])) {
+                    return fail("error!: let的绑定列表没有闭合.\n");
+                }
+                for (auto& name : names) {
+                    _let_names.emplace_back(std::move(name));
+                }
+                while (t + 1 < token_list.size() && !match_rparen(token_list[t + 1])) {
+                    let_node->body.emplace_back(parser(token_list, ++t));
+                }
+                _let_names.resize(scope);
+                if (t + 1 >= token_list.size()) {
+                    NO_MATCHING_RPAREN;
+                    return std::make_unique<AST_base>(Token{});
+                }
+                node = std::move(let_node);
+                paren_handler();
+                break;
+            }
+        case Tokens::K_DOTIMES:
+        case Tokens::K_FOR:
+            {
+                // (dotimes (i n) body...) / (for (i from to [step]) body...)，i 和 let 一样占一个 slot
+                auto loop          = std::make_unique<AST_loop>();
+                loop->t.token_type = token_list[t].token_type;
+                _parsed_loop       = true;
+                bool ranged        = loop->t.token_type == Tokens::K_FOR;
+                if (t + 2 >= token_list.size() || token_list[++t].token_type != Tokens::LPAREN
+                    || token_list[++t].token_type != Tokens::IDENT) {
+                    std::cerr << (ranged ? "error!: for后面必须是 (变量 起点 终点 [步长]).\n"
+                                         : "error!: dotimes后面必须是 (变量 次数).\n");
+                    return std::make_unique<AST_base>(Token{});
+                }
+                auto name = *std::get<_Ptr_Str_t>(token_list[t].value);
+                // 范围在外层作用域里求值，看不见循环变量
+                if (ranged) {
+                    loop->from = parser(token_list, ++t);
+                }
+                loop->to = parser(token_list, ++t);
+                if (ranged && t + 1 < token_list.size() && !match_rparen(token_list[t + 1])) {
+                    loop->step = parser(token_list, ++t);
+                }
+                if (t + 1 >= token_list.size() || !match_rparen(token_list[++t])) {
+                    std::cerr << "error!: 循环的范围没有闭合.\n";
+                    return std::make_unique<AST_base>(Token{});
+                }
+                size_t scope = _let_names.size();
+                loop->slot   = scope;
+                loop->name   = name;
+                _let_names.emplace_back(std::move(name));
+                while (t + 1 < token_list.size() && !match_rparen(token_list[t + 1])) {
+                    loop->body.emplace_back(parser(token_list, ++t));
+                }
+                _let_names.resize(scope);
+                if (t + 1 >= token_list.size()) {
+                    NO_MATCHING_RPAREN;
+                    return std::make_unique<AST_base>(Token{});
+                }
+                node = std::move(loop);
+                paren_handler();
+                break;
             }
         case Tokens::IDENT:
             {
                 using _Ptr_Str_t = std::unique_ptr<std::string>;
-                node             = std::make_unique<AST_base>();
                 // 前面是一个 '(' 说明是一个调用
-                if (t - 1 >= 0 && token_list[t - 1].token_type == Tokens::LPAREN) {
-                    node->t.token_type = Tokens::IDENT_C;
-                    auto params_list   = std::make_unique<List>();
-                    params_list->emplace_back(token_list[t].copy());
-                    Token tmp{};
-                    int paren_holder = this->paren_stack;
-                    // auto res = parser(token_list, t);
-                    // tmp      = eval(res);
-                    // (area 2 '(2 2))
-                    do {
-                        switch (token_list[++t].token_type) {
-                        case Tokens::LPAREN:
-                            paren_holder++;
-                            break;
-                        case Tokens::RPAREN:
-                            paren_holder--;
-                            break;
-                        }
-                        params_list->emplace_back(token_list[t]);
-                    } while (!(token_list[t].token_type == Tokens::RPAREN && paren_holder == paren_stack - 1));
-                    node->t.value = std::move(params_list);
+                if (t > 0 && token_list[t - 1].token_type == Tokens::LPAREN) {
+                    // (area 2 '(2 2))：实参现在就解析好，求值时不用每次重新解析
+                    auto call    = std::make_unique<AST_call>();
+                    call->global = !_locally_bound(*std::get<_Ptr_Str_t>(token_list[t].value));
+                    call->t      = Token{Tokens::IDENT_C, std::move(token_list[t].value)};
+                    while (t + 1 < token_list.size() && !match_rparen(token_list[t + 1])) {
+                        call->args.emplace_back(parser(token_list, ++t));
+                    }
+                    if (t + 1 >= token_list.size()) {
+                        NO_MATCHING_RPAREN;
+                        return std::make_unique<AST_base>(Token{});
+                    }
+                    node = std::move(call);
+                    paren_handler();
+                }
+                node = std::make_unique<AST_base>();
+                if (auto slot = _let_slot(*std::get<_Ptr_Str_t>(token_list[t].value)); slot >= 0) {
+                    node->t.token_type = Tokens::IDENT_LOCAL;
+                    node->t.value      = int64_t(slot);
+                } else if (int index = _capture_index(*std::get<_Ptr_Str_t>(token_list[t].value)); index >= 0) {
+                    // 捕获的变量解析成下标，求值时不用再按名字找
+                    node->t.token_type = Tokens::IDENT_CAPTURED;
+                    node->t.value      = int64_t(index);
+                } else if (!_locally_bound(*std::get<_Ptr_Str_t>(token_list[t].value))) {
+                    // 全局变量，第一次求值时把全局环境里的绑定地址记在节点上
+                    node = std::make_unique<AST_global>(
+                        Token{Tokens::IDENT_GLOBAL, std::make_unique<std::string>(*std::get<_Ptr_Str_t>(token_list[t].value))});
                 } else {
                     node->t.token_type = Tokens::IDENT;
                     auto ident_name = *std::get<_Ptr_Str_t>(token_list[t].value);
@@ -308,8 +458,173 @@ public:
         return std::make_unique<AST_base>(Token{});
     }
 
+    // -O0 什么都不做，-O1 常量折叠，-O2(默认) 再加上热点数值 lambda 的 JIT
+    static void set_opt_level(int level) noexcept {
+        _opt_level = level;
+    }
+
+    // parser + optimize，求值前都走这里
+    std::unique_ptr<AST_base> compile(std::vector<Token>& token_list, size_t& t) {
+        auto node = parser(token_list, t);
+        optimize_top(node);
+        return node;
+    }
+    // 一次顶层求值：按命令行给的限制开一份预算，超限时报错并返回 nil
+    Token eval_top(const std::unique_ptr<AST_base>& node) {
+        Budget::Scope scope;
+        try {
+            return eval(node);
+        } catch (const BudgetExceeded& e) {
+            std::cerr << "error!: " << e.what() << ".\n";
+            return Token{};
+        } catch (const TypeMismatch& e) {
+            std::cerr << "error!: " << e.what() << ".\n";
+            return Token{};
+        }
+    }
+    // 优化要查全局环境里的内建函数，并行加载时解析在工作线程里做，这一步留给求值线程按顺序做
+    void optimize_top(std::unique_ptr<AST_base>& node) {
+        if (_opt_level > 0) {
+            optimize(node);
+            infer_types(node);
+        }
+    }
+    // 类型推断，放在常量折叠后面，返回没能特化的运算。函数体里参数的类型来自 lambda 的标注，被 define 挡住的参数不算
+    std::vector<std::string> infer_types(std::unique_ptr<AST_base>& node) {
+        static const List no_params;
+        auto closure = env->closure();
+        std::vector<StaticType> types;
+        if (closure != nullptr) {
+            types = closure->param_types;
+            types.resize(closure->params.size(), StaticType::ANY);
+            const auto& body = closure->body;
+            for (size_t i = 0; i + 1 < body.size(); ++i) {
+                if (body[i].token_type != Tokens::K_DEFINE || body[i + 1].token_type != Tokens::IDENT) {
+                    continue;
+                }
+                for (size_t p = 0; p < closure->params.size(); ++p) {
+                    if (*std::get<_Ptr_Str_t>(closure->params[p].value) == *std::get<_Ptr_Str_t>(body[i + 1].value)) {
+                        types[p] = StaticType::ANY;
+                    }
+                }
+            }
+        }
+        TypeInfer infer(closure != nullptr ? closure->params : no_params, std::move(types));
+        infer.run(node);
+        return std::move(infer.unspecialized);
+    }
+
+    /**
+     * @brief
+     *  常量折叠：字面量之间的四则运算和比较直接算出结果，条件是字面量的 if 只留下会走的分支，
+     *  参数都是字面量的 equal/eq 提前求值。用的都是求值时同一套 do_* 函数，所以结果和 -O0 一致。
+     *  整数除以 0 不折叠，留到运行时报错。
+     */
+    void optimize(std::unique_ptr<AST_base>& node) {
+        if (!node) {
+            return;
+        }
+        switch (node->t.token_type) {
+        case Tokens::QUOTE:
+        case Tokens::K_LAMBDA: // body 第一次调用时才解析，到时候再优化
+            return;
+        case Tokens::K_DEFINE:
+        case Tokens::K_SETQ:
+            optimize(node->right);
+            return;
+        case Tokens::K_IF:
+            {
+                auto if_node = static_cast<AST_if*>(node.get());
+                optimize(if_node->cond);
+                optimize(node->left);
+                optimize(node->right);
+                if (_is_literal(if_node->cond)) {
+                    // 和 do_condition 一样，只有 TRUE 走 then 分支
+                    bool then_branch = if_node->cond->t.token_type == Tokens::TRUE;
+                    auto taken       = std::move(then_branch ? node->left : node->right);
+                    if (taken) {
+                        node = std::move(taken);
+                    }
+                }
+                return;
+            }
+        case Tokens::IDENT_C:
+            for (auto& arg : static_cast<AST_call*>(node.get())->args) {
+                optimize(arg);
+            }
+            _fold_equal(node);
+            return;
+        case Tokens::K_LET:
+        case Tokens::K_LET_STAR:
+            {
+                auto let = static_cast<AST_let*>(node.get());
+                for (auto& init : let->inits) {
+                    optimize(init);
+                }
+                for (auto& form : let->body) {
+                    optimize(form);
+                }
+                return;
+            }
+        case Tokens::K_DOTIMES:
+        case Tokens::K_FOR:
+            {
+                auto loop = static_cast<AST_loop*>(node.get());
+                optimize(loop->from);
+                optimize(loop->to);
+                optimize(loop->step);
+                for (auto& form : loop->body) {
+                    optimize(form);
+                }
+                return;
+            }
+        case Tokens::PLUS:
+        case Tokens::MINUS:
+        case Tokens::STAR:
+        case Tokens::DIVISION:
+        case Tokens::LOW:
+        case Tokens::GREAT:
+            break;
+        default:
+            optimize(node->left);
+            optimize(node->right);
+            return;
+        }
+
+        optimize(node->left);
+        optimize(node->right);
+        if (!_is_number(node->left) || !_is_number(node->right)) {
+            return;
+        }
+        auto tt = node->t.token_type;
+        if (tt == Tokens::DIVISION && node->right->t.token_type == Tokens::INTEGER
+            && std::get<int64_t>(node->right->t.value) == 0) {
+            return;
+        }
+        Token left  = node->left->t.copy();
+        Token right = node->right->t.copy();
+        Token folded;
+        switch (tt) {
+        case Tokens::PLUS:
+            folded = do_plus(std::move(left), std::move(right));
+            break;
+        case Tokens::MINUS:
+            folded = do_minus(std::move(left), std::move(right));
+            break;
+        case Tokens::STAR:
+            folded = do_multiple(std::move(left), std::move(right));
+            break;
+        case Tokens::DIVISION:
+            folded = do_division(std::move(left), std::move(right));
+            break;
+        default:
+            folded = do_compare(tt, std::move(left), std::move(right));
+            break;
+        }
+        node = std::make_unique<AST_base>(std::move(folded));
+    }
+
     Token do_plus(Token&& left, Token&& right) noexcept {
-        using _STR_ptr = std::unique_ptr<std::string>;
         Token ret{};
         if ((left.token_type == Tokens::DOUBLE || left.token_type == Tokens::INTEGER)
             && (right.token_type == Tokens::DOUBLE || right.token_type == Tokens::INTEGER)) {
@@ -337,8 +652,7 @@ public:
             }
         } else if (left.token_type == Tokens::STRING && right.token_type == Tokens::STRING) {
             ret.token_type = Tokens::STRING;
-            ret.value =
-                std::make_unique<std::string>(*std::get<_STR_ptr>(left.value) + *std::get<_STR_ptr>(right.value));
+            ret.value      = Str::concat(std::get<Str>(left.value).view(), std::get<Str>(right.value).view());
         } else {
             std::cerr << "不是可加的类型！\n";
         }
@@ -435,135 +749,917 @@ public:
                 v2        = _type_helper(right);
                 ret.value = v1 / v2;
             } else {
+                auto l = std::get<int64_t>(left.value), r = std::get<int64_t>(right.value);
+                if (r == 0) {
+                    std::cerr << "error!: 整数除以0.\n";
+                    return Token{};
+                }
                 ret.token_type = Tokens::INTEGER;
-                ret.value      = std::get<int64_t>(left.value) / std::get<int64_t>(right.value);
+                // INT64_MIN / -1 在硬件上会溢出成 SIGFPE，按补码回绕，和加减乘一样
+                ret.value = (l == INT64_MIN && r == -1) ? l : l / r;
             }
         } else {
             std::cerr << "不是可乘的类型！\n";
         }
         return ret;
     }
-    Token do_define(Token&& left, Token&& right, Env* env) {
+    // (< a b) / (> a b)，数字之间按数值比，字符串按字典序
+    Token do_compare(Tokens op, Token&& left, Token&& right) noexcept {
+        auto is_number = [](const Token& t) {
+            return t.token_type == Tokens::INTEGER || t.token_type == Tokens::DOUBLE;
+        };
+        int cmp = 0;
+        if (left.token_type == Tokens::INTEGER && right.token_type == Tokens::INTEGER) {
+            auto l = std::get<int64_t>(left.value), r = std::get<int64_t>(right.value);
+            cmp    = (l > r) - (l < r);
+        } else if (is_number(left) && is_number(right)) {
+            auto as_double = [](const Token& t) {
+                return t.token_type == Tokens::DOUBLE ? std::get<double>(t.value)
+                                                      : static_cast<double>(std::get<int64_t>(t.value));
+            };
+            double l = as_double(left), r = as_double(right);
+            cmp      = (l > r) - (l < r);
+        } else if (left.token_type == Tokens::STRING && right.token_type == Tokens::STRING) {
+            cmp = std::get<Str>(left.value).view().compare(std::get<Str>(right.value).view());
+        } else {
+            std::cerr << "不是可比较的类型！\n";
+            return Token{};
+        }
+        bool res = op == Tokens::LOW ? cmp < 0 : cmp > 0;
+        return res ? Token{Tokens::TRUE, 1} : Token{Tokens::FALSE, 0};
+    }
+
+    Token do_define(const Token& left, Token&& right, Env* env) {
+        AUSTLISP_TRACE_EVENT(DEFINE, *std::get<std::unique_ptr<std::string>>(left.value));
         env->add(*std::get<std::unique_ptr<std::string>>(left.value), std::move(right));
         return Token{Tokens::K_DEFINE, 0};
     }
-    Token do_while(AST_base* loop_node, Env* env) {
-        auto cond = eval(loop_node->left);
-        cond = eval(loop_node->left);
+    // 条件每轮只求一次
+    Token do_while(const AST_base* loop_node) {
         Token ret{};
-        while (cond.token_type != Tokens::FALSE) {
+        while (eval(loop_node->left).token_type != Tokens::FALSE) {
             ret = eval(loop_node->right);
-            cond = eval(loop_node->left);
         }
         return ret;
     }
-    Token do_setq(Token&& left, Token&& right, Env* env) {
+    // 计数器留在 C++ 的 int64 里，每轮只把值写进 slot，不经过 setq 和符号表
+    Token do_loop(const AST_loop* loop, Env* env) {
+        auto bound = [&](const std::unique_ptr<AST_base>& node, int64_t fallback, int64_t& out) {
+            if (!node) {
+                out = fallback;
+                return true;
+            }
+            auto v = eval(node);
+            if (v.token_type != Tokens::INTEGER) {
+                std::cerr << "error!: 循环的范围必须是整数.\n";
+                return false;
+            }
+            out = std::get<int64_t>(v.value);
+            return true;
+        };
+        int64_t i = 0, end = 0, step = 1;
+        if (!bound(loop->from, 0, i) || !bound(loop->to, 0, end) || !bound(loop->step, 1, step)) {
+            return Token{};
+        }
+        if (step == 0) {
+            std::cerr << "error!: for的步长不能是0.\n";
+            return Token{};
+        }
+        if (env->slots().size() <= loop->slot) {
+            env->slots().resize(loop->slot + 1);
+        }
+        while (step > 0 ? i < end : i > end) {
+            // body 里的 let 可能让 slots 扩容，引用每轮重新取
+            auto& var      = env->slots()[loop->slot];
+            var.token_type = Tokens::INTEGER;
+            var.value      = i;
+            for (const auto& form : loop->body) {
+                eval(form);
+            }
+            if (__builtin_add_overflow(i, step, &i)) {
+                break;
+            }
+        }
+        env->slots()[loop->slot] = Token{};
+        return Token{};
+    }
+    // 绑定直接写进帧的 slot，不碰符号表；body 求完以后清掉，里面的大对象不会一直挂在帧上
+    Token do_let(const AST_let* let, Env* env) {
+        size_t n = let->inits.size();
+        if (env->slots().size() < let->base + n) {
+            env->slots().resize(let->base + n);
+        }
+        if (let->t.token_type == Tokens::K_LET_STAR) {
+            for (size_t i = 0; i < n; ++i) {
+                auto value                      = eval(let->inits[i]);
+                env->slots()[let->base + i] = std::move(value);
+            }
+        } else {
+            List values;
+            values.reserve(n);
+            for (const auto& init : let->inits) {
+                values.emplace_back(eval(init));
+            }
+            for (size_t i = 0; i < n; ++i) {
+                env->slots()[let->base + i] = std::move(values[i]);
+            }
+        }
+        Token ret{};
+        for (const auto& form : let->body) {
+            ret = eval(form);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            env->slots()[let->base + i] = Token{};
+        }
+        return ret;
+    }
+    Token do_setq(const Token& left, Token&& right, Env* env) {
+        AUSTLISP_TRACE_EVENT(SETQ, *std::get<_Ptr_Str_t>(left.value));
         env->update(*std::get<_Ptr_Str_t>(left.value), right.token_type, std::move(right.value));
         return Token{};
     }
     Token _func_call(Lambda* func, List& params, Env* outer_env) {
+        DepthGuard depth;
+        if (!func->param_types.empty() && !_check_param_types(func, params)) {
+            return Token{};
+        }
+        if (func->memo) {
+            // 实参在下面会被移进局部环境，所以先留一份做缓存的 key
+            List key(params.begin() + 1, params.end());
+            if (auto hit = func->memo->lookup(key)) {
+                return std::move(*hit);
+            }
+            auto ret = _func_call_uncached(func, params, outer_env);
+            // 出错的(nil)不缓存：可能是用到的全局变量还没定义，定义以后要重新算
+            if (ret.token_type != Tokens::NONE) {
+                func->memo->insert(std::move(key), ret.copy());
+            }
+            return ret;
+        }
+        return _func_call_uncached(func, params, outer_env);
+    }
+    Token _func_call_uncached(Lambda* func, List& params, Env* outer_env) {
         using _Ptr_Str_t = std::unique_ptr<std::string>;
-        auto local_env   = std::make_unique<Env>(outer_env);
+        auto local_env   = std::make_unique<Env>(outer_env, func);
         auto local_eval  = std::make_unique<Eval>(local_env.get());
 
         for (int i = 1; i < params.size(); ++i) {
             local_env->add(*std::get<_Ptr_Str_t>(func->params[i - 1].value), std::move(params[i]));
         }
-        size_t count      = 0;
-        auto _holder_body = func->body;
-        return local_eval->eval(local_eval->parser(_holder_body, count));
+        return local_eval->eval(local_eval->_compiled_body(func));
     }
-    Token do_getident_Call(const Token& ident, Env* env) {
-        using _Ptr_List_t = std::unique_ptr<List>;
-        using _Ptr_Str_t  = std::unique_ptr<std::string>;
-        std::unique_ptr<AST_base> res;
-        // DONE: 把求参数推迟到这里，前面就是记录参数
-        auto& contain    = *std::get<_Ptr_List_t>(ident.value);
-        const auto& name = *std::get<_Ptr_Str_t>(contain.at(0).value);
 
-        size_t count = 0; // ignore indent name
-        List _params_list{};
-        _params_list.emplace_back(contain.at(0));
-        while (contain[++count].token_type != Tokens::RPAREN) {
-            // 我不得不放弃之前使用引用的想法，除非我再添加一个字符串字面量的类型，但我不想再在为
-            // 这个项目花更多的时间了。一个没有注册到sym_table中的字面量在用了智能指针管理内存的情况下
-            // 其挂在AST上的Token会在出当前作用域就被释放掉，这将引发很多问题，包括让我之前在eq，equal函数上的
-            // 工作白费了，所以Token的reference函数目前只对define过的变量有效果，实际上在当前代码下弃用了
-            // 除非我在花精力搞字符串字面量的token_type。
-            // 也怪我没有做好前期的设计😡，C++写一个解释器比我预想的要麻烦很多。
-            // Anyway, 就这样吧。
-            auto res  = parser(contain, count);
-            Token tmp = eval(res);
-            _params_list.emplace_back(std::move(tmp));
+    // 函数体只解析、优化一次，缓存在 Lambda 上。env 必须是 func 自己的调用帧，捕获的变量才能解析成下标。
+    // 内建函数被重新绑定过(epoch 变了)就重新生成，因为 (equal 1 1) 这种折叠的结果可能不对了
+    const std::unique_ptr<AST_base>& _compiled_body(Lambda* func) {
+        auto epoch = Env::buildin_epoch();
+        auto body  = func->compiled.load(std::memory_order_acquire);
+        if (body != nullptr && body->epoch == epoch) {
+            return body->ast;
+        }
+        std::lock_guard<std::mutex> lock(func->compile_mutex);
+        body = func->compiled.load(std::memory_order_relaxed);
+        if (body == nullptr || body->epoch != epoch) {
+            List tokens  = func->body;
+            size_t count = 0;
+            _parsed_loop = false;
+            auto ast     = compile(tokens, count);
+            auto fresh   = std::make_unique<Lambda::CompiledBody>(Lambda::CompiledBody{std::move(ast), epoch, _parsed_loop});
+            body         = fresh.get();
+            func->compiled_history.emplace_back(std::move(fresh));
+            func->compiled.store(body, std::memory_order_release);
+        }
+        return body->ast;
+    }
+    // 给内建函数用的：args 里只有实参，不带函数名
+    Token _apply(Lambda* func, List&& args, Env* env) {
+        static const std::string anonymous = "<lambda>";
+        ProfileScope _profile_scope("<lambda>"); // 作为参数传进来的函数没有名字
+        List params;
+        params.reserve(args.size() + 1);
+        params.emplace_back(Token{});
+        for (auto& arg : args) {
+            params.emplace_back(std::move(arg));
+        }
+        if (!_check_arity(func, params, anonymous)) {
+            return Token{};
         }
+        return _func_call(func, params, env);
+    }
+    Token _apply(Lambda* func, Token&& arg, Env* env) {
+        List args;
+        args.emplace_back(std::move(arg));
+        return _apply(func, std::move(args), env);
+    }
 
-        auto tt = env->find(name);
-        if (tt != nullptr) {
-            // std::cout << "BIG FUCK LAMBDA.\n";
-            switch (tt->token_type) {
-            case Tokens::K_LAMBDA:
-                {
-                    auto _lambda = std::get<std::unique_ptr<Lambda>>(tt->value).get();
-                    return _func_call(_lambda, _params_list, env);
-                }
-            case Tokens::_BUILDIN_CAR:
-                return env->_buildin_func_car(_params_list);
-            case Tokens::_BUILDIN_CDR:
-                return env->_buildin_func_cdr(_params_list);
-            case Tokens::_BUILDIN_EQ:
-                try {
-                    return env->_buildin_func_eq(_params_list);
-                } catch (std::logic_error* e) {
-                    e->what();
-                    return Token{};
-                }
-            case Tokens::_BUILDIN_EQUAL:
-                try {
-                    return env->_buildin_func_equal(_params_list);
-                } catch (std::logic_error* e) {
-                    e->what();
-                    return Token{};
-                }
-            default:
-                std::cerr << "未知的lambda:" << name << '\n';
-                return Token{};
+    // 元素少于 _PAR_SEQ_CUTOFF 时直接在当前线程顺序执行，开线程不划算
+    static constexpr size_t _PAR_SEQ_CUTOFF = 64;
+
+    static size_t _par_grain(size_t n) noexcept {
+        // 每个 worker 大约分到 4 块，方便偷任务做负载均衡
+        return std::max(_PAR_SEQ_CUTOFF / 4, n / (ThreadPool::instance().size() * 4));
+    }
+
+    // pmap/preduce/pfor-each 的参数检查，返回 lambda，失败返回 nullptr
+    static Lambda* _par_check(const List& params, size_t argc, const char* name) {
+        if (params.size() != argc || params[1].token_type != Tokens::K_LAMBDA
+            || params.back().token_type != Tokens::LIST) {
+            std::cerr << "error!: " << name << "接受一个lambda和一个列表.\n";
+            return nullptr;
+        }
+        return std::get<_Ptr_Lambda_t>(params[1].value).get();
+    }
+
+    // (pmap f list)
+    Token do_pmap(List& params, Env* env) {
+        auto func = _par_check(params, 3, "pmap");
+        if (func == nullptr) {
+            return Token{};
+        }
+        auto items = Env::_list_items(*std::get<_Ptr_List_t>(params[2].value));
+        List out(items.size());
+        auto body = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                out[i] = _apply(func, std::move(items[i]), env);
             }
+        };
+        if (items.size() < _PAR_SEQ_CUTOFF) {
+            body(0, items.size());
         } else {
-            std::cerr << "没有发现变量：" << name << '\n';
-            return Token{};
+            ThreadPool::instance().parallel_for(items.size(), _par_grain(items.size()), body);
         }
+        // 有一个元素出错(返回 nil)整个调用就算失败，不把 nil 塞进结果
+        for (size_t i = 0; i < out.size(); ++i) {
+            if (out[i].token_type == Tokens::NONE) {
+                std::cerr << "error!: pmap在第" << i << "个元素上失败.\n";
+                return Token{};
+            }
+        }
+        return Env::_make_list(std::move(out));
     }
 
-    Token do_getident(const std::string& name, Env* env) {
-        auto tt = env->find(name);
-        if (tt != nullptr) {
-            // 复杂类型返回引用，基本类型复制
-            switch (tt->token_type) {
-            case Tokens::INTEGER:
-            case Tokens::DOUBLE:
-                return tt->copy();
-            case Tokens::LIST:
-            case Tokens::STRING:
-                return tt->copy();
-            default:
-                return tt->copy();
+    // (pfor-each f list)，只为了副作用，返回 nil
+    Token do_pfor_each(List& params, Env* env) {
+        auto func = _par_check(params, 3, "pfor-each");
+        if (func == nullptr) {
+            return Token{};
+        }
+        auto items = Env::_list_items(*std::get<_Ptr_List_t>(params[2].value));
+        auto body  = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                _apply(func, std::move(items[i]), env);
             }
+        };
+        if (items.size() < _PAR_SEQ_CUTOFF) {
+            body(0, items.size());
         } else {
-            std::cerr << "没有发现变量：" << name << '\n';
+            ThreadPool::instance().parallel_for(items.size(), _par_grain(items.size()), body);
+        }
+        return Token{};
+    }
+
+    // (preduce f init list)，f 必须满足结合律：每块先各自归约，最后从 init 开始按顺序合并
+    Token do_preduce(List& params, Env* env) {
+        auto func = _par_check(params, 4, "preduce");
+        if (func == nullptr) {
             return Token{};
         }
+        auto items = Env::_list_items(*std::get<_Ptr_List_t>(params[3].value));
+        auto fold  = [&](Token acc, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                List args;
+                args.emplace_back(std::move(acc));
+                args.emplace_back(std::move(items[i]));
+                acc = _apply(func, std::move(args), env);
+                if (acc.token_type == Tokens::NONE) {
+                    break;
+                }
+            }
+            return acc;
+        };
+        if (items.size() < _PAR_SEQ_CUTOFF) {
+            auto acc = fold(std::move(params[2]), 0, items.size());
+            if (acc.token_type == Tokens::NONE) {
+                std::cerr << "error!: preduce归约失败.\n";
+            }
+            return acc;
+        }
+        size_t grain = _par_grain(items.size());
+        List partial((items.size() + grain - 1) / grain);
+        ThreadPool::instance().parallel_for(items.size(), grain, [&](size_t begin, size_t end) {
+            partial[begin / grain] = fold(std::move(items[begin]), begin + 1, end);
+        });
+        Token acc = std::move(params[2]);
+        for (auto& part : partial) {
+            if (part.token_type == Tokens::NONE) {
+                std::cerr << "error!: preduce归约失败.\n";
+                return Token{};
+            }
+            List args;
+            args.emplace_back(std::move(acc));
+            args.emplace_back(std::move(part));
+            acc = _apply(func, std::move(args), env);
+            if (acc.token_type == Tokens::NONE) {
+                std::cerr << "error!: preduce归约失败.\n";
+                return Token{};
+            }
+        }
+        return acc;
     }
 
-    // 1. Lambda->params    = contain( node->left )
-    // 2. Lambda->body      = contain( node->right )
-    Token do_gen_lambda(AST_base* lambda, Env* env) {
-        auto left  = std::move(std::get<std::unique_ptr<List>>(lambda->left->t.value));
-        auto right = std::move(std::get<std::unique_ptr<List>>(lambda->right->t.value));
-        auto pack  = std::make_unique<Lambda>(std::move(*left), std::move(*right));
-        return Token{Tokens::K_LAMBDA, std::move(pack)};
+    // (spawn f args...)，返回任务句柄，任务在 await/send/recv/yield 时才会被调度执行。
+    // 任务可能比创建它的函数活得久，所以挂在全局环境上而不是当前的局部环境
+    Token do_spawn(List& params, Env* env) {
+        if (params.size() < 2 || params[1].token_type != Tokens::K_LAMBDA) {
+            std::cerr << "error!: spawn接受一个lambda和它的参数.\n";
+            return Token{};
+        }
+        auto func = std::get<_Ptr_Lambda_t>(params[1].value);
+        List args;
+        for (size_t i = 2; i < params.size(); ++i) {
+            args.emplace_back(std::move(params[i]));
+        }
+        Env* global = env->global();
+        auto task   = Scheduler::instance().spawn([func, args = std::move(args), global]() mutable {
+            Eval task_eval(global);
+            return task_eval._apply(func.get(), std::move(args), global);
+        });
+        if (!task) {
+            return Token{};
+        }
+        return Token{Tokens::TASK, std::move(task)};
     }
 
-    Token do_condition(AST_if* if_stmt, Env* env) {
+    // 从游标取下一个元素，取完或者出错(cursor.failed)返回 nullopt
+    std::optional<Token> _seq_next(SeqCursor& cursor, Env* env) {
+        if (cursor.done) {
+            return std::nullopt;
+        }
+        Budget::local().tick(); // collect 一个长 range 不经过求值节点
+        const auto& seq = cursor.seq;
+        auto lambda     = [&seq]() { return std::get<_Ptr_Lambda_t>(seq.fn.value).get(); };
+        auto fail       = [&cursor](const char* name) {
+            std::cerr << "error!: " << name << "的函数出错.\n";
+            cursor.done = cursor.failed = true;
+            return std::nullopt;
+        };
+        std::optional<Token> item;
+        switch (seq.kind) {
+        case Seq::RANGE:
+            if (seq.bounded && (seq.step > 0 ? cursor.next_int >= seq.end : cursor.next_int <= seq.end)) {
+                break;
+            }
+            item = Token{Tokens::INTEGER, cursor.next_int};
+            if (__builtin_add_overflow(cursor.next_int, seq.step, &cursor.next_int)) {
+                cursor.done = true;
+                return item;
+            }
+            return item;
+        case Seq::ITEMS:
+            if (cursor.index < seq.items.size()) {
+                return seq.items[cursor.index++].copy();
+            }
+            break;
+        case Seq::MAP:
+            if (auto in = _seq_next(*cursor.source, env)) {
+                auto out = _apply(lambda(), std::move(*in), env);
+                if (out.token_type == Tokens::NONE) {
+                    return fail("lazy-map");
+                }
+                return out;
+            }
+            break;
+        case Seq::FILTER:
+            while (auto in = _seq_next(*cursor.source, env)) {
+                auto keep = _apply(lambda(), in->copy(), env);
+                if (keep.token_type == Tokens::NONE) {
+                    return fail("lazy-filter");
+                }
+                if (keep.token_type == Tokens::TRUE) {
+                    return in;
+                }
+            }
+            break;
+        case Seq::TAKE:
+            // 取够了就不再碰上游，iterate 这种无限序列才停得下来
+            if (cursor.remaining > 0) {
+                if (auto in = _seq_next(*cursor.source, env)) {
+                    cursor.remaining--;
+                    return in;
+                }
+            }
+            break;
+        case Seq::COLUMN:
+            if (cursor.index < seq.table->rows) {
+                return seq.table->columns[seq.column].at(cursor.index++);
+            }
+            break;
+        case Seq::ITERATE:
+            if (cursor.started) {
+                cursor.current = _apply(lambda(), cursor.current.copy(), env);
+                if (cursor.current.token_type == Tokens::NONE) {
+                    return fail("iterate");
+                }
+            } else {
+                cursor.current = seq.init.copy();
+                cursor.started = true;
+            }
+            return cursor.current.copy();
+        }
+        // 上游出错要一路传下来
+        if (cursor.source && cursor.source->failed) {
+            cursor.failed = true;
+        }
+        cursor.done = true;
+        return std::nullopt;
+    }
+
+    // (reduce f init seq)，按顺序一个个取，序列再长也不会整个放进内存
+    Token do_reduce(List& params, Env* env) {
+        std::shared_ptr<const Seq> seq;
+        if (params.size() != 4 || params[1].token_type != Tokens::K_LAMBDA || !(seq = _seq_source(params[3]))) {
+            std::cerr << "error!: reduce接受一个lambda、初值和一个序列.\n";
+            return Token{};
+        }
+        auto func = std::get<_Ptr_Lambda_t>(params[1].value).get();
+        Token acc = std::move(params[2]);
+        auto step = [&](Token&& item) {
+            List args;
+            args.emplace_back(std::move(acc));
+            args.emplace_back(std::move(item));
+            acc = _apply(func, std::move(args), env);
+            if (acc.token_type == Tokens::NONE) {
+                std::cerr << "error!: reduce归约失败.\n";
+                return false;
+            }
+            return true;
+        };
+        // 普通列表的元素直接移出来用，不走游标再拷一遍
+        if (params[3].token_type == Tokens::LIST) {
+            for (auto& item : Env::_list_items(std::move(*std::get<_Ptr_List_t>(params[3].value)))) {
+                if (!step(std::move(item))) {
+                    return Token{};
+                }
+            }
+            return acc;
+        }
+        SeqCursor cursor(*seq);
+        while (auto item = _seq_next(cursor, env)) {
+            if (!step(std::move(*item))) {
+                return Token{};
+            }
+        }
+        return cursor.failed ? Token{} : acc;
+    }
+
+    // (map f list)，结果按元素个数预先分配
+    Token do_map(List& params, Env* env) {
+        auto func = _par_check(params, 3, "map");
+        if (func == nullptr) {
+            return Token{};
+        }
+        auto items = Env::_list_items(std::move(*std::get<_Ptr_List_t>(params[2].value)));
+        for (size_t i = 0; i < items.size(); ++i) {
+            items[i] = _apply(func, std::move(items[i]), env);
+            if (items[i].token_type == Tokens::NONE) {
+                std::cerr << "error!: map在第" << i << "个元素上失败.\n";
+                return Token{};
+            }
+        }
+        return Env::_make_list(std::move(items));
+    }
+
+    // (filter f list)，留下 f 返回 true 的元素
+    Token do_filter(List& params, Env* env) {
+        auto func = _par_check(params, 3, "filter");
+        if (func == nullptr) {
+            return Token{};
+        }
+        auto items = Env::_list_items(std::move(*std::get<_Ptr_List_t>(params[2].value)));
+        size_t kept = 0;
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto keep = _apply(func, items[i].copy(), env);
+            if (keep.token_type == Tokens::NONE) {
+                std::cerr << "error!: filter在第" << i << "个元素上失败.\n";
+                return Token{};
+            }
+            if (keep.token_type == Tokens::TRUE) {
+                items[kept++] = std::move(items[i]);
+            }
+        }
+        items.resize(kept);
+        return Env::_make_list(std::move(items));
+    }
+
+    // (collect seq)，把惰性序列变成普通列表
+    Token do_collect(List& params, Env* env) {
+        std::shared_ptr<const Seq> seq;
+        if (params.size() != 2 || !(seq = _seq_source(params[1]))) {
+            std::cerr << "error!: collect接受一个序列.\n";
+            return Token{};
+        }
+        SeqCursor cursor(*seq);
+        List items;
+        while (auto item = _seq_next(cursor, env)) {
+            items.emplace_back(std::move(*item));
+        }
+        return cursor.failed ? Token{} : Env::_make_list(std::move(items));
+    }
+
+    /**
+     * @brief
+     *  (sort seq [f])：seq 是列表或者有限的惰性序列，返回排好的新列表，相等的元素保持原来的顺序。
+     *  没有 f 时按 < 的顺序排，元素必须都是数字或者都是字符串；
+     *  f 有一个参数时是取 key 的函数，每个元素只调用一次，再按 key 排；
+     *  f 有两个参数时是"小于"，函数体正好是 (< a b) 或者 (> a b) 的当成升序/降序，其他的每次比较都回调。
+     *  除了最后一种，比较都在 C++ 里做，不回调解释器；元素多时并行归并排序(sort.hpp)。
+     */
+    [[gnu::noinline]] Token do_sort(List& params, Env* env) {
+        std::shared_ptr<const Seq> seq;
+        if (params.size() < 2 || params.size() > 3 || !(seq = _seq_source(params[1]))
+            || (params.size() == 3 && params[2].token_type != Tokens::K_LAMBDA)) {
+            std::cerr << "error!: sort接受一个列表和一个可选的lambda.\n";
+            return Token{};
+        }
+        List items;
+        if (params[1].token_type == Tokens::LIST) {
+            items = Env::_list_items(std::move(*std::get<_Ptr_List_t>(params[1].value)));
+        } else {
+            SeqCursor cursor(*seq);
+            while (auto item = _seq_next(cursor, env)) {
+                items.emplace_back(std::move(*item));
+            }
+            if (cursor.failed) {
+                return Token{};
+            }
+        }
+        auto& budget = Budget::local();
+        budget.poll();
+        auto func = params.size() == 3 ? std::get<_Ptr_Lambda_t>(params[2].value).get() : nullptr;
+        int direction = func == nullptr ? 1 : _compare_direction(func);
+        std::vector<size_t> order;
+        if (direction != 0) {
+            if (!sort_order(items, direction < 0, order)) {
+                std::cerr << "error!: sort的元素必须都是数字或者都是字符串，其他的要给一个比较函数.\n";
+                return Token{};
+            }
+        } else if (func->params.size() == 1) {
+            List keys(items.size());
+            auto body = [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    keys[i] = _apply(func, items[i].copy(), env);
+                }
+            };
+            if (items.size() < _PAR_SEQ_CUTOFF) {
+                body(0, items.size());
+            } else {
+                ThreadPool::instance().parallel_for(items.size(), _par_grain(items.size()), body);
+            }
+            for (size_t i = 0; i < keys.size(); ++i) {
+                if (keys[i].token_type == Tokens::NONE) {
+                    std::cerr << "error!: sort的key函数在第" << i << "个元素上失败.\n";
+                    return Token{};
+                }
+            }
+            if (!sort_order(keys, false, order)) {
+                std::cerr << "error!: sort的key必须都是数字或者都是字符串.\n";
+                return Token{};
+            }
+        } else if (func->params.size() == 2) {
+            struct BadCompare {};
+            order.resize(items.size());
+            for (size_t i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            auto less = [&](size_t a, size_t b) {
+                List args;
+                args.emplace_back(items[a].copy());
+                args.emplace_back(items[b].copy());
+                auto r = _apply(func, std::move(args), env);
+                if (r.token_type != Tokens::TRUE && r.token_type != Tokens::FALSE) {
+                    throw BadCompare{};
+                }
+                return r.token_type == Tokens::TRUE;
+            };
+            try {
+                parallel_sort<true>(order, less);
+            } catch (const BadCompare&) {
+                std::cerr << "error!: sort的比较函数必须返回true或者false.\n";
+                return Token{};
+            }
+        } else {
+            std::cerr << "error!: sort的lambda要么接受一个参数(取key)，要么接受两个参数(比较).\n";
+            return Token{};
+        }
+        budget.poll(); // 排序本身是一整块原生代码，排完看一下时间
+        List out;
+        out.reserve(items.size());
+        for (auto i : order) {
+            out.emplace_back(std::move(items[i]));
+        }
+        return Env::_make_list(std::move(out));
+    }
+
+    Token do_getident_Call(const AST_call* call, Env* env) {
+        using _Ptr_Str_t = std::unique_ptr<std::string>;
+        // DONE: 把求参数推迟到这里，前面就是记录参数
+        const auto& name = *std::get<_Ptr_Str_t>(call->t.value);
+
+        List _params_list{};
+        _params_list.reserve(call->args.size() + 1);
+        _params_list.emplace_back(Token{}); // 第 0 个位置是函数名，没人用，不拷字符串了
+        for (const auto& arg : call->args) {
+            // 我不得不放弃之前使用引用的想法，除非我再添加一个字符串字面量的类型，但我不想再在为
+            // 这个项目花更多的时间了。一个没有注册到sym_table中的字面量在用了智能指针管理内存的情况下
+            // 其挂在AST上的Token会在出当前作用域就被释放掉，这将引发很多问题，包括让我之前在eq，equal函数上的
+            // 工作白费了，所以Token的reference函数目前只对define过的变量有效果，实际上在当前代码下弃用了
+            // 除非我在花精力搞字符串字面量的token_type。
+            // 也怪我没有做好前期的设计😡，C++写一个解释器比我预想的要麻烦很多。
+            // Anyway, 就这样吧。
+            _params_list.emplace_back(eval(arg));
+        }
+
+        // 只统计调用本身，实参的求值算在调用者头上
+        ProfileScope _profile_scope(name);
+        auto tt = call->global ? _global_ref(call->cell, name, env) : env->find(name);
+        if (tt != nullptr) {
+#ifdef AUSTLISP_TRACE
+            if (tt->token_type != Tokens::K_LAMBDA) {
+                AUSTLISP_TRACE_EVENT(BUILDIN, name);
+            }
+#endif
+            // std::cout << "BIG FUCK LAMBDA.\n";
+            switch (tt->token_type) {
+            case Tokens::K_LAMBDA:
+                {
+                    auto _lambda = std::get<_Ptr_Lambda_t>(tt->value).get();
+                    if (!_check_arity(_lambda, _params_list, name)) {
+                        return Token{};
+                    }
+                    // 先按标注检查、转换实参，机器码按转换后的类型特化
+                    if (!_lambda->param_types.empty() && !_check_param_types(_lambda, _params_list)) {
+                        return Token{};
+                    }
+                    if (_jit_enabled() && !_lambda->memo) {
+                        if (auto ret = _jit_call(_lambda, name, _params_list, env)) {
+                            return std::move(*ret);
+                        }
+                    }
+                    AUSTLISP_TRACE_EVENT(CALL, name);
+                    auto ret = _func_call(_lambda, _params_list, env);
+                    AUSTLISP_TRACE_EVENT(RETURN, name);
+                    return ret;
+                }
+            case Tokens::_BUILDIN_CAR:
+                return env->_buildin_func_car(_params_list);
+            case Tokens::_BUILDIN_CDR:
+                return env->_buildin_func_cdr(_params_list);
+            case Tokens::_BUILDIN_EQ:
+                try {
+                    return env->_buildin_func_eq(_params_list);
+                } catch (std::logic_error* e) {
+                    e->what();
+                    return Token{};
+                }
+            case Tokens::_BUILDIN_EQUAL:
+                try {
+                    return env->_buildin_func_equal(_params_list);
+                } catch (std::logic_error* e) {
+                    e->what();
+                    return Token{};
+                }
+            case Tokens::_BUILDIN_PMAP:
+                return do_pmap(_params_list, env);
+            case Tokens::_BUILDIN_PREDUCE:
+                return do_preduce(_params_list, env);
+            case Tokens::_BUILDIN_PFOREACH:
+                return do_pfor_each(_params_list, env);
+            case Tokens::_BUILDIN_SPAWN:
+                return do_spawn(_params_list, env);
+            case Tokens::_BUILDIN_AWAIT:
+                return env->_buildin_func_await(_params_list);
+            case Tokens::_BUILDIN_CHANNEL:
+                return env->_buildin_func_channel(_params_list);
+            case Tokens::_BUILDIN_SEND:
+                return env->_buildin_func_send(_params_list);
+            case Tokens::_BUILDIN_RECV:
+                return env->_buildin_func_recv(_params_list);
+            case Tokens::_BUILDIN_YIELD:
+                return env->_buildin_func_yield(_params_list);
+            case Tokens::_BUILDIN_MEMOIZE:
+                return env->_buildin_func_memoize(_params_list);
+            case Tokens::_BUILDIN_MEMO_STATS:
+                return env->_buildin_func_memo_stats(_params_list);
+            case Tokens::_BUILDIN_MEMO_CLEAR:
+                return env->_buildin_func_memo_clear(_params_list);
+            case Tokens::_BUILDIN_RUNTIME_STATS:
+                return env->_buildin_func_runtime_stats(_params_list);
+            case Tokens::_BUILDIN_RANGE:
+                return env->_buildin_func_range(_params_list);
+            case Tokens::_BUILDIN_LAZY_MAP:
+                return env->_buildin_func_lazy_map(_params_list);
+            case Tokens::_BUILDIN_LAZY_FILTER:
+                return env->_buildin_func_lazy_filter(_params_list);
+            case Tokens::_BUILDIN_TAKE:
+                return env->_buildin_func_take(_params_list);
+            case Tokens::_BUILDIN_ITERATE:
+                return env->_buildin_func_iterate(_params_list);
+            case Tokens::_BUILDIN_REDUCE:
+                return do_reduce(_params_list, env);
+            case Tokens::_BUILDIN_COLLECT:
+                return do_collect(_params_list, env);
+            case Tokens::_BUILDIN_LENGTH:
+                return env->_buildin_func_length(_params_list);
+            case Tokens::_BUILDIN_NTH:
+                return env->_buildin_func_nth(_params_list);
+            case Tokens::_BUILDIN_APPEND:
+                return env->_buildin_func_append(_params_list);
+            case Tokens::_BUILDIN_REVERSE:
+                return env->_buildin_func_reverse(_params_list);
+            case Tokens::_BUILDIN_MAP:
+                return do_map(_params_list, env);
+            case Tokens::_BUILDIN_TYPE_REPORT:
+                return do_type_report(_params_list, env);
+            case Tokens::_BUILDIN_SORT:
+                return do_sort(_params_list, env);
+            case Tokens::_BUILDIN_FILTER:
+                return do_filter(_params_list, env);
+            case Tokens::_BUILDIN_MEMBER:
+                return env->_buildin_func_member(_params_list);
+            case Tokens::_BUILDIN_ASSOC:
+                return env->_buildin_func_assoc(_params_list);
+            case Tokens::_BUILDIN_STRING_BUILDER:
+                return env->_buildin_func_string_builder(_params_list);
+            case Tokens::_BUILDIN_BUILDER_APPEND:
+                return env->_buildin_func_builder_append(_params_list);
+            case Tokens::_BUILDIN_BUILDER_STRING:
+                return env->_buildin_func_builder_string(_params_list);
+            case Tokens::_BUILDIN_STRING_JOIN:
+                return env->_buildin_func_string_join(_params_list);
+            case Tokens::_BUILDIN_SUBSTRING:
+                return env->_buildin_func_substring(_params_list);
+            case Tokens::_BUILDIN_STRING_LENGTH:
+                return env->_buildin_func_string_length(_params_list);
+            case Tokens::_BUILDIN_DISPLAY:
+                return env->_buildin_func_display(_params_list);
+            case Tokens::_BUILDIN_PRINT:
+                return env->_buildin_func_print(_params_list);
+            case Tokens::_BUILDIN_FORMAT:
+                return env->_buildin_func_format(_params_list);
+            case Tokens::_BUILDIN_LOAD_CSV:
+                return env->_buildin_func_load_csv(_params_list);
+            case Tokens::_BUILDIN_TABLE_ROWS:
+                return env->_buildin_func_table_rows(_params_list);
+            case Tokens::_BUILDIN_TABLE_COLUMNS:
+                return env->_buildin_func_table_columns(_params_list);
+            case Tokens::_BUILDIN_TABLE_COLUMN:
+                return env->_buildin_func_table_column(_params_list);
+            case Tokens::_BUILDIN_TABLE_REF:
+                return env->_buildin_func_table_ref(_params_list);
+            case Tokens::_BUILDIN_MAKE_BYTEVECTOR:
+                return env->_buildin_func_make_bytevector(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_LENGTH:
+                return env->_buildin_func_bytevector_length(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_SLICE:
+                return env->_buildin_func_bytevector_slice(_params_list);
+            case Tokens::_BUILDIN_READ_FILE_BYTES:
+                return env->_buildin_func_read_file_bytes(_params_list);
+            case Tokens::_BUILDIN_WRITE_FILE_BYTES:
+                return env->_buildin_func_write_file_bytes(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_U8_REF:
+                return env->_buildin_func_bytevector_u8_ref(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_U8_SET:
+                return env->_buildin_func_bytevector_u8_set(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_U32_REF:
+                return env->_buildin_func_bytevector_u32_ref(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_U32_SET:
+                return env->_buildin_func_bytevector_u32_set(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_I64_REF:
+                return env->_buildin_func_bytevector_i64_ref(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_I64_SET:
+                return env->_buildin_func_bytevector_i64_set(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_F64_REF:
+                return env->_buildin_func_bytevector_f64_ref(_params_list);
+            case Tokens::_BUILDIN_BYTEVECTOR_F64_SET:
+                return env->_buildin_func_bytevector_f64_set(_params_list);
+            default:
+                std::cerr << "未知的lambda:" << name << '\n';
+                return Token{};
+            }
+        } else {
+            std::cerr << "没有发现变量：" << name << '\n';
+            return Token{};
+        }
+    }
+
+    // 全局变量的绑定：缓存过的直接用；全局里还没有这个名字时不缓存，照原来的顺序找(可能是调用链上局部 define 的函数)
+    static Token* _global_ref(std::atomic<Token*>& cache, const std::string& name, Env* env) {
+        if (auto cell = cache.load(std::memory_order_acquire)) {
+            return cell;
+        }
+        if (auto cell = env->global_cell(name)) {
+            cache.store(cell, std::memory_order_release);
+            return cell;
+        }
+        return env->find(name);
+    }
+
+    Token do_getident(const std::string& name, Env* env) {
+        auto tt = env->find(name);
+        if (tt != nullptr) {
+            // 复杂类型返回引用，基本类型复制
+            switch (tt->token_type) {
+            case Tokens::INTEGER:
+            case Tokens::DOUBLE:
+                return tt->copy();
+            case Tokens::LIST:
+            case Tokens::STRING:
+                return tt->copy();
+            default:
+                return tt->copy();
+            }
+        } else {
+            std::cerr << "没有发现变量：" << name << '\n';
+            return Token{};
+        }
+    }
+
+    // 1. Lambda->params    = contain( node->left )
+    // 2. Lambda->body      = contain( node->right )
+    // 不内联进 eval：eval 的栈帧大小决定了递归能走多深
+    [[gnu::noinline]] Token do_gen_lambda(const AST_base* lambda, Env* env) {
+        const auto& left  = *std::get<std::unique_ptr<List>>(lambda->left->t.value);
+        const auto& right = *std::get<std::unique_ptr<List>>(lambda->right->t.value);
+        auto pack         = std::make_shared<Lambda>(List(left), List(right));
+        pack->param_types = static_cast<const AST_lambda*>(lambda)->param_types;
+        // 顶层定义的函数只会用到全局变量和外面的 let 绑定
+        const auto& let_scope = static_cast<const AST_lambda*>(lambda)->let_scope;
+        if (env != env->global() || !let_scope.empty()) {
+            _capture(*pack, env, let_scope);
+        }
+        return Token{Tokens::K_LAMBDA, std::move(pack)};
+    }
+
+    // 当前可见的 let 绑定的 slot 下标，里层的优先；没有返回 -1
+    int64_t _let_slot(const std::string& name) const noexcept {
+        for (size_t i = _let_names.size(); i-- > 0;) {
+            if (_let_names[i] == name) {
+                return int64_t(i);
+            }
+        }
+        return -1;
+    }
+
+    int _capture_index(const std::string& name) const noexcept {
+        auto closure = env->closure();
+        return closure == nullptr ? -1 : closure->capture_index(name);
+    }
+
+    // 闭包转换：函数体里出现的、在当前词法作用域里有绑定的名字，拷一份进 lambda 的捕获数组
+    static void _capture(Lambda& func, Env* env, const std::vector<std::pair<std::string, size_t>>& let_scope) {
+        auto is_param = [&func](const std::string& name) {
+            for (const auto& p : func.params) {
+                if (*std::get<_Ptr_Str_t>(p.value) == name) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        const auto& body = func.body;
+        // 函数体里自己 define 的名字是局部变量，不能被外面的同名变量挡住
+        std::vector<std::string> defined;
+        for (size_t i = 0; i + 1 < body.size(); ++i) {
+            if (body[i].token_type == Tokens::K_DEFINE && body[i + 1].token_type == Tokens::IDENT) {
+                defined.emplace_back(*std::get<_Ptr_Str_t>(body[i + 1].value));
+            }
+        }
+        for (const auto& t : body) {
+            if (t.token_type != Tokens::IDENT) {
+                continue;
+            }
+            const auto& name = *std::get<_Ptr_Str_t>(t.value);
+            if (is_param(name) || func.capture_index(name) >= 0
+                || std::find(defined.begin(), defined.end(), name) != defined.end()) {
+                continue;
+            }
+            // 里层的 let 绑定会挡住外层同名的，所以从后往前找
+            auto let = std::find_if(let_scope.rbegin(), let_scope.rend(), [&name](const auto& b) { return b.first == name; });
+            if (let != let_scope.rend()) {
+                func.capture_names.emplace_back(name);
+                func.captures.emplace_back(env->slots()[let->second].copy());
+            } else if (env == env->global()) {
+                continue; // 全局变量不捕获，调用时再找
+            } else if (auto bound = env->find_lexical(name)) {
+                func.capture_names.emplace_back(name);
+                func.captures.emplace_back(bound->copy());
+            }
+        }
+    }
+
+    Token do_condition(const AST_if* if_stmt, Env* env) {
+        if (if_stmt->cond->t.token_type == Tokens::NUM_COMPARE) {
+            return eval(_eval_compare(if_stmt->cond) ? if_stmt->left : if_stmt->right);
+        }
         auto ret = eval(if_stmt->cond);
         if (ret.token_type == Tokens::TRUE) {
             return eval(if_stmt->left);
@@ -571,33 +1667,74 @@ public:
             return eval(if_stmt->right);
         }
     }
-    Token eval(AST_if* node) noexcept {
+    Token eval(const AST_if* node) {
         return do_condition(node, env);
     }
     Token eval(const std::unique_ptr<AST_base>& node) {
+        Budget::local().step();
         auto tt = node->t.token_type;
+        AUSTLISP_TRACE_EVENT(NODE, Tokens_str[int(tt)]);
         // NOTE: 没有问题, 无视clangd报警即可
         switch (tt) {
         case Tokens::QUOTE:
-            return std::move(node->left->t);
+            return node->left->t.copy();
         case Tokens::K_IF:
-            return eval(dynamic_cast<AST_if*>(node.get()));
+            return eval(static_cast<AST_if*>(node.get()));
         case Tokens::K_WHILE:
-            return do_while(node.get(), env);
+            return do_while(node.get());
         case Tokens::K_DEFINE:
-            return do_define(std::move(node->left->t), std::move(eval(node->right)), env);
+            return do_define(node->left->t, eval(node->right), env);
         case Tokens::K_SETQ:
-            return do_setq(std::move(node->left->t), std::move(eval(node->right)), env);
+            if (node->left->t.token_type == Tokens::IDENT_LOCAL) {
+                auto value = eval(node->right); // 先求值，求值过程中 slot 数组可能变长
+                env->slots()[std::get<int64_t>(node->left->t.value)] = std::move(value);
+                return Token{};
+            }
+            if (node->left->t.token_type == Tokens::IDENT_GLOBAL) {
+                auto value = eval(node->right);
+                auto cell  = _global_ref(static_cast<const AST_global*>(node->left.get())->cell,
+                     *std::get<_Ptr_Str_t>(node->left->t.value), env);
+                if (cell == nullptr) {
+                    std::cerr << "can't find symbol: " << *std::get<_Ptr_Str_t>(node->left->t.value) << ", "
+                              << "updata failure.\n";
+                    return Token{};
+                }
+                AUSTLISP_TRACE_EVENT(SETQ, *std::get<_Ptr_Str_t>(node->left->t.value));
+                Env::assign(*cell, value.token_type, std::move(value.value));
+                return Token{};
+            }
+            return do_setq(node->left->t, eval(node->right), env);
+        case Tokens::K_LET:
+        case Tokens::K_LET_STAR:
+            return do_let(static_cast<AST_let*>(node.get()), env);
+        case Tokens::K_DOTIMES:
+        case Tokens::K_FOR:
+            return do_loop(static_cast<AST_loop*>(node.get()), env);
+        case Tokens::IDENT_LOCAL:
+            return env->slots()[std::get<int64_t>(node->t.value)].copy();
         case Tokens::IDENT_C:
-            return do_getident_Call(node->t, env);
+            return do_getident_Call(static_cast<AST_call*>(node.get()), env);
         case Tokens::IDENT:
             return do_getident(*std::get<std::unique_ptr<std::string>>(node->t.value), env);
+        case Tokens::IDENT_CAPTURED:
+            return env->closure()->captures[std::get<int64_t>(node->t.value)].copy();
+        case Tokens::IDENT_GLOBAL:
+            if (auto cell = _global_ref(static_cast<const AST_global*>(node.get())->cell,
+                    *std::get<_Ptr_Str_t>(node->t.value), env)) {
+                return cell->copy();
+            }
+            std::cerr << "没有发现变量：" << *std::get<_Ptr_Str_t>(node->t.value) << '\n';
+            return Token{};
         case Tokens::TRUE:
             return Token{Tokens::TRUE, 1};
         case Tokens::FALSE:
             return Token{Tokens::FALSE, 0};
         case Tokens::K_LAMBDA:
             return do_gen_lambda(node.get(), env);
+        case Tokens::INT_ARITH:
+        case Tokens::DBL_ARITH:
+        case Tokens::NUM_COMPARE:
+            return _eval_typed(node);
         }
 
         Token left, right;
@@ -617,20 +1754,699 @@ public:
             return do_multiple(std::move(left), std::move(right));
         case Tokens::DIVISION:
             return do_division(std::move(left), std::move(right));
+        case Tokens::LOW:
+        case Tokens::GREAT:
+            return do_compare(tt, std::move(left), std::move(right));
         // case Tokens::STRING:
         //     return node->t.reference();
         default:
-            return std::move(node->t);
+            return node->t.copy(); // 树还要留着下次用，不能移走
+        }
+    }
+    /**
+     * @brief
+     *  类型推断过的子树直接算出 int64/double，中间不构造 Token，也不按 token_type 分派。
+     *  只有推断证明了类型的节点才会走到这里：字面量、let/循环变量、带标注的参数、特化过的运算，
+     *  其他的(比如两个分支都是整数的 if)照常求值以后直接取值。
+     */
+    // 不内联，eval 的栈帧不因为这几个分支变大，深递归能走的层数不变
+    [[gnu::noinline]] Token _eval_typed(const std::unique_ptr<AST_base>& node) {
+        switch (node->t.token_type) {
+        case Tokens::INT_ARITH:
+            return Token{Tokens::INTEGER, _eval_int(node)};
+        case Tokens::DBL_ARITH:
+            return Token{Tokens::DOUBLE, _eval_double(node)};
+        default:
+            return _eval_compare(node) ? Token{Tokens::TRUE, 1} : Token{Tokens::FALSE, 0};
+        }
+    }
+    int64_t _eval_int(const std::unique_ptr<AST_base>& node) {
+        switch (node->t.token_type) {
+        case Tokens::INTEGER:
+            return std::get<int64_t>(node->t.value);
+        case Tokens::IDENT_LOCAL:
+            return std::get<int64_t>(env->slots()[std::get<int64_t>(node->t.value)].value);
+        case Tokens::IDENT:
+            return std::get<int64_t>(_typed_param(node, Tokens::INTEGER).value);
+        case Tokens::INT_ARITH:
+            {
+                auto l = _eval_int(node->left), r = _eval_int(node->right);
+                switch (Tokens(std::get<int64_t>(node->t.value) & TypeInfer::OP_MASK)) {
+                case Tokens::PLUS:
+                    return l + r;
+                case Tokens::MINUS:
+                    return l - r;
+                case Tokens::STAR:
+                    return l * r;
+                default:
+                    // 除数是非零常量；INT64_MIN / -1 和 do_division 一样回绕
+                    return (l == INT64_MIN && r == -1) ? l : l / r;
+                }
+            }
+        default:
+            return std::get<int64_t>(eval(node).value);
+        }
+    }
+    double _eval_double(const std::unique_ptr<AST_base>& node) {
+        switch (node->t.token_type) {
+        case Tokens::DOUBLE:
+            return std::get<double>(node->t.value);
+        case Tokens::IDENT_LOCAL:
+            return std::get<double>(env->slots()[std::get<int64_t>(node->t.value)].value);
+        case Tokens::IDENT:
+            return std::get<double>(_typed_param(node, Tokens::DOUBLE).value);
+        case Tokens::DBL_ARITH:
+            {
+                auto flags = std::get<int64_t>(node->t.value);
+                double l   = flags & TypeInfer::LEFT_INT ? double(_eval_int(node->left)) : _eval_double(node->left);
+                double r   = flags & TypeInfer::RIGHT_INT ? double(_eval_int(node->right)) : _eval_double(node->right);
+                switch (Tokens(flags & TypeInfer::OP_MASK)) {
+                case Tokens::PLUS:
+                    return l + r;
+                case Tokens::MINUS:
+                    return l - r;
+                case Tokens::STAR:
+                    return l * r;
+                default:
+                    return l / r;
+                }
+            }
+        default:
+            return std::get<double>(eval(node).value);
         }
     }
+    bool _eval_compare(const std::unique_ptr<AST_base>& node) {
+        auto flags = std::get<int64_t>(node->t.value);
+        bool less  = Tokens(flags & TypeInfer::OP_MASK) == Tokens::LOW;
+        if ((flags & TypeInfer::LEFT_INT) && (flags & TypeInfer::RIGHT_INT)) {
+            auto l = _eval_int(node->left), r = _eval_int(node->right);
+            return less ? l < r : l > r;
+        }
+        double l = flags & TypeInfer::LEFT_INT ? double(_eval_int(node->left)) : _eval_double(node->left);
+        double r = flags & TypeInfer::RIGHT_INT ? double(_eval_int(node->right)) : _eval_double(node->right);
+        return less ? l < r : l > r;
+    }
+    // 带标注的参数调用时检查过，只有调用链上别的函数 setq 了它才会对不上
+    const Token& _typed_param(const std::unique_ptr<AST_base>& node, Tokens expected) {
+        const auto& name = *std::get<_Ptr_Str_t>(node->t.value);
+        auto value       = env->find(name);
+        if (value == nullptr || value->token_type != expected) [[unlikely]] {
+            throw TypeMismatch("参数 " + name + " 不再是 " + (expected == Tokens::INTEGER ? "int" : "double"));
+        }
+        return *value;
+    }
+
+    // (type-report f)：对 f 的函数体单独做一遍常量折叠和类型推断(和 -O 无关)，
+    // 把没能特化的运算一行一条打印出来，返回条数。不内联，不然 do_getident_Call 每层都要多占栈
+    [[gnu::noinline]] Token do_type_report(List& params, Env* env) {
+        if (params.size() != 2 || params[1].token_type != Tokens::K_LAMBDA) {
+            std::cerr << "error!: type-report接受一个lambda.\n";
+            return Token{};
+        }
+        auto func = std::get<_Ptr_Lambda_t>(params[1].value).get();
+        Env frame(env, func);
+        Eval analysis(&frame);
+        List tokens = func->body;
+        size_t t    = 0;
+        auto ast    = analysis.parser(tokens, t);
+        analysis.optimize(ast);
+        auto report  = analysis.infer_types(ast);
+        auto& output = Output::local();
+        for (const auto& line : report) {
+            output.buffer() += line;
+            output.buffer() += '\n';
+        }
+        output.commit();
+        return Token{Tokens::INTEGER, int64_t(report.size())};
+    }
+
     // 如果上一条语句执行失败，paren_stack很有可能没有归0，对下一次执行产生影响
-    constexpr void clear_status() noexcept {
+    void clear_status() noexcept {
         this->paren_stack = 0;
+        _let_names.clear();
+    }
+
+private:
+    static StaticType _annotation(const std::string& type) noexcept {
+        if (type == "int") {
+            return StaticType::INT;
+        }
+        if (type == "double") {
+            return StaticType::DBL;
+        }
+        return StaticType::NONE;
+    }
+
+    // 带类型标注的参数：int 只收整数，double 收整数和浮点数(整数就地转成浮点数)
+    // 实参个数(params 里不算开头的函数名)要和形参一样，不然形参绑不上或者多出来的实参没地方放
+    [[gnu::noinline, gnu::cold]] static bool _arity_error(const Lambda* func, const List& params, const std::string& name) {
+        std::cerr << "error!: " << name << "需要" << func->params.size() << "个参数，传入了" << params.size() - 1
+                  << "个.\n";
+        return false;
+    }
+    static bool _check_arity(const Lambda* func, const List& params, const std::string& name) {
+        return params.size() == func->params.size() + 1 || _arity_error(func, params, name);
+    }
+
+    static bool _check_param_types(Lambda* func, List& params) {
+        for (size_t i = 0; i < func->param_types.size() && i + 1 < params.size(); ++i) {
+            auto& arg = params[i + 1];
+            auto type = func->param_types[i];
+            if (type == StaticType::DBL && arg.token_type == Tokens::INTEGER) {
+                arg = Token{Tokens::DOUBLE, double(std::get<int64_t>(arg.value))};
+            }
+            if ((type == StaticType::INT && arg.token_type != Tokens::INTEGER)
+                || (type == StaticType::DBL && arg.token_type != Tokens::DOUBLE)) {
+                std::cerr << "error!: 参数 " << *std::get<_Ptr_Str_t>(func->params[i].value) << " 应该是 "
+                          << (type == StaticType::INT ? "int" : "double") << ".\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 两个参数的 lambda 的函数体正好是 (< a b) / (> b a) 时是 1(升序)，(> a b) / (< b a) 时是 -1，否则是 0
+    static int _compare_direction(const Lambda* func) {
+        const auto& body = func->body;
+        if (func->params.size() != 2 || func->memo || !func->captures.empty() || body.size() != 5
+            || (body[1].token_type != Tokens::LOW && body[1].token_type != Tokens::GREAT)
+            || body[2].token_type != Tokens::IDENT || body[3].token_type != Tokens::IDENT) {
+            return 0;
+        }
+        const auto& a = *std::get<_Ptr_Str_t>(func->params[0].value);
+        const auto& b = *std::get<_Ptr_Str_t>(func->params[1].value);
+        const auto& x = *std::get<_Ptr_Str_t>(body[2].value);
+        const auto& y = *std::get<_Ptr_Str_t>(body[3].value);
+        int direction = body[1].token_type == Tokens::LOW ? 1 : -1;
+        if (a == x && b == y && a != b) {
+            return direction;
+        }
+        if (a == y && b == x && a != b) {
+            return -direction;
+        }
+        return 0;
+    }
+
+    static bool _is_number(const std::unique_ptr<AST_base>& node) noexcept {
+        return node && !node->left && !node->right
+            && (node->t.token_type == Tokens::INTEGER || node->t.token_type == Tokens::DOUBLE);
+    }
+    static bool _is_literal(const std::unique_ptr<AST_base>& node) noexcept {
+        if (!node || node->left || node->right) {
+            return node && node->t.token_type == Tokens::QUOTE;
+        }
+        switch (node->t.token_type) {
+        case Tokens::INTEGER:
+        case Tokens::DOUBLE:
+        case Tokens::STRING:
+        case Tokens::TRUE:
+        case Tokens::FALSE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // (equal 1 1) / (eq "a" "b")：两个实参都是字面量，并且名字确实指向内建函数时直接求值。
+    // 只看全局绑定(内建函数只注册在那里)，名字被当前函数的参数、捕获变量或者局部 define 挡住时不折叠
+    void _fold_equal(std::unique_ptr<AST_base>& node) {
+        auto call = static_cast<AST_call*>(node.get());
+        if (call->args.size() != 2) {
+            return;
+        }
+        auto is_atom = [](const std::unique_ptr<AST_base>& arg) {
+            auto tt = arg->t.token_type;
+            return !arg->left && !arg->right
+                && (tt == Tokens::INTEGER || tt == Tokens::DOUBLE || tt == Tokens::STRING);
+        };
+        if (!is_atom(call->args[0]) || !is_atom(call->args[1])) {
+            return;
+        }
+        const auto& name = *std::get<_Ptr_Str_t>(call->t.value);
+        if (_locally_bound(name)) {
+            return;
+        }
+        auto fn = env->global()->find(name);
+        if (fn == nullptr
+            || (fn->token_type != Tokens::_BUILDIN_EQUAL && fn->token_type != Tokens::_BUILDIN_EQ)) {
+            return;
+        }
+        List args;
+        args.emplace_back(Token{});
+        args.emplace_back(call->args[0]->t.copy());
+        args.emplace_back(call->args[1]->t.copy());
+        Token folded;
+        try {
+            folded = fn->token_type == Tokens::_BUILDIN_EQUAL ? env->_buildin_func_equal(args)
+                                                             : env->_buildin_func_eq(args);
+        } catch (std::logic_error* e) {
+            return; // 比较不了的留到运行时报错
+        }
+        node = std::make_unique<AST_base>(std::move(folded));
+    }
+
+    bool _locally_bound(const std::string& name) {
+        // 先比较 env：并行加载时解析在工作线程里做，不能去读正在被求值线程修改的全局符号表
+        if (_let_slot(name) >= 0 || (env != env->global() && env->find_lexical(name) != nullptr)) {
+            return true;
+        }
+        auto closure = env->closure();
+        if (closure == nullptr) {
+            return false;
+        }
+        for (const auto& p : closure->params) {
+            if (*std::get<_Ptr_Str_t>(p.value) == name) {
+                return true;
+            }
+        }
+        const auto& body = closure->body;
+        for (size_t i = 0; i + 1 < body.size(); ++i) {
+            if (body[i].token_type == Tokens::K_DEFINE && body[i + 1].token_type == Tokens::IDENT
+                && *std::get<_Ptr_Str_t>(body[i + 1].value) == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief
+     *  实参都是数字时给 lambda 计数，够热了就按这组实参类型编译成机器码再跑。
+     *  编译不了、或者机器码半路 deopt 都返回 nullopt，由调用者照常解释执行。
+     */
+    // profiler 和 trace 要看到每一次调用，机器码里的调用它们看不到，开着的时候不走 JIT；
+    // 机器码里的循环不经过 step()，有步数或时间限制时也不走 JIT
+    static bool _jit_enabled() noexcept {
+#ifdef AUSTLISP_TRACE
+        return false;
+#else
+        return _opt_level >= 2 && !Profiler::enabled() && !Budget::local().limited();
+#endif
+    }
+
+    // 函数体里的 (name ...) 求值时按 捕获 -> 全局 -> 调用链 的顺序找，找到的还是 func 才能当成调用自己
+    static bool _binds_self(Lambda* func, const std::string& name, Env* env) {
+        Token* bound = nullptr;
+        if (auto i = func->capture_index(name); i >= 0) {
+            bound = &func->captures[i];
+        } else if (bound = env->global()->find(name); bound == nullptr) {
+            bound = env->find(name);
+        }
+        return bound != nullptr && bound->token_type == Tokens::K_LAMBDA
+            && std::holds_alternative<_Ptr_Lambda_t>(bound->value) && std::get<_Ptr_Lambda_t>(bound->value).get() == func;
+    }
+
+    bool _has_loop(Lambda* func, Env* env) {
+        if (auto body = func->compiled.load(std::memory_order_acquire)) {
+            return body->loops;
+        }
+        Env frame(env, func);
+        Eval parsing(&frame);
+        parsing._compiled_body(func);
+        return func->compiled.load(std::memory_order_acquire)->loops;
+    }
+
+    std::optional<Token> _jit_call(Lambda* func, const std::string& name, List& params, Env* env) {
+        size_t nparams = func->params.size();
+        if (params.size() != nparams + 1
+            || std::find(_jit_too_deep.begin(), _jit_too_deep.end(), func) != _jit_too_deep.end()) {
+            return std::nullopt;
+        }
+        std::vector<JitType> sig;
+        sig.reserve(nparams);
+        for (size_t i = 1; i < params.size(); ++i) {
+            switch (params[i].token_type) {
+            case Tokens::INTEGER:
+                sig.emplace_back(JitType::INT);
+                break;
+            case Tokens::DOUBLE:
+                sig.emplace_back(JitType::DBL);
+                break;
+            default:
+                return std::nullopt;
+            }
+        }
+        // 带计数循环的函数一次调用就可能跑上百万轮，不等调用次数攒够
+        if (func->jit.calls.fetch_add(1, std::memory_order_relaxed) < JitState::HOT_CALLS && !_has_loop(func, env)) {
+            return std::nullopt;
+        }
+
+        // 机器码里的递归直接跳回自己，所以每次进来都要确认 name 现在还绑定在 func 上：
+        // (define h f) (setq f ...) 之后再调 h，函数体里的 f 已经是别的函数了
+        std::string self        = _binds_self(func, name, env) ? name : std::string();
+        const JitFunction* code = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(func->jit.m);
+            auto it = std::find_if(func->jit.variants.begin(), func->jit.variants.end(),
+                [&](const auto& v) { return v.sig == sig && v.self == self; });
+            if (it == func->jit.variants.end()) {
+                size_t nslots = 0;
+                auto ir       = lower_lambda(func, self, sig, nslots);
+                func->jit.variants.emplace_back(
+                    JitState::Variant{sig, self, ir ? JitFunction::compile(*ir, nparams, nslots) : nullptr});
+                it = std::prev(func->jit.variants.end());
+            }
+            code = it->code.get();
+        }
+        if (code == nullptr) {
+            return std::nullopt;
+        }
+
+        std::vector<int64_t> args(nparams);
+        for (size_t i = 0; i < nparams; ++i) {
+            const auto& v = params[i + 1].value;
+            args[i] = sig[i] == JitType::INT ? std::get<int64_t>(v) : std::bit_cast<int64_t>(std::get<double>(v));
+        }
+        int64_t out;
+        bool too_deep;
+        if (!code->run(args.data(), out, too_deep)) {
+            if (!too_deep) {
+                return std::nullopt;
+            }
+            // 机器码里递归超过 MAX_DEPTH 放弃了。这一层改成解释执行以后，下面每一层再进机器码
+            // 都要先跑 MAX_DEPTH 层才放弃，所以这次调用下面的 func 都不走 JIT
+            struct TooDeep {
+                Lambda* func;
+                ~TooDeep() {
+                    // 调度器会在同一个线程上切换任务，不一定是最后一个
+                    _jit_too_deep.erase(std::find(_jit_too_deep.rbegin(), _jit_too_deep.rend(), func).base() - 1);
+                }
+            };
+            _jit_too_deep.emplace_back(func);
+            TooDeep guard{func};
+            return _func_call(func, params, env);
+        }
+        switch (code->result_type()) {
+        case JitType::INT:
+            return Token{Tokens::INTEGER, out};
+        case JitType::DBL:
+            return Token{Tokens::DOUBLE, std::bit_cast<double>(out)};
+        case JitType::BOOL:
+            return out != 0 ? Token{Tokens::TRUE, 1} : Token{Tokens::FALSE, 0};
+        default:
+            return Token{};
+        }
+    }
+
+public:
+    // 按实参类型 sig 把 func 的函数体翻译成 JitExpr，翻译不了返回 nullptr；nslots 是帧里要的槽数。
+    // 结果类型不知道的递归调用依次假设成各种类型，和整个函数体的类型对得上才算数。--emit-cpp 也用这个
+    std::unique_ptr<JitExpr> lower_lambda(
+        Lambda* func, const std::string& self, const std::vector<JitType>& sig, size_t& nslots) {
+        Env frame(env, func); // 和解释执行时一样在 func 自己的帧里解析
+        Eval lowering(&frame);
+        const auto& ast = lowering._compiled_body(func);
+        for (auto assumed : {JitType::INT, JitType::DBL, JitType::BOOL, JitType::NONE}) {
+            lowering._jit_self_type  = assumed;
+            lowering._jit_self_calls = 0;
+            lowering._jit_local_types.clear();
+            auto ir = lowering._jit_lower(ast, func->params, self, sig);
+            if (ir && (lowering._jit_self_calls == 0 || ir->type == assumed)) {
+                nslots = _jit_slot(func->params.size(), lowering._jit_local_types.size());
+                return ir;
+            }
+        }
+        return nullptr;
     }
 
 private:
+    // AST -> JitExpr，遇到第一层 JIT 不支持的东西就返回 nullptr
+    std::unique_ptr<JitExpr> _jit_lower(const std::unique_ptr<AST_base>& node, const List& params,
+        const std::string& self, const std::vector<JitType>& sig) {
+        if (!node) {
+            return nullptr;
+        }
+        auto make = [](JitExpr::Op op, JitType type, int64_t value = 0) {
+            auto e   = std::make_unique<JitExpr>();
+            e->op    = op;
+            e->type  = type;
+            e->value = value;
+            return e;
+        };
+        auto param_index = [&params](const std::string& name) -> int64_t {
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (*std::get<_Ptr_Str_t>(params[i].value) == name) {
+                    return int64_t(i);
+                }
+            }
+            return -1;
+        };
+        auto is_number = [](const std::unique_ptr<JitExpr>& e) {
+            return e && (e->type == JitType::INT || e->type == JitType::DBL);
+        };
+        // let 和循环变量在机器码的帧里各占三个槽(循环多用两个放计数器和终点)，排在参数后面
+        auto local = [&](size_t slot, JitType type) {
+            if (_jit_local_types.size() <= slot) {
+                _jit_local_types.resize(slot + 1, JitType::NONE);
+            }
+            _jit_local_types[slot] = type;
+            return int64_t(_jit_slot(sig.size(), slot));
+        };
+        auto lower_body = [&](const std::vector<std::unique_ptr<AST_base>>& forms) -> std::unique_ptr<JitExpr> {
+            auto e = make(JitExpr::SEQ, JitType::NONE);
+            for (const auto& form : forms) {
+                auto kid = _jit_lower(form, params, self, sig);
+                if (!kid) {
+                    return nullptr;
+                }
+                e->type = kid->type;
+                e->kids.emplace_back(std::move(kid));
+            }
+            return e;
+        };
+
+        switch (node->t.token_type) {
+        case Tokens::INTEGER:
+            return make(JitExpr::CONST, JitType::INT, std::get<int64_t>(node->t.value));
+        case Tokens::DOUBLE:
+            return make(JitExpr::CONST, JitType::DBL, std::bit_cast<int64_t>(std::get<double>(node->t.value)));
+        case Tokens::TRUE:
+            return make(JitExpr::CONST, JitType::BOOL, 1);
+        case Tokens::FALSE:
+            return make(JitExpr::CONST, JitType::BOOL, 0);
+        case Tokens::IDENT:
+            {
+                auto i = param_index(*std::get<_Ptr_Str_t>(node->t.value));
+                return i < 0 ? nullptr : make(JitExpr::ARG, sig[i], i);
+            }
+        case Tokens::IDENT_LOCAL:
+            {
+                auto slot = size_t(std::get<int64_t>(node->t.value));
+                if (slot >= _jit_local_types.size() || _jit_local_types[slot] == JitType::NONE) {
+                    return nullptr;
+                }
+                return make(JitExpr::ARG, _jit_local_types[slot], int64_t(_jit_slot(sig.size(), slot)));
+            }
+        case Tokens::K_LET:
+        case Tokens::K_LET_STAR:
+            {
+                // 外层绑定的槽号都比 base 小，所以 let 的初值也可以求一个写一个
+                auto let = static_cast<const AST_let*>(node.get());
+                auto e   = make(JitExpr::SEQ, JitType::NONE);
+                std::vector<std::unique_ptr<JitExpr>> inits;
+                for (const auto& init : let->inits) {
+                    auto value = _jit_lower(init, params, self, sig);
+                    if (!value || value->type == JitType::NONE) {
+                        return nullptr;
+                    }
+                    if (let->t.token_type == Tokens::K_LET_STAR) {
+                        local(let->base + inits.size(), value->type);
+                    }
+                    inits.emplace_back(std::move(value));
+                }
+                for (size_t i = 0; i < inits.size(); ++i) {
+                    auto set = make(JitExpr::SETQ, JitType::NONE, local(let->base + i, inits[i]->type));
+                    set->kids.emplace_back(std::move(inits[i]));
+                    e->kids.emplace_back(std::move(set));
+                }
+                auto body = lower_body(let->body);
+                if (!body) {
+                    return nullptr;
+                }
+                e->type = body->type;
+                e->kids.emplace_back(std::move(body));
+                return e;
+            }
+        case Tokens::K_DOTIMES:
+        case Tokens::K_FOR:
+            {
+                auto loop = static_cast<const AST_loop*>(node.get());
+                int64_t step = 1;
+                if (loop->step) {
+                    // 步长的正负决定比较方向，只编常量步长
+                    if (loop->step->t.token_type != Tokens::INTEGER || std::get<int64_t>(loop->step->t.value) == 0) {
+                        return nullptr;
+                    }
+                    step = std::get<int64_t>(loop->step->t.value);
+                }
+                auto from = loop->from ? _jit_lower(loop->from, params, self, sig) : make(JitExpr::CONST, JitType::INT, 0);
+                auto to   = _jit_lower(loop->to, params, self, sig);
+                if (!from || from->type != JitType::INT || !to || to->type != JitType::INT) {
+                    return nullptr;
+                }
+                auto e  = make(JitExpr::FOR, JitType::NONE, local(loop->slot, JitType::INT));
+                e->step = step;
+                auto body = lower_body(loop->body);
+                if (!body) {
+                    return nullptr;
+                }
+                e->kids.emplace_back(std::move(from));
+                e->kids.emplace_back(std::move(to));
+                e->kids.emplace_back(std::move(body));
+                return e;
+            }
+        case Tokens::PLUS:
+        case Tokens::MINUS:
+        case Tokens::STAR:
+        case Tokens::DIVISION:
+        case Tokens::LOW:
+        case Tokens::GREAT:
+        case Tokens::INT_ARITH:
+        case Tokens::DBL_ARITH:
+        case Tokens::NUM_COMPARE:
+            {
+                // 类型推断特化过的节点按原来的运算符翻译，机器码本来就按类型生成
+                auto op  = _arith_op(node->t);
+                auto lhs = _jit_lower(node->left, params, self, sig);
+                auto rhs = _jit_lower(node->right, params, self, sig);
+                if (!is_number(lhs) || !is_number(rhs)) {
+                    return nullptr;
+                }
+                bool dbl = lhs->type == JitType::DBL || rhs->type == JitType::DBL;
+                std::unique_ptr<JitExpr> e;
+                switch (op) {
+                case Tokens::PLUS:
+                    e = make(JitExpr::ADD, dbl ? JitType::DBL : JitType::INT);
+                    break;
+                case Tokens::MINUS:
+                    e = make(JitExpr::SUB, dbl ? JitType::DBL : JitType::INT);
+                    break;
+                case Tokens::STAR:
+                    e = make(JitExpr::MUL, dbl ? JitType::DBL : JitType::INT);
+                    break;
+                case Tokens::DIVISION:
+                    e = make(JitExpr::DIV, dbl ? JitType::DBL : JitType::INT);
+                    break;
+                case Tokens::LOW:
+                    e = make(JitExpr::LT, JitType::BOOL);
+                    break;
+                default:
+                    e = make(JitExpr::GT, JitType::BOOL);
+                    break;
+                }
+                e->kids.emplace_back(std::move(lhs));
+                e->kids.emplace_back(std::move(rhs));
+                return e;
+            }
+        case Tokens::K_IF:
+            {
+                auto if_node = static_cast<const AST_if*>(node.get());
+                auto cond    = _jit_lower(if_node->cond, params, self, sig);
+                auto then    = _jit_lower(node->left, params, self, sig);
+                auto other   = _jit_lower(node->right, params, self, sig);
+                // 两个分支类型不同的话结果类型就定不下来了
+                if (!cond || cond->type != JitType::BOOL || !then || !other || then->type != other->type) {
+                    return nullptr;
+                }
+                auto e = make(JitExpr::IF, then->type);
+                e->kids.emplace_back(std::move(cond));
+                e->kids.emplace_back(std::move(then));
+                e->kids.emplace_back(std::move(other));
+                return e;
+            }
+        case Tokens::K_WHILE:
+            {
+                auto cond = _jit_lower(node->left, params, self, sig);
+                auto body = _jit_lower(node->right, params, self, sig);
+                // 循环体有值的话，一次都不执行时结果是 NONE，类型定不下来
+                if (!cond || cond->type != JitType::BOOL || !body || body->type != JitType::NONE) {
+                    return nullptr;
+                }
+                auto e = make(JitExpr::WHILE, JitType::NONE);
+                e->kids.emplace_back(std::move(cond));
+                e->kids.emplace_back(std::move(body));
+                return e;
+            }
+        case Tokens::K_SETQ:
+            {
+                if (node->left->t.token_type == Tokens::IDENT_LOCAL) {
+                    auto slot  = size_t(std::get<int64_t>(node->left->t.value));
+                    auto value = _jit_lower(node->right, params, self, sig);
+                    if (slot >= _jit_local_types.size() || !value || value->type != _jit_local_types[slot]) {
+                        return nullptr;
+                    }
+                    auto e = make(JitExpr::SETQ, JitType::NONE, int64_t(_jit_slot(sig.size(), slot)));
+                    e->kids.emplace_back(std::move(value));
+                    return e;
+                }
+                if (node->left->t.token_type != Tokens::IDENT) {
+                    return nullptr;
+                }
+                auto i     = param_index(*std::get<_Ptr_Str_t>(node->left->t.value));
+                auto value = _jit_lower(node->right, params, self, sig);
+                if (i < 0 || !value || value->type != sig[i]) {
+                    return nullptr;
+                }
+                auto e = make(JitExpr::SETQ, JitType::NONE, i);
+                e->kids.emplace_back(std::move(value));
+                return e;
+            }
+        case Tokens::IDENT_C:
+            {
+                auto call        = static_cast<const AST_call*>(node.get());
+                const auto& name = *std::get<_Ptr_Str_t>(call->t.value);
+                if (self.empty() || name != self || param_index(name) >= 0) {
+                    return nullptr;
+                }
+                auto e = make(JitExpr::SELF_CALL, JitType::NONE);
+                for (const auto& a : call->args) {
+                    auto arg = _jit_lower(a, params, self, sig);
+                    if (!arg || e->kids.size() >= sig.size() || arg->type != sig[e->kids.size()]) {
+                        return nullptr;
+                    }
+                    e->kids.emplace_back(std::move(arg));
+                }
+                if (e->kids.size() != sig.size()) {
+                    return nullptr;
+                }
+                // 递归调用的结果类型先用假设的，_jit_call 再检查整个函数体是不是真的得到这个类型
+                e->type = _jit_self_type;
+                _jit_self_calls++;
+                return e;
+            }
+        default:
+            return nullptr;
+        }
+    }
+
+    // 四则运算和比较节点原来的运算符，特化过的编码在值里
+    static Tokens _arith_op(const Token& t) noexcept {
+        switch (t.token_type) {
+        case Tokens::INT_ARITH:
+        case Tokens::DBL_ARITH:
+        case Tokens::NUM_COMPARE:
+            return Tokens(std::get<int64_t>(t.value) & TypeInfer::OP_MASK);
+        default:
+            return t.token_type;
+        }
+    }
+
+    // 解释器里第 slot 个 let 槽在机器码帧里的位置
+    static constexpr size_t _jit_slot(size_t nparams, size_t slot) noexcept {
+        return nparams + slot * 3;
+    }
+
+    static inline int _opt_level = 2;
+    // 正在解释执行、因为机器码递归太深放弃过的 lambda，它们下面的调用不走 JIT
+    static inline thread_local std::vector<Lambda*> _jit_too_deep;
+
     Env* env;
     int paren_stack;
+    std::vector<std::string> _let_names; // 解析到当前位置时可见的 let 绑定，下标就是 slot 号
+    bool _parsed_loop = false; // 这次解析里出现过 dotimes/for
+    JitType _jit_self_type = JitType::NONE; // 只在 _jit_lower 里用
+    size_t _jit_self_calls = 0;
+    std::vector<JitType> _jit_local_types; // 按 let 槽号记当前绑定的类型，NONE 表示还没绑定
 };
 
 } // namespace austlisp
@@ -0,0 +1,302 @@
+#include "infer.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "output.hpp"
+
+namespace austlisp {
+
+namespace {
+
+StaticType _join(StaticType a, StaticType b) {
+    if (a == StaticType::NONE) {
+        return b;
+    }
+    if (b == StaticType::NONE || a == b) {
+        return a;
+    }
+    return StaticType::ANY;
+}
+
+bool _is_number(StaticType t) {
+    return t == StaticType::INT || t == StaticType::DBL;
+}
+
+const char* _op_name(Tokens op) {
+    switch (op) {
+    case Tokens::PLUS:
+        return "+";
+    case Tokens::MINUS:
+        return "-";
+    case Tokens::STAR:
+        return "*";
+    case Tokens::DIVISION:
+        return "/";
+    case Tokens::LOW:
+        return "<";
+    default:
+        return ">";
+    }
+}
+
+} // namespace
+
+TypeInfer::TypeInfer(const List& params, std::vector<StaticType> types)
+    : _params(params), _param_types(std::move(types)) {
+    _param_types.resize(_params.size(), StaticType::ANY);
+}
+
+void TypeInfer::run(std::unique_ptr<AST_base>& root) {
+    // 参数被 setq 成别的类型会影响前面已经看过的读，类型不再变了才改写
+    if (!_params.empty()) {
+        for (;;) {
+            auto before = _param_types;
+            _infer(root, false);
+            if (before == _param_types) {
+                break;
+            }
+        }
+    }
+    _infer(root, true);
+}
+
+int TypeInfer::_param_index(const AST_base* node) const {
+    if (node->t.token_type != Tokens::IDENT) {
+        return -1;
+    }
+    const auto& name = *std::get<_Ptr_Str_t>(node->t.value);
+    for (size_t i = 0; i < _params.size(); ++i) {
+        if (*std::get<_Ptr_Str_t>(_params[i].value) == name) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+void TypeInfer::_assign(const AST_base* target, StaticType type) {
+    if (target->t.token_type == Tokens::IDENT_LOCAL) {
+        auto slot    = size_t(std::get<int64_t>(target->t.value));
+        _slots[slot] = _join(_slots[slot], type);
+    } else if (auto i = _param_index(target); i >= 0) {
+        _param_types[i] = _join(_param_types[i], type);
+    }
+}
+
+StaticType TypeInfer::_infer_forms(std::vector<std::unique_ptr<AST_base>>& forms, bool rewrite) {
+    auto type = StaticType::ANY;
+    for (auto& form : forms) {
+        type = _infer(form, rewrite);
+    }
+    return type;
+}
+
+StaticType TypeInfer::_infer(std::unique_ptr<AST_base>& node, bool rewrite) {
+    if (!node) {
+        return StaticType::ANY;
+    }
+    switch (node->t.token_type) {
+    case Tokens::INTEGER:
+        return StaticType::INT;
+    case Tokens::DOUBLE:
+        return StaticType::DBL;
+    case Tokens::TRUE:
+    case Tokens::FALSE:
+        return StaticType::BOOL;
+    case Tokens::IDENT_LOCAL:
+        {
+            auto slot = size_t(std::get<int64_t>(node->t.value));
+            return slot < _slots.size() && _slots[slot] != StaticType::NONE ? _slots[slot] : StaticType::ANY;
+        }
+    case Tokens::IDENT:
+        {
+            auto i = _param_index(node.get());
+            return i < 0 ? StaticType::ANY : _param_types[i];
+        }
+    case Tokens::QUOTE:
+    case Tokens::K_LAMBDA: // 函数体调用时才解析，有自己的一次推断
+        return StaticType::ANY;
+    case Tokens::PLUS:
+    case Tokens::MINUS:
+    case Tokens::STAR:
+    case Tokens::DIVISION:
+    case Tokens::LOW:
+    case Tokens::GREAT:
+        return _infer_arith(node, rewrite);
+    case Tokens::INT_ARITH:
+    case Tokens::DBL_ARITH:
+    case Tokens::NUM_COMPARE:
+        // 已经改写过的(再优化一遍时)
+        _infer(node->left, rewrite);
+        _infer(node->right, rewrite);
+        return node->t.token_type == Tokens::INT_ARITH   ? StaticType::INT
+             : node->t.token_type == Tokens::DBL_ARITH ? StaticType::DBL
+                                                       : StaticType::BOOL;
+    case Tokens::K_IF:
+        {
+            auto if_node = static_cast<AST_if*>(node.get());
+            _infer(if_node->cond, rewrite);
+            auto then = _infer(node->left, rewrite);
+            return _join(then, _infer(node->right, rewrite));
+        }
+    case Tokens::K_SETQ:
+        _assign(node->left.get(), _infer(node->right, rewrite));
+        return StaticType::ANY;
+    case Tokens::IDENT_C:
+        for (auto& arg : static_cast<AST_call*>(node.get())->args) {
+            _infer(arg, rewrite);
+        }
+        return StaticType::ANY;
+    case Tokens::K_LET:
+    case Tokens::K_LET_STAR:
+        {
+            auto let = static_cast<AST_let*>(node.get());
+            size_t n = let->inits.size();
+            if (_slots.size() < let->base + n) {
+                _slots.resize(let->base + n, StaticType::NONE);
+                _slot_names.resize(let->base + n);
+            }
+            for (size_t i = 0; i < n; ++i) {
+                _slots[let->base + i]      = StaticType::NONE;
+                _slot_names[let->base + i] = i < let->names.size() ? let->names[i] : std::string();
+            }
+            // body 里的 setq 会放宽 slot 的类型，放宽到不再变为止，最后一遍才改写
+            auto pass = [&](bool rw) {
+                for (size_t i = 0; i < n; ++i) {
+                    _slots[let->base + i] = _join(_slots[let->base + i], _infer(let->inits[i], rw));
+                }
+                std::vector<StaticType> bound(_slots.begin() + let->base, _slots.begin() + let->base + n);
+                auto type = _infer_forms(let->body, rw);
+                return std::make_pair(type, !std::equal(bound.begin(), bound.end(), _slots.begin() + let->base));
+            };
+            auto result = pass(false);
+            while (result.second) {
+                result = pass(false);
+            }
+            return rewrite ? pass(true).first : result.first;
+        }
+    case Tokens::K_DOTIMES:
+    case Tokens::K_FOR:
+        {
+            auto loop = static_cast<AST_loop*>(node.get());
+            _infer(loop->from, rewrite);
+            _infer(loop->to, rewrite);
+            _infer(loop->step, rewrite);
+            if (_slots.size() <= loop->slot) {
+                _slots.resize(loop->slot + 1, StaticType::NONE);
+                _slot_names.resize(loop->slot + 1);
+            }
+            _slots[loop->slot]      = StaticType::INT;
+            _slot_names[loop->slot] = loop->name;
+            for (;;) {
+                auto before = _slots[loop->slot];
+                _infer_forms(loop->body, false);
+                if (before == _slots[loop->slot]) {
+                    break;
+                }
+            }
+            if (rewrite) {
+                _infer_forms(loop->body, true);
+            }
+            return StaticType::ANY;
+        }
+    default:
+        _infer(node->left, rewrite);
+        _infer(node->right, rewrite);
+        return StaticType::ANY;
+    }
+}
+
+StaticType TypeInfer::_infer_arith(std::unique_ptr<AST_base>& node, bool rewrite) {
+    auto op      = node->t.token_type;
+    auto left    = _infer(node->left, rewrite);
+    auto right   = _infer(node->right, rewrite);
+    bool compare = op == Tokens::LOW || op == Tokens::GREAT;
+    bool numbers = node->left && node->right && _is_number(left) && _is_number(right);
+    bool ints    = numbers && left == StaticType::INT && right == StaticType::INT;
+    auto type    = !numbers ? StaticType::ANY : compare ? StaticType::BOOL : ints ? StaticType::INT : StaticType::DBL;
+
+    // 整数除以 0 要报错，只有除数是非零常量时才能证明不会出错
+    bool safe = !(ints && op == Tokens::DIVISION)
+             || (node->right->t.token_type == Tokens::INTEGER && std::get<int64_t>(node->right->t.value) != 0);
+    if (!numbers || !safe) {
+        // 除 0 时 do_division 返回 nil，所以结果类型也不确定
+        if (rewrite) {
+            std::string why;
+            if (!numbers) {
+                const auto& unknown = _is_number(left) ? node->right : node->left;
+                why = unknown ? _text(unknown.get()) + " 的类型不确定" : std::string("缺少操作数");
+            } else {
+                why = "整数除法的除数不是非零常量";
+            }
+            unspecialized.emplace_back(_text(node.get()) + ": " + why);
+        }
+        return StaticType::ANY;
+    }
+    if (rewrite) {
+        int64_t flags = int64_t(op) | (left == StaticType::INT ? LEFT_INT : 0) | (right == StaticType::INT ? RIGHT_INT : 0);
+        node->t.token_type = compare ? Tokens::NUM_COMPARE : ints ? Tokens::INT_ARITH : Tokens::DBL_ARITH;
+        node->t.value      = flags;
+    }
+    return type;
+}
+
+// 报告里用的源码形式，只需要认得出是哪个表达式
+std::string TypeInfer::_text(const AST_base* node) const {
+    if (node == nullptr) {
+        return "nil";
+    }
+    switch (node->t.token_type) {
+    case Tokens::INTEGER:
+    case Tokens::DOUBLE:
+    case Tokens::TRUE:
+    case Tokens::FALSE:
+        {
+            std::string out;
+            display(out, node->t);
+            return out;
+        }
+    case Tokens::STRING:
+        return "\"" + std::string(std::get<Str>(node->t.value).view()) + "\"";
+    case Tokens::IDENT:
+    case Tokens::IDENT_GLOBAL:
+        return *std::get<_Ptr_Str_t>(node->t.value);
+    case Tokens::IDENT_LOCAL:
+        {
+            auto slot = size_t(std::get<int64_t>(node->t.value));
+            return slot < _slot_names.size() && !_slot_names[slot].empty() ? _slot_names[slot] : "<let>";
+        }
+    case Tokens::PLUS:
+    case Tokens::MINUS:
+    case Tokens::STAR:
+    case Tokens::DIVISION:
+    case Tokens::LOW:
+    case Tokens::GREAT:
+        return std::string("(") + _op_name(node->t.token_type) + " " + _text(node->left.get()) + " "
+             + _text(node->right.get()) + ")";
+    case Tokens::INT_ARITH:
+    case Tokens::DBL_ARITH:
+    case Tokens::NUM_COMPARE:
+        return std::string("(") + _op_name(Tokens(std::get<int64_t>(node->t.value) & OP_MASK)) + " "
+             + _text(node->left.get()) + " " + _text(node->right.get()) + ")";
+    case Tokens::IDENT_C:
+        {
+            auto call       = static_cast<const AST_call*>(node);
+            std::string out = "(" + *std::get<_Ptr_Str_t>(call->t.value);
+            for (const auto& arg : call->args) {
+                out += ' ';
+                out += _text(arg.get());
+            }
+            return out + ")";
+        }
+    case Tokens::K_IF:
+        return "(if ...)";
+    case Tokens::K_LET:
+    case Tokens::K_LET_STAR:
+        return "(let ...)";
+    default:
+        return "(...)";
+    }
+}
+
+} // namespace austlisp
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef _INFER_HPP_
+#define _INFER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "lisp.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  对一个函数体(或者一个顶层表达式)做类型推断，把两边类型都能证明是数字的四则运算和比较
+ *  改写成 INT_ARITH / DBL_ARITH / NUM_COMPARE，求值时直接算 int64/double，不再按 token_type 分派。
+ *  类型来自字面量、参数的类型标注、let 的初值和循环变量；let 变量和参数被 setq 成别的类型时退化成 ANY。
+ *  整个函数体做不动点迭代，所以 setq 出现在读之后(比如 while 里)也能看到。
+ *  整数除法只在除数是非零常量时特化，其他情况可能要报除 0 的错，留给 do_division。
+ */
+class TypeInfer {
+public:
+    // 特化节点 t.value 的编码：低 8 位是原来的运算符，再往上两位表示左右操作数是整数
+    static constexpr int64_t OP_MASK   = 0xff;
+    static constexpr int64_t LEFT_INT  = 1 << 8;
+    static constexpr int64_t RIGHT_INT = 1 << 9;
+
+    // params 是参数名，types 是对应的类型(没有标注的是 ANY)；顶层表达式两个都是空的
+    TypeInfer(const List& params, std::vector<StaticType> types);
+
+    void run(std::unique_ptr<AST_base>& root);
+
+    // 没能特化的运算，每条是 "(+ n s): s 的类型不确定" 这样的一句
+    std::vector<std::string> unspecialized;
+
+private:
+    StaticType _infer(std::unique_ptr<AST_base>& node, bool rewrite);
+    StaticType _infer_forms(std::vector<std::unique_ptr<AST_base>>& forms, bool rewrite);
+    StaticType _infer_arith(std::unique_ptr<AST_base>& node, bool rewrite);
+    void _assign(const AST_base* target, StaticType type);
+    int _param_index(const AST_base* node) const;
+    std::string _text(const AST_base* node) const;
+
+    const List& _params;
+    std::vector<StaticType> _param_types;
+    std::vector<StaticType> _slots; // let 和循环变量的类型，按 slot 号
+    std::vector<std::string> _slot_names;
+};
+
+// 被特化成整数/浮点运算的参数在运行时变成了别的类型，只有调用链上的别的函数 setq 它才会出现
+class TypeMismatch : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+} // namespace austlisp
+
+#endif
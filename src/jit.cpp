@@ -0,0 +1,395 @@
+#include "jit.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <initializer_list>
+
+namespace austlisp {
+
+namespace {
+
+#if defined(__x86_64__)
+
+/**
+ * 模板式代码生成：表达式的值总是放在 rax(浮点就是 rax 里的位模式)，二元运算先把左边压栈。
+ * rbx 指向当前调用的栈帧(参数的拷贝加上局部槽)，r12 指向 JitContext。
+ */
+class Emitter {
+public:
+    bool function(const JitExpr& body, size_t nparams, size_t nslots) {
+        code.reserve(256);
+        emit({0x55}); // push rbp
+        emit({0x48, 0x89, 0xE5}); // mov rbp, rsp
+        emit({0x53}); // push rbx
+        emit({0x41, 0x54}); // push r12
+        // 槽数凑成偶数，rsp 保持 16 字节对齐
+        size_t frame = (nslots + 1) / 2 * 2;
+        if (frame > 0) {
+            emit({0x48, 0x81, 0xEC}); // sub rsp, imm32
+            imm32(int32_t(frame * 8));
+        }
+        for (size_t i = 0; i < nparams; ++i) {
+            emit({0x48, 0x8B, 0x87}); // mov rax, [rdi+disp32]
+            imm32(int32_t(i * 8));
+            emit({0x48, 0x89, 0x84, 0x24}); // mov [rsp+disp32], rax
+            imm32(int32_t(i * 8));
+        }
+        emit({0x48, 0x89, 0xE3}); // mov rbx, rsp
+        emit({0x49, 0x89, 0xF4}); // mov r12, rsi
+        // 递归深度检查
+        emit({0x41, 0x8B, 0x44, 0x24, 0x04}); // mov eax, [r12+4]
+        emit({0xFF, 0xC0}); // inc eax
+        emit({0x41, 0x89, 0x44, 0x24, 0x04}); // mov [r12+4], eax
+        emit({0x3D});
+        imm32(int32_t(JitFunction::MAX_DEPTH)); // cmp eax, MAX_DEPTH
+        size_t too_deep = jcc(0x87); // ja too_deep
+
+        if (!expr(body)) {
+            return false;
+        }
+
+        size_t epilogue = code.size();
+        emit({0x41, 0xFF, 0x4C, 0x24, 0x04}); // dec dword [r12+4]
+        emit({0x48, 0x8D, 0x65, 0xF0}); // lea rsp, [rbp-16]
+        emit({0x41, 0x5C}); // pop r12
+        emit({0x5B}); // pop rbx
+        emit({0x5D}); // pop rbp
+        emit({0xC3}); // ret
+
+        patch(too_deep, code.size());
+        emit({0x41, 0xC6, 0x44, 0x24, 0x01, 0x01}); // mov byte [r12+1], 1，接着走 bail
+        size_t bail = code.size();
+        emit({0x41, 0xC6, 0x04, 0x24, 0x01}); // mov byte [r12], 1
+        patch(jmp(), epilogue);
+        for (auto at : _bails) {
+            patch(at, bail);
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> code;
+
+private:
+    bool expr(const JitExpr& e) {
+        switch (e.op) {
+        case JitExpr::CONST:
+            emit({0x48, 0xB8}); // mov rax, imm64
+            imm64(e.value);
+            return true;
+        case JitExpr::ARG:
+            emit({0x48, 0x8B, 0x83}); // mov rax, [rbx+disp32]
+            imm32(int32_t(e.value * 8));
+            return true;
+        case JitExpr::SETQ:
+            if (!expr(*e.kids[0])) {
+                return false;
+            }
+            emit({0x48, 0x89, 0x83}); // mov [rbx+disp32], rax
+            imm32(int32_t(e.value * 8));
+            return true;
+        case JitExpr::ADD:
+        case JitExpr::SUB:
+        case JitExpr::MUL:
+        case JitExpr::DIV:
+        case JitExpr::LT:
+        case JitExpr::GT:
+            return binary(e);
+        case JitExpr::IF:
+            {
+                if (!expr(*e.kids[0])) {
+                    return false;
+                }
+                emit({0x48, 0x85, 0xC0}); // test rax, rax
+                size_t to_else = jcc(0x84); // jz else
+                if (!expr(*e.kids[1])) {
+                    return false;
+                }
+                size_t to_end = jmp();
+                patch(to_else, code.size());
+                if (!expr(*e.kids[2])) {
+                    return false;
+                }
+                patch(to_end, code.size());
+                return true;
+            }
+        case JitExpr::WHILE:
+            {
+                size_t loop = code.size();
+                if (!expr(*e.kids[0])) {
+                    return false;
+                }
+                emit({0x48, 0x85, 0xC0}); // test rax, rax
+                size_t to_end = jcc(0x84); // jz end
+                if (!expr(*e.kids[1])) {
+                    return false;
+                }
+                patch(jmp(), loop);
+                patch(to_end, code.size());
+                return true;
+            }
+        case JitExpr::SELF_CALL:
+            return self_call(e);
+        case JitExpr::SEQ:
+            for (const auto& kid : e.kids) {
+                if (!expr(*kid)) {
+                    return false;
+                }
+            }
+            return true;
+        case JitExpr::FOR:
+            return counted_loop(e);
+        }
+        return false;
+    }
+
+    bool binary(const JitExpr& e) {
+        const auto& lhs = *e.kids[0];
+        const auto& rhs = *e.kids[1];
+        if (!expr(lhs)) {
+            return false;
+        }
+        push();
+        if (!expr(rhs)) {
+            return false;
+        }
+        emit({0x48, 0x89, 0xC1}); // mov rcx, rax
+        pop_rax();
+
+        if (lhs.type == JitType::INT && rhs.type == JitType::INT) {
+            switch (e.op) {
+            case JitExpr::ADD:
+                emit({0x48, 0x01, 0xC8}); // add rax, rcx
+                break;
+            case JitExpr::SUB:
+                emit({0x48, 0x29, 0xC8}); // sub rax, rcx
+                break;
+            case JitExpr::MUL:
+                emit({0x48, 0x0F, 0xAF, 0xC1}); // imul rax, rcx
+                break;
+            case JitExpr::DIV:
+                {
+                    // 除 0 和 INT64_MIN / -1 交给解释器
+                    emit({0x48, 0x85, 0xC9}); // test rcx, rcx
+                    _bails.emplace_back(jcc(0x84));
+                    emit({0x48, 0x83, 0xF9, 0xFF}); // cmp rcx, -1
+                    emit({0x75, 0x13}); // jne +19，跳过下面的检查
+                    emit({0x48, 0xBA}); // mov rdx, INT64_MIN
+                    imm64(INT64_MIN);
+                    emit({0x48, 0x39, 0xD0}); // cmp rax, rdx
+                    _bails.emplace_back(jcc(0x84));
+                    emit({0x48, 0x99}); // cqo
+                    emit({0x48, 0xF7, 0xF9}); // idiv rcx
+                    break;
+                }
+            case JitExpr::LT:
+            case JitExpr::GT:
+                emit({0x48, 0x39, 0xC8}); // cmp rax, rcx
+                emit({0x0F, uint8_t(e.op == JitExpr::LT ? 0x9C : 0x9F), 0xC0}); // setl/setg al
+                emit({0x0F, 0xB6, 0xC0}); // movzx eax, al
+                break;
+            default:
+                return false;
+            }
+            return true;
+        }
+
+        // 有一边是浮点就都转成 double
+        if (lhs.type == JitType::INT) {
+            emit({0xF2, 0x48, 0x0F, 0x2A, 0xC0}); // cvtsi2sd xmm0, rax
+        } else {
+            emit({0x66, 0x48, 0x0F, 0x6E, 0xC0}); // movq xmm0, rax
+        }
+        if (rhs.type == JitType::INT) {
+            emit({0xF2, 0x48, 0x0F, 0x2A, 0xC9}); // cvtsi2sd xmm1, rcx
+        } else {
+            emit({0x66, 0x48, 0x0F, 0x6E, 0xC9}); // movq xmm1, rcx
+        }
+        switch (e.op) {
+        case JitExpr::ADD:
+            emit({0xF2, 0x0F, 0x58, 0xC1}); // addsd xmm0, xmm1
+            break;
+        case JitExpr::SUB:
+            emit({0xF2, 0x0F, 0x5C, 0xC1}); // subsd xmm0, xmm1
+            break;
+        case JitExpr::MUL:
+            emit({0xF2, 0x0F, 0x59, 0xC1}); // mulsd xmm0, xmm1
+            break;
+        case JitExpr::DIV:
+            emit({0xF2, 0x0F, 0x5E, 0xC1}); // divsd xmm0, xmm1
+            break;
+        case JitExpr::LT:
+        case JitExpr::GT:
+            // seta 在 NaN 时为 0，和 do_compare 一致
+            if (e.op == JitExpr::LT) {
+                emit({0x66, 0x0F, 0x2E, 0xC8}); // ucomisd xmm1, xmm0
+            } else {
+                emit({0x66, 0x0F, 0x2E, 0xC1}); // ucomisd xmm0, xmm1
+            }
+            emit({0x0F, 0x97, 0xC0}); // seta al
+            emit({0x0F, 0xB6, 0xC0}); // movzx eax, al
+            return true;
+        default:
+            return false;
+        }
+        emit({0x66, 0x48, 0x0F, 0x7E, 0xC0}); // movq rax, xmm0
+        return true;
+    }
+
+    // 计数器和终点各占一个槽，循环变量每轮从计数器拷一份，body 改它不影响次数
+    bool counted_loop(const JitExpr& e) {
+        int32_t var = int32_t(e.value * 8), counter = var + 8, end = var + 16;
+        if (!expr(*e.kids[0])) {
+            return false;
+        }
+        store(counter);
+        if (!expr(*e.kids[1])) {
+            return false;
+        }
+        store(end);
+        size_t loop = code.size();
+        load(counter);
+        emit({0x48, 0x3B, 0x83}); // cmp rax, [rbx+disp32]
+        imm32(end);
+        std::vector<size_t> to_end{jcc(e.step > 0 ? 0x8D : 0x8E)}; // jge/jle end
+        store(var);
+        if (!expr(*e.kids[2])) {
+            return false;
+        }
+        load(counter);
+        if (e.step >= INT32_MIN && e.step <= INT32_MAX) {
+            emit({0x48, 0x05}); // add rax, imm32
+            imm32(int32_t(e.step));
+        } else {
+            emit({0x48, 0xB9}); // mov rcx, imm64，步长放不进 imm32
+            imm64(e.step);
+            emit({0x48, 0x01, 0xC8}); // add rax, rcx
+        }
+        to_end.emplace_back(jcc(0x80)); // jo end，和解释器一样溢出就停
+        store(counter);
+        patch(jmp(), loop);
+        for (auto at : to_end) {
+            patch(at, code.size());
+        }
+        return true;
+    }
+
+    void load(int32_t disp) {
+        emit({0x48, 0x8B, 0x83}); // mov rax, [rbx+disp32]
+        imm32(disp);
+    }
+    void store(int32_t disp) {
+        emit({0x48, 0x89, 0x83}); // mov [rbx+disp32], rax
+        imm32(disp);
+    }
+
+    bool self_call(const JitExpr& e) {
+        // 从右往左求值压栈，这样参数在栈上正好是从低到高的数组
+        size_t n = e.kids.size();
+        for (size_t i = n; i-- > 0;) {
+            if (!expr(*e.kids[i])) {
+                return false;
+            }
+            push();
+        }
+        emit({0x48, 0x89, 0xE7}); // mov rdi, rsp
+        bool pad = _depth % 2 != 0; // call 时 rsp 要 16 字节对齐
+        if (pad) {
+            emit({0x48, 0x83, 0xEC, 0x08}); // sub rsp, 8
+        }
+        emit({0x4C, 0x89, 0xE6}); // mov rsi, r12
+        emit({0xE8}); // call entry
+        imm32(int32_t(0 - int64_t(code.size() + 4)));
+        emit({0x48, 0x81, 0xC4}); // add rsp, imm32
+        imm32(int32_t(8 * (n + (pad ? 1 : 0))));
+        _depth -= n;
+        emit({0x41, 0x80, 0x3C, 0x24, 0x00}); // cmp byte [r12], 0
+        _bails.emplace_back(jcc(0x85)); // 被调用的那层 deopt 了，这层也放弃
+        return true;
+    }
+
+    void push() {
+        emit({0x50}); // push rax
+        _depth++;
+    }
+    void pop_rax() {
+        emit({0x58}); // pop rax
+        _depth--;
+    }
+
+    void emit(std::initializer_list<uint8_t> bytes) {
+        code.insert(code.end(), bytes);
+    }
+    void imm32(int32_t v) {
+        uint8_t buf[4];
+        std::memcpy(buf, &v, 4);
+        code.insert(code.end(), buf, buf + 4);
+    }
+    void imm64(int64_t v) {
+        uint8_t buf[8];
+        std::memcpy(buf, &v, 8);
+        code.insert(code.end(), buf, buf + 8);
+    }
+    // 返回 rel32 的位置，之后用 patch 填
+    size_t jcc(uint8_t cc) {
+        emit({0x0F, cc});
+        imm32(0);
+        return code.size() - 4;
+    }
+    size_t jmp() {
+        emit({0xE9});
+        imm32(0);
+        return code.size() - 4;
+    }
+    void patch(size_t at, size_t target) {
+        int32_t rel = int32_t(int64_t(target) - int64_t(at + 4));
+        std::memcpy(code.data() + at, &rel, 4);
+    }
+
+    size_t _depth = 0; // prologue 之后压栈的 8 字节个数
+    std::vector<size_t> _bails;
+};
+
+#endif
+
+} // namespace
+
+std::unique_ptr<JitFunction> JitFunction::compile(const JitExpr& body, size_t nparams, size_t nslots) {
+#if defined(__x86_64__)
+    Emitter emitter;
+    if (!emitter.function(body, nparams, nslots)) {
+        return nullptr;
+    }
+    // 先写后改成只读可执行，不留 W+X 的页
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t size = (emitter.code.size() + page - 1) / page * page;
+    void* mem   = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(mem, emitter.code.data(), emitter.code.size());
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return nullptr;
+    }
+    return std::unique_ptr<JitFunction>(new JitFunction(mem, size, body.type));
+#else
+    (void) body;
+    (void) nparams;
+    (void) nslots;
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<JitFunction> JitFunction::native(Entry entry, JitType result_type) {
+    return std::unique_ptr<JitFunction>(new JitFunction(entry, result_type));
+}
+
+JitFunction::~JitFunction() {
+    if (_code != nullptr) {
+        munmap(_code, _size);
+    }
+}
+
+} // namespace austlisp
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef _JIT_HPP_
+#define _JIT_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace austlisp {
+
+/**
+ * 第一层 JIT：把热的数值 lambda 按模板直接翻译成 x86-64 机器码，不依赖任何外部 JIT 库。
+ * 只覆盖整数/浮点运算、比较、if、while、let、dotimes/for、对参数和局部变量的 setq 和调用自己，这些都没有副作用，
+ * 所以机器码里类型检查失败(除零、递归太深)时直接放弃，整个调用回到解释器从头再算一遍即可。
+ */
+enum class JitType : uint8_t {
+    INT,
+    DBL,
+    BOOL,
+    NONE,
+};
+
+// Eval 从 AST 翻译过来的中间表示，每个节点的类型在翻译时就确定了
+struct JitExpr {
+    enum Op : uint8_t {
+        CONST,
+        ARG,
+        ADD,
+        SUB,
+        MUL,
+        DIV,
+        LT,
+        GT,
+        IF, // kids: cond, then, else
+        WHILE, // kids: cond, body
+        SETQ, // value 是参数下标，kids: 新值
+        SELF_CALL,
+        SEQ, // 依次求值，结果是最后一个
+        FOR, // value 是循环变量的槽号，后面两个槽放计数器和终点；kids: 起点, 终点, body
+    };
+    Op op;
+    JitType type;
+    int64_t value = 0; // CONST 的位模式，ARG/SETQ/FOR 的槽号
+    int64_t step  = 1; // 只有 FOR 用，翻译时就要知道是常量
+    std::vector<std::unique_ptr<JitExpr>> kids;
+};
+
+struct JitContext {
+    uint8_t deopt    = 0;
+    uint8_t too_deep = 0; // deopt 是因为递归超过 MAX_DEPTH，不是除 0 这些
+    uint32_t depth   = 0;
+};
+
+class JitFunction {
+public:
+    using Entry = int64_t (*)(int64_t* args, JitContext* ctx);
+
+    static constexpr uint32_t MAX_DEPTH = 1024; // 再深就交给解释器，别在机器码里把栈撑爆
+
+    // 帧里前 nparams 个槽是参数的拷贝，后面是 let 和循环用的局部槽，一共 nslots 个。
+    // 不支持的平台或者代码申请不到可执行内存时返回 nullptr
+    static std::unique_ptr<JitFunction> compile(const JitExpr& body, size_t nparams, size_t nslots);
+    // --emit-cpp 生成的程序里已经由 C++ 编译器编好的函数，调用约定和机器码一样
+    static std::unique_ptr<JitFunction> native(Entry entry, JitType result_type);
+
+    // args 只读，进来先拷进机器码自己的栈帧；返回 false 表示需要 deopt，too_deep 说明是不是递归太深
+    bool run(int64_t* args, int64_t& out, bool& too_deep) const noexcept {
+        JitContext ctx;
+        out      = _entry(args, &ctx);
+        too_deep = ctx.too_deep != 0;
+        return ctx.deopt == 0;
+    }
+
+    JitType result_type() const noexcept {
+        return _result_type;
+    }
+
+    ~JitFunction();
+
+private:
+    JitFunction(void* code, size_t size, JitType result_type)
+        : _code(code), _size(size), _entry(reinterpret_cast<Entry>(code)), _result_type(result_type) {}
+    JitFunction(Entry entry, JitType result_type)
+        : _code(nullptr), _size(0), _entry(entry), _result_type(result_type) {}
+
+    void* _code; // native() 的是 nullptr，不归这里释放
+    size_t _size;
+    Entry _entry;
+    JitType _result_type;
+};
+
+// 挂在 Lambda 上：调用计数和按实参类型特化的机器码
+struct JitState {
+    static constexpr uint32_t HOT_CALLS = 16;
+
+    struct Variant {
+        std::vector<JitType> sig;
+        std::string self; // 编成 SELF_CALL 的名字，空串表示函数体里的调用都不是调用自己
+        std::unique_ptr<JitFunction> code;
+    };
+
+    std::atomic<uint32_t> calls{0};
+    std::mutex m;
+    // 编译失败的签名也记下来(nullptr)，不会反复尝试
+    std::vector<Variant> variants;
+};
+
+} // namespace austlisp
+
+#endif
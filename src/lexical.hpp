@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "lisp.hpp"
+#include "runtime_stats.hpp"
 
 namespace austlisp {
 
@@ -68,7 +69,7 @@ struct Token {
     Token reference() noexcept {
         return Token{this->token_type, (int64_t)(this) };
     }
-    // is indent is lambda, we can't just do a fucking copy, a lambda object maybe very big
+    // LIST 深拷贝；STRING 不可变，lambda 可能很大，都只共享不复制
     Token copy() const {
         switch (token_type) {
         case Tokens::DOUBLE:
@@ -87,21 +88,44 @@ struct Token {
             }
         case Tokens::LIST:
             {
+                const auto& list = *std::get<std::unique_ptr<List>>(value);
+                RuntimeCounters::bump(runtime_counters.token_copies);
+                RuntimeCounters::bump(runtime_counters.list_bytes_copied, list.size() * sizeof(Token));
                 Token tt;
                 tt.token_type = Tokens::LIST;
-                tt.value      = std::make_unique<List>(*std::get<std::unique_ptr<List>>(value));
+                tt.value      = std::make_unique<List>(list);
                 return tt;
             }
-        case Tokens::K_LAMBDA:
+        case Tokens::STRING:
             {
-                std::cerr << "不可复制类型Lambda.\n";
-                return Token{};
+                Token tt;
+                tt.token_type = Tokens::STRING;
+                tt.value      = std::get<Str>(value);
+                return tt;
             }
+        case Tokens::K_LAMBDA:
+            // lambda 是共享的，不做深拷贝；关键字 lambda 本身的 token 存的是字符串，走 default
+            if (std::holds_alternative<_Ptr_Lambda_t>(value)) {
+                Token tt;
+                tt.token_type = Tokens::K_LAMBDA;
+                tt.value      = std::get<_Ptr_Lambda_t>(value);
+                return tt;
+            }
+            [[fallthrough]];
         default:
             {
                 Token tt;
                 tt.token_type = token_type;
-                tt.value      = std::make_unique<std::string>(*std::get<std::unique_ptr<std::string>>(value));
+                if (std::holds_alternative<int64_t>(value)) { // true/false/内建函数
+                    tt.value = std::get<int64_t>(value);
+                } else if (std::holds_alternative<_Ptr_Handle_t>(value)) { // 句柄共享
+                    tt.value = std::get<_Ptr_Handle_t>(value);
+                } else {
+                    const auto& str = *std::get<std::unique_ptr<std::string>>(value);
+                    RuntimeCounters::bump(runtime_counters.token_copies);
+                    RuntimeCounters::bump(runtime_counters.string_bytes_copied, str.size());
+                    tt.value = std::make_unique<std::string>(str);
+                }
                 return tt;
             }
         }
@@ -162,6 +186,14 @@ public:
                 str = source[i++];
                 t   = Tokens::DIVISION;
                 break;
+            case '<':
+                str = source[i++];
+                t   = Tokens::LOW;
+                break;
+            case '>':
+                str = source[i++];
+                t   = Tokens::GREAT;
+                break;
             case '\'':
                 str = source[i++];
                 t   = Tokens::QUOTE; // such as '(1 2 3) or (quote (1 2 3))
@@ -177,7 +209,8 @@ public:
             default:
             default_handle:
                 if (std::isalpha(source[i]) || source[i] == '_') {
-                    while (std::isalnum(source[i]) || source[i] == '_') {
+                    // 和其他 lisp 一样，符号中间允许出现 '-' 和 '*'，例如 pfor-each、let*
+                    while (std::isalnum(source[i]) || source[i] == '_' || source[i] == '-' || source[i] == '*') {
                         str += source[i++];
                     }
                     if (Tokens _k_xxx = _is_keywords(str); _k_xxx != Tokens::NONE) {
@@ -213,7 +246,7 @@ public:
                     }
                 }
             }
-            if (str == "") {
+            if (str == "" && t != Tokens::STRING) { // "" 是合法的空字符串
                 std::cerr << "unknown character '" << source[i++] << "' ignored." << std::endl;
             } else {
                 // NOTE: 这里疑似有一个GCC的bug，在std::variant添加一个函数指针后，怎么t.value成空值了？
@@ -230,8 +263,7 @@ public:
             } else if (i.token_type == Tokens::INTEGER) {
                 std::cout << "[ " << Tokens_str[int(i.token_type)] << ": " << get<int64_t>(i.value) << " ], ";
             } else if (i.token_type == Tokens::STRING) {
-                std::cout << "[ " << Tokens_str[int(i.token_type)] << ": \""
-                          << *get<std::unique_ptr<std::string>>(i.value) << "\" ], ";
+                std::cout << "[ " << Tokens_str[int(i.token_type)] << ": \"" << get<Str>(i.value) << "\" ], ";
             } else {
                 std::cout << "[ " << Tokens_str[int(i.token_type)] << ": "
                           << *get<std::unique_ptr<std::string>>(i.value) << " ], ";
@@ -250,6 +282,9 @@ protected:
         case Tokens::INTEGER:
             v = atol(str.c_str());
             break;
+        case Tokens::STRING:
+            v = Str(str);
+            break;
         default:
             v = std::make_unique<std::string>(str);
             break;
@@ -260,7 +295,14 @@ protected:
     Tokens _is_keywords(std::string_view str) {
         switch (str[0]) {
         case 'd':
-            return Tokens::K_DEFINE;
+            // 以前所有 d 开头的符号都被当成 define，deep、drop 这种名字就没法用
+            if (str == "define") {
+                return Tokens::K_DEFINE;
+            } else if (str == "dotimes") {
+                return Tokens::K_DOTIMES;
+            } else {
+                return Tokens::NONE;
+            }
         case 's':
             if (str == "setq") {
                 return Tokens::K_SETQ;
@@ -270,6 +312,10 @@ protected:
         case 'l':
             if (str == "lambda") {
                 return Tokens::K_LAMBDA;
+            } else if (str == "let") {
+                return Tokens::K_LET;
+            } else if (str == "let*") {
+                return Tokens::K_LET_STAR;
             } else {
                 return Tokens::NONE;
             }
@@ -297,6 +343,8 @@ protected:
         case 'f':
             if (str == "false")
                 return Tokens::FALSE;
+            if (str == "for")
+                return Tokens::K_FOR;
             return Tokens::NONE;
         case 'w':
             if (str == "while")
@@ -316,6 +364,10 @@ private:
         "quote",
         "while",
         "nil",
+        "let",
+        "let*",
+        "dotimes",
+        "for",
     };
 
 public:
@@ -6,9 +6,12 @@
 
 #include <cctype>
 #include <memory>
+#include <string>
 #include <variant>
 #include <vector>
 
+#include "lstring.hpp"
+
 #define KEYWORDS_NUM 5
 
 namespace austlisp {
@@ -44,38 +47,184 @@ enum class Tokens {
     K_SETQ,
     K_WHILE,
     K_QUOTE,
+    _BUILDIN_PMAP, // 并行版本，只适用于不修改共享状态的 lambda
+    _BUILDIN_PREDUCE,
+    _BUILDIN_PFOREACH,
+    _BUILDIN_SPAWN, // 协作式任务和channel
+    _BUILDIN_AWAIT,
+    _BUILDIN_CHANNEL,
+    _BUILDIN_SEND,
+    _BUILDIN_RECV,
+    _BUILDIN_YIELD,
+    _BUILDIN_MEMOIZE,
+    _BUILDIN_MEMO_STATS,
+    _BUILDIN_MEMO_CLEAR,
+    _BUILDIN_RUNTIME_STATS,
+    IDENT_CAPTURED, // 按下标访问的闭包捕获变量，只出现在 AST 上
+    TASK, // spawn 返回的任务句柄
+    CHANNEL,
+    K_LET, // (let ((a 1) (b 2)) body...)，绑定存在帧的 slot 里，不进符号表
+    K_LET_STAR, // 和 let 一样，只是后面的初值能看到前面的绑定
+    IDENT_LOCAL, // 按下标访问的 let 绑定，只出现在 AST 上
+    K_DOTIMES, // (dotimes (i n) body...)
+    K_FOR, // (for (i from to [step]) body...)
+    SEQ, // 惰性序列，值是 Seq 句柄
+    _BUILDIN_RANGE,
+    _BUILDIN_LAZY_MAP,
+    _BUILDIN_LAZY_FILTER,
+    _BUILDIN_TAKE,
+    _BUILDIN_ITERATE,
+    _BUILDIN_REDUCE,
+    _BUILDIN_COLLECT,
+    _BUILDIN_LENGTH,
+    _BUILDIN_NTH,
+    _BUILDIN_APPEND,
+    _BUILDIN_REVERSE,
+    _BUILDIN_MAP,
+    _BUILDIN_FILTER,
+    _BUILDIN_MEMBER,
+    _BUILDIN_ASSOC,
+    STRING_BUILDER, // 值是 StrBuilder 句柄
+    _BUILDIN_STRING_BUILDER,
+    _BUILDIN_BUILDER_APPEND,
+    _BUILDIN_BUILDER_STRING,
+    _BUILDIN_STRING_JOIN,
+    _BUILDIN_SUBSTRING,
+    _BUILDIN_STRING_LENGTH,
+    _BUILDIN_DISPLAY,
+    _BUILDIN_PRINT,
+    _BUILDIN_FORMAT,
+    TABLE, // 值是 Table 句柄
+    _BUILDIN_LOAD_CSV,
+    _BUILDIN_TABLE_ROWS,
+    _BUILDIN_TABLE_COLUMNS,
+    _BUILDIN_TABLE_COLUMN,
+    _BUILDIN_TABLE_REF,
+    BYTEVECTOR, // 值是 Bytevector 句柄
+    _BUILDIN_MAKE_BYTEVECTOR,
+    _BUILDIN_BYTEVECTOR_LENGTH,
+    _BUILDIN_BYTEVECTOR_SLICE,
+    _BUILDIN_READ_FILE_BYTES,
+    _BUILDIN_WRITE_FILE_BYTES,
+    _BUILDIN_BYTEVECTOR_U8_REF,
+    _BUILDIN_BYTEVECTOR_U8_SET,
+    _BUILDIN_BYTEVECTOR_U32_REF,
+    _BUILDIN_BYTEVECTOR_U32_SET,
+    _BUILDIN_BYTEVECTOR_I64_REF,
+    _BUILDIN_BYTEVECTOR_I64_SET,
+    _BUILDIN_BYTEVECTOR_F64_REF,
+    _BUILDIN_BYTEVECTOR_F64_SET,
+    IDENT_GLOBAL, // 全局变量的引用，第一次求值后直接指向全局环境里的绑定，只出现在 AST 上
+    INT_ARITH, // 类型推断证明了两边都是整数的四则运算，值里编码了原来的运算符，只出现在 AST 上
+    DBL_ARITH, // 结果是浮点数的四则运算
+    NUM_COMPARE, // 两边都是数字的比较
+    _BUILDIN_TYPE_REPORT,
+    _BUILDIN_SORT,
 };
 
 static constexpr const char* Tokens_str[] = {
-    [int(Tokens::NONE)]           = "",
-    [int(Tokens::LPAREN)]         = "T_LPAREN",
-    [int(Tokens::RPAREN)]         = "T_RPAREN",
-    [int(Tokens::KEYWORDS)]       = "T_KEYWORDS",
-    [int(Tokens::INTEGER)]        = "T_INTEGER",
-    [int(Tokens::DOUBLE)]         = "T_DOUBLE",
-    [int(Tokens::PLUS)]           = "T_PLUS",
-    [int(Tokens::MINUS)]          = "T_MINUS",
-    [int(Tokens::STAR)]           = "T_STAR",
-    [int(Tokens::DIVISION)]       = "T_DIVISION",
-    [int(Tokens::LOW)]            = "T_LOW",
-    [int(Tokens::GREAT)]          = "T_GREAT",
-    [int(Tokens::IDENT)]          = "T_IDENT",
-    [int(Tokens::IDENT_C)]        = "T_IDENT_C",
-    [int(Tokens::STRING)]         = "T_STRING",
-    [int(Tokens::QUOTE)]          = "T_QUOTE",
-    [int(Tokens::LIST)]           = "T_LIST",
-    [int(Tokens::TRUE)]           = "T_TRUE",
-    [int(Tokens::FALSE)]          = "T_FLASE",
-    [int(Tokens::K_DEFINE)]       = "K_DEFINE",
-    [int(Tokens::K_IF)]           = "K_IF",
-    [int(Tokens::K_LAMBDA)]       = "K_LAMBDA",
-    [int(Tokens::_BUILDIN_CAR)]   = "_BUILDIN_FUNC_CAR", // 一些常用的lisp内建函数，write by CXX
-    [int(Tokens::_BUILDIN_CDR)]   = "_BUILDIN_FUNC_CDR",
-    [int(Tokens::_BUILDIN_EQ)]    = "_BUILDIN_FUNC_EQ",
-    [int(Tokens::_BUILDIN_EQUAL)] = "_BUILDIN_FUNC_EQUAL",
-    [int(Tokens::K_SETQ)]         = "K_SETQ",
-    [int(Tokens::K_WHILE)]        = "K_WHILE",
-    [int(Tokens::K_QUOTE)]        = "K_QUOTE",
+    [int(Tokens::NONE)]                        = "",
+    [int(Tokens::LPAREN)]                      = "T_LPAREN",
+    [int(Tokens::RPAREN)]                      = "T_RPAREN",
+    [int(Tokens::KEYWORDS)]                    = "T_KEYWORDS",
+    [int(Tokens::INTEGER)]                     = "T_INTEGER",
+    [int(Tokens::DOUBLE)]                      = "T_DOUBLE",
+    [int(Tokens::PLUS)]                        = "T_PLUS",
+    [int(Tokens::MINUS)]                       = "T_MINUS",
+    [int(Tokens::STAR)]                        = "T_STAR",
+    [int(Tokens::DIVISION)]                    = "T_DIVISION",
+    [int(Tokens::LOW)]                         = "T_LOW",
+    [int(Tokens::GREAT)]                       = "T_GREAT",
+    [int(Tokens::IDENT)]                       = "T_IDENT",
+    [int(Tokens::IDENT_C)]                     = "T_IDENT_C",
+    [int(Tokens::STRING)]                      = "T_STRING",
+    [int(Tokens::QUOTE)]                       = "T_QUOTE",
+    [int(Tokens::LIST)]                        = "T_LIST",
+    [int(Tokens::TRUE)]                        = "T_TRUE",
+    [int(Tokens::FALSE)]                       = "T_FLASE",
+    [int(Tokens::K_DEFINE)]                    = "K_DEFINE",
+    [int(Tokens::K_IF)]                        = "K_IF",
+    [int(Tokens::K_LAMBDA)]                    = "K_LAMBDA",
+    [int(Tokens::_BUILDIN_CAR)]                = "_BUILDIN_FUNC_CAR", // 一些常用的lisp内建函数，write by CXX
+    [int(Tokens::_BUILDIN_CDR)]                = "_BUILDIN_FUNC_CDR",
+    [int(Tokens::_BUILDIN_EQ)]                 = "_BUILDIN_FUNC_EQ",
+    [int(Tokens::_BUILDIN_EQUAL)]              = "_BUILDIN_FUNC_EQUAL",
+    [int(Tokens::K_SETQ)]                      = "K_SETQ",
+    [int(Tokens::K_WHILE)]                     = "K_WHILE",
+    [int(Tokens::K_QUOTE)]                     = "K_QUOTE",
+    [int(Tokens::_BUILDIN_PMAP)]               = "_BUILDIN_FUNC_PMAP",
+    [int(Tokens::_BUILDIN_PREDUCE)]            = "_BUILDIN_FUNC_PREDUCE",
+    [int(Tokens::_BUILDIN_PFOREACH)]           = "_BUILDIN_FUNC_PFOREACH",
+    [int(Tokens::_BUILDIN_SPAWN)]              = "_BUILDIN_FUNC_SPAWN",
+    [int(Tokens::_BUILDIN_AWAIT)]              = "_BUILDIN_FUNC_AWAIT",
+    [int(Tokens::_BUILDIN_CHANNEL)]            = "_BUILDIN_FUNC_CHANNEL",
+    [int(Tokens::_BUILDIN_SEND)]               = "_BUILDIN_FUNC_SEND",
+    [int(Tokens::_BUILDIN_RECV)]               = "_BUILDIN_FUNC_RECV",
+    [int(Tokens::_BUILDIN_YIELD)]              = "_BUILDIN_FUNC_YIELD",
+    [int(Tokens::_BUILDIN_MEMOIZE)]            = "_BUILDIN_FUNC_MEMOIZE",
+    [int(Tokens::_BUILDIN_MEMO_STATS)]         = "_BUILDIN_FUNC_MEMO_STATS",
+    [int(Tokens::_BUILDIN_MEMO_CLEAR)]         = "_BUILDIN_FUNC_MEMO_CLEAR",
+    [int(Tokens::_BUILDIN_RUNTIME_STATS)]      = "_BUILDIN_FUNC_RUNTIME_STATS",
+    [int(Tokens::IDENT_CAPTURED)]              = "T_IDENT_CAPTURED",
+    [int(Tokens::TASK)]                        = "T_TASK",
+    [int(Tokens::CHANNEL)]                     = "T_CHANNEL",
+    [int(Tokens::K_LET)]                       = "K_LET",
+    [int(Tokens::K_LET_STAR)]                  = "K_LET_STAR",
+    [int(Tokens::IDENT_LOCAL)]                 = "T_IDENT_LOCAL",
+    [int(Tokens::K_DOTIMES)]                   = "K_DOTIMES",
+    [int(Tokens::K_FOR)]                       = "K_FOR",
+    [int(Tokens::SEQ)]                         = "T_SEQ",
+    [int(Tokens::_BUILDIN_RANGE)]              = "_BUILDIN_FUNC_RANGE",
+    [int(Tokens::_BUILDIN_LAZY_MAP)]           = "_BUILDIN_FUNC_LAZY_MAP",
+    [int(Tokens::_BUILDIN_LAZY_FILTER)]        = "_BUILDIN_FUNC_LAZY_FILTER",
+    [int(Tokens::_BUILDIN_TAKE)]               = "_BUILDIN_FUNC_TAKE",
+    [int(Tokens::_BUILDIN_ITERATE)]            = "_BUILDIN_FUNC_ITERATE",
+    [int(Tokens::_BUILDIN_REDUCE)]             = "_BUILDIN_FUNC_REDUCE",
+    [int(Tokens::_BUILDIN_COLLECT)]            = "_BUILDIN_FUNC_COLLECT",
+    [int(Tokens::_BUILDIN_LENGTH)]             = "_BUILDIN_FUNC_LENGTH",
+    [int(Tokens::_BUILDIN_NTH)]                = "_BUILDIN_FUNC_NTH",
+    [int(Tokens::_BUILDIN_APPEND)]             = "_BUILDIN_FUNC_APPEND",
+    [int(Tokens::_BUILDIN_REVERSE)]            = "_BUILDIN_FUNC_REVERSE",
+    [int(Tokens::_BUILDIN_MAP)]                = "_BUILDIN_FUNC_MAP",
+    [int(Tokens::_BUILDIN_FILTER)]             = "_BUILDIN_FUNC_FILTER",
+    [int(Tokens::_BUILDIN_MEMBER)]             = "_BUILDIN_FUNC_MEMBER",
+    [int(Tokens::_BUILDIN_ASSOC)]              = "_BUILDIN_FUNC_ASSOC",
+    [int(Tokens::STRING_BUILDER)]              = "T_STRING_BUILDER",
+    [int(Tokens::_BUILDIN_STRING_BUILDER)]     = "_BUILDIN_FUNC_STRING_BUILDER",
+    [int(Tokens::_BUILDIN_BUILDER_APPEND)]     = "_BUILDIN_FUNC_BUILDER_APPEND",
+    [int(Tokens::_BUILDIN_BUILDER_STRING)]     = "_BUILDIN_FUNC_BUILDER_STRING",
+    [int(Tokens::_BUILDIN_STRING_JOIN)]        = "_BUILDIN_FUNC_STRING_JOIN",
+    [int(Tokens::_BUILDIN_SUBSTRING)]          = "_BUILDIN_FUNC_SUBSTRING",
+    [int(Tokens::_BUILDIN_STRING_LENGTH)]      = "_BUILDIN_FUNC_STRING_LENGTH",
+    [int(Tokens::_BUILDIN_DISPLAY)]            = "_BUILDIN_FUNC_DISPLAY",
+    [int(Tokens::_BUILDIN_PRINT)]              = "_BUILDIN_FUNC_PRINT",
+    [int(Tokens::_BUILDIN_FORMAT)]             = "_BUILDIN_FUNC_FORMAT",
+    [int(Tokens::TABLE)]                       = "T_TABLE",
+    [int(Tokens::_BUILDIN_LOAD_CSV)]           = "_BUILDIN_FUNC_LOAD_CSV",
+    [int(Tokens::_BUILDIN_TABLE_ROWS)]         = "_BUILDIN_FUNC_TABLE_ROWS",
+    [int(Tokens::_BUILDIN_TABLE_COLUMNS)]      = "_BUILDIN_FUNC_TABLE_COLUMNS",
+    [int(Tokens::_BUILDIN_TABLE_COLUMN)]       = "_BUILDIN_FUNC_TABLE_COLUMN",
+    [int(Tokens::_BUILDIN_TABLE_REF)]          = "_BUILDIN_FUNC_TABLE_REF",
+    [int(Tokens::BYTEVECTOR)]                  = "T_BYTEVECTOR",
+    [int(Tokens::_BUILDIN_MAKE_BYTEVECTOR)]    = "_BUILDIN_FUNC_MAKE_BYTEVECTOR",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_LENGTH)]  = "_BUILDIN_FUNC_BYTEVECTOR_LENGTH",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_SLICE)]   = "_BUILDIN_FUNC_BYTEVECTOR_SLICE",
+    [int(Tokens::_BUILDIN_READ_FILE_BYTES)]    = "_BUILDIN_FUNC_READ_FILE_BYTES",
+    [int(Tokens::_BUILDIN_WRITE_FILE_BYTES)]   = "_BUILDIN_FUNC_WRITE_FILE_BYTES",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_U8_REF)]  = "_BUILDIN_FUNC_BYTEVECTOR_U8_REF",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_U8_SET)]  = "_BUILDIN_FUNC_BYTEVECTOR_U8_SET",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_U32_REF)] = "_BUILDIN_FUNC_BYTEVECTOR_U32_REF",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_U32_SET)] = "_BUILDIN_FUNC_BYTEVECTOR_U32_SET",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_I64_REF)] = "_BUILDIN_FUNC_BYTEVECTOR_I64_REF",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_I64_SET)] = "_BUILDIN_FUNC_BYTEVECTOR_I64_SET",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_F64_REF)] = "_BUILDIN_FUNC_BYTEVECTOR_F64_REF",
+    [int(Tokens::_BUILDIN_BYTEVECTOR_F64_SET)] = "_BUILDIN_FUNC_BYTEVECTOR_F64_SET",
+    [int(Tokens::IDENT_GLOBAL)]                = "T_IDENT_GLOBAL",
+    [int(Tokens::INT_ARITH)]                   = "T_INT_ARITH",
+    [int(Tokens::DBL_ARITH)]                   = "T_DBL_ARITH",
+    [int(Tokens::NUM_COMPARE)]                 = "T_NUM_COMPARE",
+    [int(Tokens::_BUILDIN_TYPE_REPORT)]        = "_BUILDIN_FUNC_TYPE_REPORT",
+    [int(Tokens::_BUILDIN_SORT)]               = "_BUILDIN_FUNC_SORT",
 };
 
 struct Token;
@@ -86,8 +235,18 @@ using _Ptr_Str_t  = std::unique_ptr<std::string>;
 
 struct Lambda;
 
-using Value =
-    std::variant<int64_t, double, Token*, std::unique_ptr<List>, std::unique_ptr<Lambda>, std::unique_ptr<std::string>>;
+// lambda 创建后不再修改，共享所有权，复制只是加个引用计数
+using _Ptr_Lambda_t = std::shared_ptr<Lambda>;
+
+// 由 C++ 管理生命周期的对象(任务、channel)，最后一个引用消失时析构
+struct Handle {
+    virtual ~Handle() = default;
+};
+using _Ptr_Handle_t = std::shared_ptr<Handle>;
+
+// STRING 的值是 Str(不可变、共享)；符号名和括号这些 token 还是 unique_ptr<std::string>
+using Value = std::variant<int64_t, double, Token*, std::unique_ptr<List>, _Ptr_Lambda_t, std::unique_ptr<std::string>,
+    _Ptr_Handle_t, Str>;
 
 } // namespace austlisp
 
@@ -0,0 +1,105 @@
+#include "loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eval.hpp"
+#include "output.hpp"
+#include "print.hpp"
+#include "thread_pool.hpp"
+
+namespace austlisp {
+
+namespace {
+
+using Batch = std::vector<std::unique_ptr<AST_base>>;
+
+// 只做词法和语法分析；每块自己一个 Eval，解析状态互不干扰。解析只读 env 的 closure()，全局环境上是空的
+void _parse_batch(Env* env, const std::vector<std::string_view>& lines, size_t first, size_t last, Batch& out) {
+    out.clear();
+    out.resize(last - first);
+    ThreadPool::instance().parallel_for(last - first, 256, [&](size_t begin, size_t end) {
+        Eval e(env);
+        for (size_t i = begin; i < end; ++i) {
+            // 词法分析依赖行尾的 '\0'，拷成 std::string
+            std::string text(lines[first + i]);
+            Tokenize tokenize(text);
+            size_t t = 0;
+            out[i]   = e.parser(tokenize.tokens_list, t);
+            e.clear_status();
+        }
+    });
+}
+
+} // namespace
+
+std::vector<std::string_view> Loader::split_lines(std::string_view source) {
+    std::vector<std::string_view> lines;
+    const char* p   = source.data();
+    const char* end = p + source.size();
+    while (p < end) {
+        auto nl = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+        if (nl == nullptr) {
+            lines.emplace_back(p, size_t(end - p));
+            break;
+        }
+        lines.emplace_back(p, size_t(nl - p));
+        p = nl + 1;
+    }
+    return lines;
+}
+
+void Loader::load(Env* env, std::string_view source, const std::function<void(size_t)>& after_line) {
+    Eval e(env);
+    auto lines = split_lines(source);
+
+    if (source.size() < PARALLEL_MIN_BYTES || ThreadPool::instance().size() < 2) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            std::string text(lines[i]);
+            Tokenize tokenize(text);
+            size_t t = 0;
+            auto ast = e.compile(tokenize.tokens_list, t);
+            auto res = e.eval_top(ast);
+            e.clear_status();
+            print_info(res);
+            if (after_line) {
+                after_line(i);
+            }
+        }
+        Output::local().flush();
+        return;
+    }
+
+    // 求值这一批的时候后台解析下一批
+    Batch current, next;
+    _parse_batch(env, lines, 0, std::min(lines.size(), BATCH_LINES), current);
+    for (size_t begin = 0; begin < lines.size(); begin += BATCH_LINES) {
+        size_t end = std::min(lines.size(), begin + BATCH_LINES);
+        std::thread ahead;
+        if (end < lines.size()) {
+            ahead = std::thread([&, end] { _parse_batch(env, lines, end, std::min(lines.size(), end + BATCH_LINES), next); });
+        }
+        for (size_t i = 0; i < current.size(); ++i) {
+            auto& ast = current[i];
+            e.optimize_top(ast);
+            auto res = e.eval_top(ast);
+            e.clear_status();
+            print_info(res);
+            ast.reset();
+            if (after_line) {
+                after_line(begin + i);
+            }
+        }
+        if (ahead.joinable()) {
+            ahead.join();
+        }
+        std::swap(current, next);
+    }
+    Output::local().flush();
+}
+
+} // namespace austlisp
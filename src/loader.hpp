@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef _LOADER_HPP_
+#define _LOADER_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "env.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  -f 加载源文件：每一行是一个顶层表达式，按顺序求值、打印结果。
+ *  大文件先用 memchr 切出行边界，词法分析和语法分析在线程池里按批并行，
+ *  求值线程按源码顺序拿解析好的 AST 做优化和求值，同时后台解析下一批，所以语义和逐行加载一样。
+ *  解析期间的语法错误信息可能比前面几行的求值输出早出现。
+ */
+class Loader {
+public:
+    // 小于这个大小的文件直接逐行做，省掉线程切换
+    static constexpr size_t PARALLEL_MIN_BYTES = 1 << 20;
+    // 每批的行数，批越大并行度越好，同时在内存里的 AST 也越多
+    static constexpr size_t BATCH_LINES = 16384;
+
+    // after_line 在每一行求值、打印完以后调用，参数是行号(从 0 开始)
+    static void load(Env* env, std::string_view source, const std::function<void(size_t)>& after_line = {});
+
+    // 和 std::getline 一样切行：最后一行没有换行符也算，文件末尾的换行符后面不再多出一个空行
+    static std::vector<std::string_view> split_lines(std::string_view source);
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,191 @@
+#pragma once
+
+#ifndef _LSTRING_HPP_
+#define _LSTRING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  脚本里的字符串值：创建后不可变，复制只加引用计数，所以读一个字符串变量不再整个拷贝。
+ *  不超过 15 字节的直接存在对象里，不分配；更长的放在带引用计数的堆缓冲里，
+ *  substr 只是记下偏移和长度，和原来的字符串共用缓冲，O(1)。
+ *  整个对象 16 字节，放进 Value 不会让 Token 变大。
+ */
+class Str {
+public:
+    static constexpr size_t INLINE_MAX = 15;
+
+    Str() noexcept {
+        _small.tag = SMALL;
+    }
+    Str(std::string_view s) {
+        if (s.size() <= INLINE_MAX) {
+            _set_small(s);
+            return;
+        }
+        Buf* buf = Buf::make(s.size());
+        std::memcpy(buf->data, s.data(), s.size());
+        _set_heap(buf, 0, s.size());
+    }
+    Str(const Str& other) noexcept : _heap(other._heap) {
+        if (!_is_small()) {
+            _heap.buf->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    Str(Str&& other) noexcept : _heap(other._heap) {
+        other._small.tag = SMALL;
+    }
+    Str& operator=(const Str& other) noexcept {
+        Str(other).swap(*this);
+        return *this;
+    }
+    Str& operator=(Str&& other) noexcept {
+        Str(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~Str() {
+        if (!_is_small()) {
+            _heap.buf->release();
+        }
+    }
+
+    void swap(Str& other) noexcept {
+        std::swap(_heap, other._heap);
+    }
+
+    // 两段拼成一个新字符串，只分配一次
+    static Str concat(std::string_view a, std::string_view b) {
+        Str out;
+        size_t n = a.size() + b.size();
+        if (n <= INLINE_MAX) {
+            std::memcpy(out._small.data, a.data(), a.size());
+            std::memcpy(out._small.data + a.size(), b.data(), b.size());
+            out._small.tag = uint8_t(SMALL | n);
+            return out;
+        }
+        Buf* buf = Buf::make(n);
+        std::memcpy(buf->data, a.data(), a.size());
+        std::memcpy(buf->data + a.size(), b.data(), b.size());
+        out._set_heap(buf, 0, n);
+        return out;
+    }
+    // 把攒好的 std::string 收下来，长字符串只拷一次
+    static Str from(const std::string& s) {
+        return Str(std::string_view(s));
+    }
+
+    std::string_view view() const noexcept {
+        if (_is_small()) {
+            return {_small.data, size_t(_small.tag & ~SMALL)};
+        }
+        return {_heap.buf->data + _heap.offset, _heap.size};
+    }
+    size_t size() const noexcept {
+        return _is_small() ? size_t(_small.tag & ~SMALL) : _heap.size;
+    }
+    std::string str() const {
+        return std::string(view());
+    }
+
+    // [pos, pos + len)，越界的部分截掉。短的直接拷进对象，长的共享缓冲
+    Str substr(size_t pos, size_t len = std::string_view::npos) const {
+        auto v = view();
+        pos    = std::min(pos, v.size());
+        len    = std::min(len, v.size() - pos);
+        if (len <= INLINE_MAX || _is_small()) {
+            return Str(v.substr(pos, len));
+        }
+        Str out;
+        _heap.buf->refs.fetch_add(1, std::memory_order_relaxed);
+        out._set_heap(_heap.buf, _heap.offset + pos, len);
+        return out;
+    }
+
+    // 内容相等
+    bool operator==(const Str& other) const noexcept {
+        return view() == other.view();
+    }
+    // eq 用：同一块存储(同一个字符串的复制)，短字符串是值，直接比内容
+    bool same(const Str& other) const noexcept {
+        if (_is_small() || other._is_small()) {
+            return _is_small() && other._is_small() && view() == other.view();
+        }
+        return _heap.buf == other._heap.buf && _heap.offset == other._heap.offset && _heap.size == other._heap.size;
+    }
+
+private:
+    struct Buf {
+        std::atomic<uint32_t> refs;
+        uint32_t size;
+        char data[1];
+
+        static Buf* make(size_t n) {
+            if (n > UINT32_MAX >> 1) {
+                throw std::bad_alloc();
+            }
+            void* mem = ::operator new(offsetof(Buf, data) + n);
+            auto buf  = new (mem) Buf;
+            buf->refs.store(1, std::memory_order_relaxed);
+            buf->size = uint32_t(n);
+            return buf;
+        }
+        void release() noexcept {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                this->~Buf();
+                ::operator delete(this);
+            }
+        }
+    };
+
+    // 最后一个字节的最高位区分两种存储：堆上的长度不会超过 2^31，这一位总是 0
+    static constexpr uint8_t SMALL = 0x80;
+
+    bool _is_small() const noexcept {
+        return (_small.tag & SMALL) != 0;
+    }
+    void _set_small(std::string_view s) noexcept {
+        std::memcpy(_small.data, s.data(), s.size());
+        _small.tag = uint8_t(SMALL | s.size());
+    }
+    void _set_heap(Buf* buf, size_t offset, size_t size) noexcept {
+        _heap.buf    = buf;
+        _heap.offset = uint32_t(offset);
+        _heap.size   = uint32_t(size);
+    }
+
+    struct Heap {
+        Buf* buf;
+        uint32_t offset;
+        uint32_t size;
+    };
+    struct Small {
+        char data[INLINE_MAX];
+        uint8_t tag;
+    };
+    union {
+        Heap _heap;
+        Small _small;
+    };
+};
+
+static_assert(sizeof(Str) == 16);
+
+inline std::ostream& operator<<(std::ostream& out, const Str& s) {
+    return out << s.view();
+}
+
+} // namespace austlisp
+
+#endif
@@ -2,63 +2,31 @@
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <string>
 
+#include <unistd.h>
+
+#include "aot.hpp"
+#include "budget.hpp"
 #include "env.hpp"
 #include "eval.hpp"
 #include "lexical.hpp"
 #include "lisp.hpp"
+#include "loader.hpp"
+#include "output.hpp"
+#include "print.hpp"
+#include "profile.hpp"
+#include "runtime_stats.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 
 // vendor
 #include "cxxopts.hpp"
 
 namespace austlisp {
 
-void print_info(const austlisp::Token& res, austlisp::Env* env) {
-    switch (res.token_type) {
-    case austlisp::Tokens::INTEGER:
-        std::cout << std::get<int64_t>(res.value) << '\n';
-        break;
-    case austlisp::Tokens::DOUBLE:
-        std::cout << std::get<double>(res.value) << '\n';
-        break;
-    case austlisp::Tokens::LIST:
-        for (const auto& t : *std::get<std::unique_ptr<austlisp::List>>(res.value)) {
-            switch (t.token_type) {
-            case austlisp::Tokens::INTEGER:
-                std::cout << std::get<int64_t>(t.value) << ' ';
-                break;
-            case austlisp::Tokens::DOUBLE:
-                std::cout << std::get<double>(t.value) << ' ';
-                break;
-            default:
-                std::cout << *std::get<std::unique_ptr<std::string>>(t.value) << ' ';
-            }
-        }
-        std::cout << '\n';
-        break;
-    case austlisp::Tokens::K_DEFINE:;
-    case austlisp::Tokens::NONE:
-        break;
-    case austlisp::Tokens::K_LAMBDA:
-        std::cout << "lambda.\n";
-        break;
-    case austlisp::Tokens::_BUILDIN_CAR:
-    case austlisp::Tokens::_BUILDIN_CDR:
-    case austlisp::Tokens::_BUILDIN_EQ:
-    case austlisp::Tokens::_BUILDIN_EQUAL:
-    case austlisp::Tokens::IDENT_C:
-        {
-            auto pos = std::get<std::unique_ptr<austlisp::List>>(res.value).get();
-            std::cout << *std::get<std::unique_ptr<std::string>>(pos->at(0).value) << '\n';
-            break;
-        }
-    default:
-        std::cout << *std::get<std::unique_ptr<std::string>>(res.value) << '\n';
-    }
-}
-
 void repl(Env* global_env) {
     austlisp::Eval e(global_env);
     size_t t = 0;
@@ -66,23 +34,26 @@ void repl(Env* global_env) {
     // std::string line[] = {"(define b (if (equal \"13\" \"123\") (+ 1 1) (+ 3 4)))", "(+ b 0)"};
     std::string line;
     for (;;) {
-        std::cout << ">>> ";
-        std::getline(std::cin, line);
+        Output::local().write(">>> ");
+        Output::local().flush();
+        if (!std::getline(std::cin, line)) {
+            break;
+        }
         auto tokenize = std::make_unique<austlisp::Tokenize>(line);
         // tokenize->debug_tokens();
-        auto ast = e.parser(tokenize->tokens_list, t);
+        auto ast = e.compile(tokenize->tokens_list, t);
         t        = 0;
-        auto res = e.eval(ast);
+        auto res = e.eval_top(ast);
         e.clear_status();
-        print_info(res, global_env);
+        print_info(res);
     }
+    Output::local().flush();
 }
 
 void file_mode(Env* global_env, const cxxopts::ParseResult& result) {
-    austlisp::Eval e(global_env);
     std::ifstream file;
     try {
-        file.open(result["file"].as<std::string>());
+        file.open(result["file"].as<std::string>(), std::ios::binary);
         if (!file.is_open()) {
             std::cout << "no file: " << result["file"].as<std::string>() << '\n';
         }
@@ -90,17 +61,28 @@ void file_mode(Env* global_env, const cxxopts::ParseResult& result) {
         e->what();
         exit(1);
     }
-    std::string line;
-    size_t t = 0;
-    while (std::getline(file, line)) {
-        auto tokenize = std::make_unique<austlisp::Tokenize>(line);
-        // tokenize->debug_tokens();
-        auto ast = e.parser(tokenize->tokens_list, t);
-        t        = 0;
-        auto res = e.eval(ast);
-        e.clear_status();
-        austlisp::print_info(res, global_env);
+    // 整个读进来，切行和解析交给 Loader
+    std::string source;
+    file.seekg(0, std::ios::end);
+    if (auto size = file.tellg(); size > 0) {
+        source.resize(size_t(size));
+        file.seekg(0);
+        file.read(source.data(), size);
     }
+    Loader::load(global_env, source);
+}
+
+// --emit-cpp：把脚本翻译成 C++ 写到标准输出，不求值
+int emit_mode(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "no file: " << path << '\n';
+        return 1;
+    }
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto count = emit_cpp(source, path, std::cout);
+    std::cerr << path << ": " << count << " 个函数翻译成了 C++，其余的由运行时解释执行\n";
+    return 0;
 }
 
 
@@ -114,7 +96,22 @@ int main(int argc, const char* argv[]) {
 
     cxxopts::Options options("austlisp", "A simple C++ lisp");
 
-    options.add_options()("f,file", "filename", cxxopts::value<std::string>())("h,help", "Print usage");
+    options.add_options()("f,file", "filename", cxxopts::value<std::string>())("profile",
+        "profile calls, print a summary and write folded stacks to FILE",
+        cxxopts::value<std::string>()->implicit_value("austlisp.folded"))(
+        "stats", "print allocation and copy statistics on exit")("O,optimize",
+        "optimization level: 0 none, 1 constant folding, 2 also JIT-compiles hot numeric lambdas",
+        cxxopts::value<int>()->default_value("2"))("serve",
+        "serve evaluation requests on the Unix socket PATH; -f FILE is preloaded into every session",
+        cxxopts::value<std::string>())("max-steps", "abort a top-level form after evaluating N nodes",
+        cxxopts::value<uint64_t>()->default_value("0"))("max-heap",
+        "abort a top-level form once it holds more than N bytes of heap",
+        cxxopts::value<uint64_t>()->default_value("0"))("max-depth", "abort a top-level form nested deeper than N calls",
+        cxxopts::value<uint64_t>()->default_value("0"))("timeout", "abort a top-level form after N milliseconds",
+        cxxopts::value<uint64_t>()->default_value("0"))("emit-cpp",
+        "translate FILE to a C++ program on stdout; build it against libaustlisp_rt",
+        cxxopts::value<std::string>())(
+        "h,help", "Print usage");
 
     auto result = options.parse(argc, argv);
     if (result.count("help")) {
@@ -122,14 +119,56 @@ int main(int argc, const char* argv[]) {
         return 0;
     }
 
+    if (result.count("profile")) {
+        austlisp::Profiler::enable();
+    }
+    austlisp::Eval::set_opt_level(result["optimize"].as<int>());
+    austlisp::Budget::defaults = austlisp::Limits{result["max-steps"].as<uint64_t>(),
+        result["max-heap"].as<uint64_t>(), result["max-depth"].as<uint64_t>(), result["timeout"].as<uint64_t>()};
+#ifdef AUSTLISP_TRACE
+    austlisp::trace::install_handlers();
+#endif
+
+    if (result.count("emit-cpp")) {
+        return austlisp::emit_mode(result["emit-cpp"].as<std::string>());
+    }
+
+    austlisp::Output::line_buffered = isatty(STDOUT_FILENO) != 0;
     auto global_env = std::make_unique<austlisp::Env>();
 
-    if (result.count("file")) {
-        austlisp::file_mode(global_env.get(), result);
-        return 0;
+    if (result.count("serve")) {
+        // -f 的文件只加载一次，作为所有会话的基础环境
+        if (result.count("file")) {
+            austlisp::run_with_stack(austlisp::Budget::EVAL_STACK_SIZE,
+                [&] { austlisp::file_mode(global_env.get(), result); });
+        }
+        return austlisp::Server::serve(result["serve"].as<std::string>(), *global_env);
     }
 
-    repl(global_env.get());
+    // 求值放到大栈的线程上，深递归靠 Budget 的栈检查报错而不是段错误
+    austlisp::run_with_stack(austlisp::Budget::EVAL_STACK_SIZE, [&] {
+        if (result.count("file")) {
+            austlisp::file_mode(global_env.get(), result);
+        } else {
+            repl(global_env.get());
+        }
+    });
+
+    if (result.count("stats")) {
+        austlisp::Output::local().flush();
+        std::cout.flush();
+        austlisp::print_runtime_stats(std::cerr);
+    }
+
+    if (result.count("profile")) {
+        austlisp::Output::local().flush();
+        std::cout.flush();
+        austlisp::Profiler::report(std::cerr);
+        auto folded = result["profile"].as<std::string>();
+        if (!austlisp::Profiler::write_folded(folded)) {
+            std::cerr << "error!: 无法写入 " << folded << '\n';
+        }
+    }
 
     return 0;
 }
@@ -0,0 +1,168 @@
+#pragma once
+
+#ifndef _MEMO_HPP_
+#define _MEMO_HPP_
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "lexical.hpp"
+#include "lisp.hpp"
+
+namespace austlisp {
+
+// 按内容算 hash，LIST 和 STRING 不看地址
+inline size_t _token_hash(const Token& t) noexcept {
+    size_t h = std::hash<int>{}(int(t.token_type));
+    auto mix = [&h](size_t v) { h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2); };
+    if (std::holds_alternative<int64_t>(t.value)) {
+        mix(std::hash<int64_t>{}(std::get<int64_t>(t.value)));
+    } else if (std::holds_alternative<double>(t.value)) {
+        mix(std::hash<uint64_t>{}(std::bit_cast<uint64_t>(std::get<double>(t.value))));
+    } else if (std::holds_alternative<_Ptr_Str_t>(t.value)) {
+        if (auto& s = std::get<_Ptr_Str_t>(t.value)) {
+            mix(std::hash<std::string>{}(*s));
+        }
+    } else if (std::holds_alternative<_Ptr_List_t>(t.value)) {
+        if (auto& l = std::get<_Ptr_List_t>(t.value)) {
+            for (const auto& item : *l) {
+                mix(_token_hash(item));
+            }
+        }
+    } else if (std::holds_alternative<_Ptr_Lambda_t>(t.value)) {
+        mix(std::hash<void*>{}(std::get<_Ptr_Lambda_t>(t.value).get()));
+    } else if (std::holds_alternative<_Ptr_Handle_t>(t.value)) {
+        mix(std::hash<void*>{}(std::get<_Ptr_Handle_t>(t.value).get()));
+    } else if (std::holds_alternative<Str>(t.value)) {
+        mix(std::hash<std::string_view>{}(std::get<Str>(t.value).view()));
+    }
+    return h;
+}
+
+// 结构相等，和 equal 的语义一致
+inline bool _token_same(const Token& lhs, const Token& rhs) noexcept {
+    if (lhs.token_type != rhs.token_type || lhs.value.index() != rhs.value.index()) {
+        return false;
+    }
+    if (std::holds_alternative<_Ptr_Str_t>(lhs.value)) {
+        auto& l = std::get<_Ptr_Str_t>(lhs.value);
+        auto& r = std::get<_Ptr_Str_t>(rhs.value);
+        return l && r ? *l == *r : l == r;
+    }
+    if (std::holds_alternative<_Ptr_List_t>(lhs.value)) {
+        auto& l = std::get<_Ptr_List_t>(lhs.value);
+        auto& r = std::get<_Ptr_List_t>(rhs.value);
+        if (!l || !r) {
+            return l == r;
+        }
+        if (l->size() != r->size()) {
+            return false;
+        }
+        for (size_t i = 0; i < l->size(); ++i) {
+            if (!_token_same((*l)[i], (*r)[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return lhs.value == rhs.value;
+}
+
+/**
+ * @brief
+ *  memoize 用的结果缓存，按实参的结构 hash 查找，超过 capacity 按 LRU 淘汰。
+ *  查找和插入各自加锁，计算过程中不持锁，所以递归调用自己和 pmap 里并发调用都没问题。
+ *  出错返回 nil 的调用不缓存，下次同样的实参会重新算。
+ */
+struct MemoCache {
+    explicit MemoCache(size_t capacity) : capacity(capacity == 0 ? 1 : capacity) {}
+
+    // args 是实参，不含函数名
+    std::optional<Token> lookup(const List& args) {
+        size_t h = _args_hash(args);
+        std::lock_guard<std::mutex> lock(m);
+        auto [first, last] = index.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (_args_same(it->second->first, args)) {
+                lru.splice(lru.begin(), lru, it->second);
+                hits++;
+                return it->second->second.copy();
+            }
+        }
+        misses++;
+        return std::nullopt;
+    }
+
+    void insert(List&& args, Token&& result) {
+        size_t h = _args_hash(args);
+        std::lock_guard<std::mutex> lock(m);
+        auto [first, last] = index.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (_args_same(it->second->first, args)) { // 并发时别的线程可能已经算好了
+                return;
+            }
+        }
+        lru.emplace_front(std::move(args), std::move(result));
+        index.emplace(h, lru.begin());
+        while (lru.size() > capacity) {
+            _evict_last();
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m);
+        lru.clear();
+        index.clear();
+        hits = misses = 0;
+    }
+
+    size_t capacity;
+    size_t hits   = 0;
+    size_t misses = 0;
+    std::list<std::pair<List, Token>> lru; // 头部是最近用过的
+    std::unordered_multimap<size_t, std::list<std::pair<List, Token>>::iterator> index;
+    std::mutex m;
+
+private:
+    static size_t _args_hash(const List& args) noexcept {
+        size_t h = args.size();
+        for (const auto& arg : args) {
+            h = h * 31 + _token_hash(arg);
+        }
+        return h;
+    }
+    static bool _args_same(const List& lhs, const List& rhs) noexcept {
+        if (lhs.size() != rhs.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            if (!_token_same(lhs[i], rhs[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    void _evict_last() {
+        auto victim        = std::prev(lru.end());
+        auto [first, last] = index.equal_range(_args_hash(victim->first));
+        for (auto it = first; it != last; ++it) {
+            if (it->second == victim) {
+                index.erase(it);
+                break;
+            }
+        }
+        lru.erase(victim);
+    }
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,116 @@
+#include "output.hpp"
+
+#include <charconv>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+
+namespace austlisp {
+
+Output& Output::local() {
+    thread_local Output out;
+    return out;
+}
+
+void Output::flush() {
+    if (_buf.empty() || _capturing != 0) {
+        return;
+    }
+    {
+        // 多个线程的块不交错
+        static std::mutex m;
+        std::lock_guard<std::mutex> lock(m);
+        std::cout.rdbuf()->sputn(_buf.data(), std::streamsize(_buf.size()));
+        std::cout.rdbuf()->pubsync();
+    }
+    _buf.clear();
+}
+
+void write_int(std::string& out, int64_t v) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, res.ptr);
+}
+
+void write_double(std::string& out, double v) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::general, 6);
+    out.append(buf, res.ptr);
+}
+
+static void _display_atom(std::string& out, const Token& t) {
+    switch (t.token_type) {
+    case Tokens::INTEGER:
+        write_int(out, std::get<int64_t>(t.value));
+        return;
+    case Tokens::DOUBLE:
+        write_double(out, std::get<double>(t.value));
+        return;
+    case Tokens::STRING:
+        out += std::get<Str>(t.value).view();
+        return;
+    case Tokens::TRUE:
+        out += "true";
+        return;
+    case Tokens::FALSE:
+        out += "false";
+        return;
+    case Tokens::NONE:
+        out += "nil";
+        return;
+    case Tokens::TASK:
+        out += "<task>";
+        return;
+    case Tokens::CHANNEL:
+        out += "<channel>";
+        return;
+    case Tokens::SEQ:
+        out += "<seq>";
+        return;
+    case Tokens::STRING_BUILDER:
+        out += "<string-builder>";
+        return;
+    case Tokens::TABLE:
+        out += "<table>";
+        return;
+    case Tokens::BYTEVECTOR:
+        out += "<bytevector>";
+        return;
+    default:
+        if (t.token_type == Tokens::K_LAMBDA && std::holds_alternative<_Ptr_Lambda_t>(t.value)) {
+            out += "lambda";
+        } else if (std::holds_alternative<_Ptr_Str_t>(t.value)) {
+            out += *std::get<_Ptr_Str_t>(t.value); // 符号
+        } else {
+            out += "nil"; // 内置函数之类没有可打印的值
+        }
+    }
+}
+
+void display(std::string& out, const Token& t) {
+    if (t.token_type != Tokens::LIST) {
+        _display_atom(out, t);
+        return;
+    }
+    // 扁平列表：元素之间一个空格，括号里侧不加
+    bool after_open = true;
+    for (const auto& item : *std::get<_Ptr_List_t>(t.value)) {
+        if (item.token_type == Tokens::RPAREN) {
+            out += ')';
+            after_open = false;
+            continue;
+        }
+        if (!after_open) {
+            out += ' ';
+        }
+        if (item.token_type == Tokens::LPAREN) {
+            out += '(';
+            after_open = true;
+        } else {
+            _display_atom(out, item);
+            after_open = false;
+        }
+    }
+}
+
+} // namespace austlisp
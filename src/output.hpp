@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef _OUTPUT_HPP_
+#define _OUTPUT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "lexical.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  标准输出的缓冲：每个线程一块，攒到 64 KiB 才整块写给 std::cout 的 streambuf，
+ *  线程退出、显式 flush 或者程序结束时写掉剩下的。结果打印和 display/print 都走这里，
+ *  不经过 iostream 的格式化。服务模式会把 std::cout 按线程分流，所以最终还是写到 std::cout 上。
+ *  标准输出是终端时改成每次 commit 都写，和直接写到 std::cerr 的错误信息保持先后顺序。
+ */
+class Output {
+public:
+    static constexpr size_t FLUSH_AT = 64 * 1024;
+
+    static Output& local();
+
+    // 输出到终端时打开
+    static inline bool line_buffered = false;
+
+    // 直接往缓冲里写，写完调 commit
+    std::string& buffer() noexcept {
+        return _buf;
+    }
+    void commit() {
+        if (_capturing == 0 && (line_buffered || _buf.size() >= FLUSH_AT)) {
+            flush();
+        }
+    }
+    void write(std::string_view s) {
+        _buf += s;
+        commit();
+    }
+    void flush();
+
+    ~Output() {
+        flush();
+    }
+
+    /**
+     * @brief
+     *  线程池里的一块任务在这个线程上执行期间，输出先收在一块单独的缓冲里，不写出去，
+     *  结束时 take() 拿走交给 parallel_for 的调用线程。worker 的缓冲不会攒着不写，
+     *  服务模式下也能进调用它的那个会话。可以嵌套，结束时恢复原来的缓冲。
+     */
+    class Capture {
+    public:
+        Capture() : _out(local()) {
+            _saved.swap(_out._buf);
+            ++_out._capturing;
+        }
+        ~Capture() {
+            --_out._capturing;
+            _out._buf.swap(_saved);
+        }
+        Capture(const Capture&)            = delete;
+        Capture& operator=(const Capture&) = delete;
+
+        std::string take() noexcept {
+            return std::exchange(_out._buf, std::string{});
+        }
+
+    private:
+        Output& _out;
+        std::string _saved;
+    };
+
+private:
+    Output() {
+        _buf.reserve(FLUSH_AT + 4096);
+    }
+
+    std::string _buf;
+    int _capturing = 0; // 嵌套的 Capture 个数，不为 0 时不写出去
+};
+
+// std::to_chars，不分配
+void write_int(std::string& out, int64_t v);
+// 和 std::cout 默认格式(%g，6 位有效数字)一样
+void write_double(std::string& out, double v);
+// display 的格式：字符串不带引号，列表是 (1 2 (3))
+void display(std::string& out, const Token& t);
+
+} // namespace austlisp
+
+#endif
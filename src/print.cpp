@@ -0,0 +1,45 @@
+#include "print.hpp"
+
+#include <memory>
+#include <string>
+
+#include "output.hpp"
+
+namespace austlisp {
+
+void print_info(const Token& res) {
+    auto& out = Output::local().buffer();
+    switch (res.token_type) {
+    case Tokens::K_DEFINE:
+    case Tokens::NONE:
+        return;
+    case Tokens::LIST:
+        // 顶层列表一直是这个格式：每个 token 后面跟一个空格，括号也一样
+        for (const auto& t : *std::get<_Ptr_List_t>(res.value)) {
+            display(out, t);
+            out += ' ';
+        }
+        out += '\n';
+        break;
+    case Tokens::K_LAMBDA:
+        out += "lambda.\n";
+        break;
+    case Tokens::_BUILDIN_CAR:
+    case Tokens::_BUILDIN_CDR:
+    case Tokens::_BUILDIN_EQ:
+    case Tokens::_BUILDIN_EQUAL:
+    case Tokens::IDENT_C:
+        if (std::holds_alternative<_Ptr_List_t>(res.value)) {
+            out += *std::get<_Ptr_Str_t>(std::get<_Ptr_List_t>(res.value)->at(0).value);
+            out += '\n';
+            break;
+        }
+        [[fallthrough]];
+    default:
+        display(out, res);
+        out += '\n';
+    }
+    Output::local().commit();
+}
+
+} // namespace austlisp
@@ -0,0 +1,15 @@
+#pragma once
+
+#ifndef _PRINT_HPP_
+#define _PRINT_HPP_
+
+#include "lexical.hpp"
+
+namespace austlisp {
+
+// 顶层求值结果的打印，repl、-f 和服务模式共用
+void print_info(const Token& res);
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,211 @@
+#include "profile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "alloc_stats.hpp"
+
+namespace austlisp {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 调用树上的节点，folded stack 就是把这棵树的每条路径打出来
+struct CallNode {
+    int name         = -1; // 根节点是 -1
+    uint64_t self_ns = 0;
+    std::unordered_map<int, std::unique_ptr<CallNode>> children;
+};
+
+struct FuncStats {
+    uint64_t calls    = 0;
+    uint64_t incl_ns  = 0;
+    uint64_t excl_ns  = 0;
+    uint64_t allocs   = 0; // 不含子调用
+    uint64_t active   = 0; // 递归深度，只有最外层才累计包含时间，避免重复计算
+};
+
+struct Frame {
+    CallNode* node;
+    int name;
+    Clock::time_point start;
+    uint64_t child_ns;
+    uint64_t alloc_start;
+    uint64_t child_allocs;
+};
+
+struct ThreadProfile {
+    std::unordered_map<std::string, int> ids;
+    std::vector<std::string> names;
+    std::vector<FuncStats> stats;
+    CallNode root;
+    std::vector<Frame> stack;
+
+    int intern(const std::string& name) {
+        auto [it, inserted] = ids.try_emplace(name, int(names.size()));
+        if (inserted) {
+            names.emplace_back(name);
+            stats.emplace_back();
+        }
+        return it->second;
+    }
+};
+
+// 线程退出后数据还要留着汇总，所以由全局表持有
+std::mutex _registry_mutex;
+std::vector<std::unique_ptr<ThreadProfile>> _registry;
+
+ThreadProfile& _local() {
+    thread_local ThreadProfile* profile = [] {
+        std::lock_guard<std::mutex> lock(_registry_mutex);
+        _registry.emplace_back(std::make_unique<ThreadProfile>());
+        return _registry.back().get();
+    }();
+    return *profile;
+}
+
+} // namespace
+
+void Profiler::enter(const std::string& name) {
+    auto& p      = _local();
+    int id       = p.intern(name);
+    CallNode* up = p.stack.empty() ? &p.root : p.stack.back().node;
+    auto& child  = up->children[id];
+    if (!child) {
+        child       = std::make_unique<CallNode>();
+        child->name = id;
+    }
+    p.stats[id].calls++;
+    p.stats[id].active++;
+    p.stack.emplace_back(Frame{child.get(), id, Clock::now(), 0, thread_alloc_count(), 0});
+}
+
+void Profiler::leave() {
+    auto& p = _local();
+    if (p.stack.empty()) {
+        return;
+    }
+    Frame f = p.stack.back();
+    p.stack.pop_back();
+    uint64_t incl   = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - f.start).count();
+    uint64_t excl   = incl > f.child_ns ? incl - f.child_ns : 0;
+    uint64_t allocs = thread_alloc_count() - f.alloc_start;
+    uint64_t own    = allocs > f.child_allocs ? allocs - f.child_allocs : 0;
+
+    auto& s = p.stats[f.name];
+    if (--s.active == 0) {
+        s.incl_ns += incl;
+    }
+    s.excl_ns += excl;
+    s.allocs += own;
+    f.node->self_ns += excl;
+    if (!p.stack.empty()) {
+        p.stack.back().child_ns += incl;
+        p.stack.back().child_allocs += allocs;
+    }
+}
+
+struct ProfileStack::Impl {
+    std::vector<Frame> frames; // 任务没在跑的时候，它的调用栈存在这里
+    std::vector<Frame> outer; // 任务在跑的时候，被换下来的调用栈存在这里
+    Clock::time_point paused = Clock::now();
+    uint64_t paused_allocs   = thread_alloc_count();
+};
+
+ProfileStack::ProfileStack()  = default;
+ProfileStack::~ProfileStack() = default;
+
+void ProfileStack::switch_in() {
+    if (!Profiler::enabled()) {
+        return;
+    }
+    if (!_impl) {
+        _impl = std::make_unique<Impl>();
+    }
+    auto& p = _local();
+    _impl->outer.swap(p.stack);
+    p.stack.swap(_impl->frames);
+    // 挂起的这段时间不算：把每一帧的起点往后挪
+    auto idle   = Clock::now() - _impl->paused;
+    auto allocs = thread_alloc_count() - _impl->paused_allocs;
+    for (auto& f : p.stack) {
+        f.start += idle;
+        f.alloc_start += allocs;
+    }
+}
+
+void ProfileStack::switch_out() {
+    if (!_impl) {
+        return;
+    }
+    auto& p = _local();
+    p.stack.swap(_impl->frames);
+    p.stack.swap(_impl->outer);
+    _impl->paused        = Clock::now();
+    _impl->paused_allocs = thread_alloc_count();
+}
+
+void Profiler::report(std::ostream& os) {
+    std::map<std::string, FuncStats> merged;
+    {
+        std::lock_guard<std::mutex> lock(_registry_mutex);
+        for (auto& p : _registry) {
+            for (size_t i = 0; i < p->names.size(); ++i) {
+                auto& m = merged[p->names[i]];
+                m.calls += p->stats[i].calls;
+                m.incl_ns += p->stats[i].incl_ns;
+                m.excl_ns += p->stats[i].excl_ns;
+                m.allocs += p->stats[i].allocs;
+            }
+        }
+    }
+    std::vector<std::pair<std::string, FuncStats>> rows(merged.begin(), merged.end());
+    std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.excl_ns > b.second.excl_ns; });
+
+    os << std::left << std::setw(24) << "function" << std::right << std::setw(12) << "calls" << std::setw(14)
+       << "incl(ms)" << std::setw(14) << "excl(ms)" << std::setw(14) << "allocs" << '\n';
+    for (const auto& [name, s] : rows) {
+        os << std::left << std::setw(24) << name << std::right << std::setw(12) << s.calls << std::setw(14)
+           << std::fixed << std::setprecision(3) << s.incl_ns / 1e6 << std::setw(14) << s.excl_ns / 1e6
+           << std::setw(14) << s.allocs << '\n';
+    }
+}
+
+bool Profiler::write_folded(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    // 同样的调用路径在不同线程里要合并成一行
+    std::map<std::string, uint64_t> folded;
+    std::lock_guard<std::mutex> lock(_registry_mutex);
+    for (auto& p : _registry) {
+        std::function<void(const CallNode&, const std::string&)> walk = [&](const CallNode& node,
+                                                                             const std::string& prefix) {
+            std::string path = node.name < 0 ? "austlisp" : prefix + ";" + p->names[node.name];
+            if (node.self_ns / 1000 > 0) {
+                folded[path] += node.self_ns / 1000; // 单位 us
+            }
+            for (const auto& [id, child] : node.children) {
+                walk(*child, path);
+            }
+        };
+        walk(p->root, "");
+    }
+    for (const auto& [stack, us] : folded) {
+        out << stack << ' ' << us << '\n';
+    }
+    return true;
+}
+
+} // namespace austlisp
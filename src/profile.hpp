@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef _PROFILE_HPP_
+#define _PROFILE_HPP_
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  函数级 profiler，--profile 打开。记录每个 lambda/内建函数的调用次数、包含/不包含子调用的时间
+ *  和分配次数，退出时输出汇总表和 flamegraph 用的 folded stack 文件。
+ *  数据按线程记录，pmap 的 worker 也能统计到，汇总时再合并。没打开时每次调用只多一次分支。
+ */
+class Profiler {
+public:
+    static bool enabled() noexcept {
+        return _enabled;
+    }
+    static void enable() noexcept {
+        _enabled = true;
+    }
+
+    static void enter(const std::string& name);
+    static void leave();
+
+    static void report(std::ostream& os);
+    static bool write_folded(const std::string& path);
+
+private:
+    static inline bool _enabled = false;
+};
+
+/**
+ * @brief
+ *  协作式任务自己的调用栈。调度器切到任务上时 switch_in，切回来时 switch_out，
+ *  这样任务里的调用不会挂到 await 它的那个函数下面，任务挂起期间的时间和分配也不算在它头上。
+ */
+class ProfileStack {
+public:
+    ProfileStack();
+    ~ProfileStack();
+    ProfileStack(const ProfileStack&)            = delete;
+    ProfileStack& operator=(const ProfileStack&) = delete;
+
+    void switch_in();
+    void switch_out();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> _impl; // 没开 profiler 时不分配
+};
+
+struct ProfileScope {
+    explicit ProfileScope(const std::string& name) : active(Profiler::enabled()) {
+        if (active) {
+            Profiler::enter(name);
+        }
+    }
+    ~ProfileScope() {
+        if (active) {
+            Profiler::leave();
+        }
+    }
+    ProfileScope(const ProfileScope&)            = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    bool active;
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,71 @@
+#include "runtime_stats.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "alloc_stats.hpp"
+
+namespace austlisp {
+
+namespace {
+
+// 线程退出时把计数合并到 _retired，活着的线程在 _live 里
+std::mutex _mutex;
+std::vector<RuntimeCounters*> _live;
+RuntimeStats _retired{};
+
+void _accumulate(RuntimeStats& to, const RuntimeCounters& from) noexcept {
+    to.token_copies += from.token_copies.load(std::memory_order_relaxed);
+    to.list_bytes_copied += from.list_bytes_copied.load(std::memory_order_relaxed);
+    to.string_bytes_copied += from.string_bytes_copied.load(std::memory_order_relaxed);
+    to.env_frames += from.env_frames.load(std::memory_order_relaxed);
+    to.symbol_lookups += from.symbol_lookups.load(std::memory_order_relaxed);
+    to.ast_nodes += from.ast_nodes.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+RuntimeCounters::RuntimeCounters() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _live.emplace_back(this);
+}
+
+RuntimeCounters::~RuntimeCounters() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _accumulate(_retired, *this);
+    _live.erase(std::remove(_live.begin(), _live.end(), this), _live.end());
+}
+
+RuntimeStats runtime_stats() noexcept {
+    RuntimeStats stats{};
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        stats = _retired;
+        for (auto* c : _live) {
+            _accumulate(stats, *c);
+        }
+    }
+    auto heap             = alloc_stats();
+    stats.heap_bytes      = heap.live_bytes;
+    stats.peak_heap_bytes = heap.peak_bytes;
+    stats.rss_kb          = current_rss_kb();
+    stats.peak_rss_kb     = peak_rss_kb();
+    return stats;
+}
+
+void print_runtime_stats(std::ostream& os) {
+    auto s = runtime_stats();
+    os << "token deep copies:   " << s.token_copies << '\n'
+       << "list bytes copied:   " << s.list_bytes_copied << '\n'
+       << "string bytes copied: " << s.string_bytes_copied << '\n'
+       << "env frames created:  " << s.env_frames << '\n'
+       << "symbol lookups:      " << s.symbol_lookups << '\n'
+       << "ast nodes built:     " << s.ast_nodes << '\n'
+       << "heap bytes:          " << s.heap_bytes << '\n'
+       << "peak heap bytes:     " << s.peak_heap_bytes << '\n'
+       << "rss:                 " << s.rss_kb << " KB\n"
+       << "peak rss:            " << s.peak_rss_kb << " KB\n";
+}
+
+} // namespace austlisp
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef _RUNTIME_STATS_HPP_
+#define _RUNTIME_STATS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  解释器内部的计数器，--stats 和 (runtime-stats) 用。
+ *  每个线程一份，只有本线程写，所以自增不需要加锁前缀；读的时候把所有线程的加起来。
+ */
+struct RuntimeCounters {
+    std::atomic<uint64_t> token_copies{0}; // Token::copy 里真正深拷贝的次数(LIST/STRING)
+    std::atomic<uint64_t> list_bytes_copied{0};
+    std::atomic<uint64_t> string_bytes_copied{0};
+    std::atomic<uint64_t> env_frames{0};
+    std::atomic<uint64_t> symbol_lookups{0};
+    std::atomic<uint64_t> ast_nodes{0};
+
+    RuntimeCounters();
+    ~RuntimeCounters();
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+inline thread_local RuntimeCounters runtime_counters;
+
+struct RuntimeStats {
+    uint64_t token_copies;
+    uint64_t list_bytes_copied;
+    uint64_t string_bytes_copied;
+    uint64_t env_frames;
+    uint64_t symbol_lookups;
+    uint64_t ast_nodes;
+    uint64_t heap_bytes;
+    uint64_t peak_heap_bytes;
+    uint64_t rss_kb;
+    uint64_t peak_rss_kb;
+};
+
+RuntimeStats runtime_stats() noexcept;
+void print_runtime_stats(std::ostream& os);
+
+} // namespace austlisp
+
+#endif
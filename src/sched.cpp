@@ -0,0 +1,242 @@
+#include "sched.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "budget.hpp"
+
+namespace austlisp {
+
+Scheduler& Scheduler::instance() {
+    thread_local Scheduler sched;
+    return sched;
+}
+
+Scheduler::~Scheduler() {
+    _alive.reset(); // 下面析构任务时释放的句柄不用再回调
+    // 没跑完的任务直接丢掉，它们的栈上不会再有需要析构的东西被恢复执行
+    for (auto& [id, task] : _tasks) {
+        if (task->stack != nullptr) {
+            _free_stack(task->stack);
+        }
+    }
+    for (auto* stack : _stack_pool) {
+        munmap(stack, STACK_SIZE);
+    }
+}
+
+void* Scheduler::_alloc_stack() {
+    if (!_stack_pool.empty()) {
+        auto stack = _stack_pool.back();
+        _stack_pool.pop_back();
+        return stack;
+    }
+    // MAP_NORESERVE: 只有真正碰到的页才占物理内存；最低一页做保护页，栈溢出直接段错误而不是踩内存
+    void* stack = mmap(nullptr, STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (stack == MAP_FAILED) {
+        return nullptr;
+    }
+    mprotect(stack, sysconf(_SC_PAGESIZE), PROT_NONE);
+    return stack;
+}
+
+void Scheduler::_free_stack(void* stack) {
+    _stack_pool.emplace_back(stack);
+}
+
+// 先 extract 再析构：任务的结果和参数里可能还有别的句柄，析构时会重入这里
+void Scheduler::_release(bool is_task, int64_t id) {
+    if (!is_task) {
+        auto node = _channels.extract(id);
+        return;
+    }
+    auto it = _tasks.find(id);
+    if (it == _tasks.end()) {
+        return;
+    }
+    if (it->second->done) {
+        auto node = _tasks.extract(it);
+    } else {
+        it->second->detached = true;
+    }
+}
+
+void Scheduler::_trampoline() {
+    auto& sched = instance();
+    Task* task  = sched._current;
+    try {
+        task->result = task->fn();
+    } catch (...) {
+        task->error = std::current_exception();
+    }
+    task->fn   = nullptr;
+    task->done = true;
+    for (auto* waiter : task->waiters) {
+        sched._wake(waiter);
+    }
+    task->waiters.clear();
+    // 返回后 uc_link 会切回主上下文
+}
+
+_Ptr_Handle_t Scheduler::spawn(TaskFn&& fn) {
+    auto task   = std::make_unique<Task>();
+    task->id    = _next_task++;
+    task->fn    = std::move(fn);
+    task->stack = _alloc_stack();
+    if (task->stack == nullptr) {
+        std::cerr << "error!: 无法为任务分配栈.\n";
+        return nullptr;
+    }
+    getcontext(&task->ctx);
+    task->ctx.uc_stack.ss_sp   = task->stack;
+    task->ctx.uc_stack.ss_size = STACK_SIZE;
+    task->ctx.uc_link          = &_main_ctx;
+    makecontext(&task->ctx, &Scheduler::_trampoline, 0);
+
+    auto id = task->id;
+    _ready.emplace_back(task.get());
+    _tasks.emplace(id, std::move(task));
+    return std::make_shared<Ref>(this, true, id);
+}
+
+bool Scheduler::_run_one() {
+    if (_ready.empty()) {
+        return false;
+    }
+    Task* task = _ready.front();
+    _ready.pop_front();
+    _current = task;
+    task->profile.switch_in();
+    // 栈检查换成任务自己的栈，任务里的深递归报错而不是撞上保护页
+    auto& budget    = Budget::local();
+    auto main_limit = budget.swap_stack_limit(static_cast<const char*>(task->stack) + Budget::STACK_RESERVE);
+    swapcontext(&_main_ctx, &task->ctx);
+    budget.swap_stack_limit(main_limit);
+    task->profile.switch_out();
+    _current = nullptr;
+    if (task->done && task->stack != nullptr) {
+        _free_stack(task->stack);
+        task->stack = nullptr;
+    }
+    if (task->done && task->detached) {
+        auto node = _tasks.extract(task->id);
+    }
+    return true;
+}
+
+void Scheduler::_block() {
+    Task* self = _current;
+    swapcontext(&self->ctx, &_main_ctx);
+}
+
+void Scheduler::_wake(Task* task) {
+    _ready.emplace_back(task);
+}
+
+bool Scheduler::_wait_until(const std::function<bool()>& ready, std::deque<Task*>* wait_queue) {
+    while (!ready()) {
+        if (_current != nullptr) {
+            if (wait_queue != nullptr) {
+                wait_queue->emplace_back(_current);
+            } else {
+                _ready.emplace_back(_current);
+            }
+            _block();
+        } else if (!_run_one()) {
+            std::cerr << "error!: 死锁，没有可以运行的任务了.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+Token Scheduler::await(int64_t task_id) {
+    auto it = _tasks.find(task_id);
+    if (it == _tasks.end()) {
+        std::cerr << "error!: 没有这个任务: " << task_id << '\n';
+        return Token{};
+    }
+    Task* task = it->second.get();
+    if (_current == task) {
+        std::cerr << "error!: 任务不能 await 自己.\n";
+        return Token{};
+    }
+    // 多个任务 await 同一个任务时，先醒的那个会把结果取走，所以这里按 id 重新查
+    bool ok = _wait_until(
+        [this, task_id] {
+            auto it = _tasks.find(task_id);
+            return it == _tasks.end() || it->second->done;
+        },
+        &task->waiters);
+    if (!ok) {
+        return Token{};
+    }
+    auto node = _tasks.extract(task_id); // 结果只能取一次
+    if (node.empty()) {
+        std::cerr << "error!: 任务 " << task_id << " 的结果已经被取走了.\n";
+        return Token{};
+    }
+    auto result = std::move(node.mapped()->result);
+    if (node.mapped()->error) {
+        std::rethrow_exception(node.mapped()->error);
+    }
+    return result;
+}
+
+void Scheduler::yield() {
+    if (_current != nullptr) {
+        _ready.emplace_back(_current);
+        _block();
+    } else {
+        _run_one();
+    }
+}
+
+_Ptr_Handle_t Scheduler::make_channel(size_t capacity) {
+    auto ch      = std::make_unique<Channel>();
+    ch->capacity = capacity == 0 ? 1 : capacity;
+    auto id      = _next_channel++;
+    _channels.emplace(id, std::move(ch));
+    return std::make_shared<Ref>(this, false, id);
+}
+
+bool Scheduler::send(int64_t channel_id, Token&& value) {
+    auto it = _channels.find(channel_id);
+    if (it == _channels.end()) {
+        std::cerr << "error!: 没有这个channel: " << channel_id << '\n';
+        return false;
+    }
+    Channel* ch = it->second.get();
+    if (!_wait_until([ch] { return ch->buffer.size() < ch->capacity; }, &ch->send_waiters)) {
+        return false;
+    }
+    ch->buffer.emplace_back(std::move(value));
+    if (!ch->recv_waiters.empty()) {
+        _wake(ch->recv_waiters.front());
+        ch->recv_waiters.pop_front();
+    }
+    return true;
+}
+
+Token Scheduler::recv(int64_t channel_id) {
+    auto it = _channels.find(channel_id);
+    if (it == _channels.end()) {
+        std::cerr << "error!: 没有这个channel: " << channel_id << '\n';
+        return Token{};
+    }
+    Channel* ch = it->second.get();
+    if (!_wait_until([ch] { return !ch->buffer.empty(); }, &ch->recv_waiters)) {
+        return Token{};
+    }
+    Token value = std::move(ch->buffer.front());
+    ch->buffer.pop_front();
+    if (!ch->send_waiters.empty()) {
+        _wake(ch->send_waiters.front());
+        ch->send_waiters.pop_front();
+    }
+    return value;
+}
+
+} // namespace austlisp
@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef _SCHED_HPP_
+#define _SCHED_HPP_
+
+#include <ucontext.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "lexical.hpp"
+#include "profile.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  单线程协作式调度器，给 spawn/await/channel 用。
+ *  每个任务跑在一块池化的小栈上(ucontext)，栈用 mmap 申请，只有真正用到的页才占内存，
+ *  所以开几千个任务也没问题。任务只在 await/send/recv/yield 的时候让出执行权，
+ *  调度循环总是在主上下文里跑(也就是最外层调用 await 的地方)。
+ */
+class Scheduler {
+public:
+    using TaskFn = std::function<Token()>;
+
+    // 和线程默认栈一样大，普通递归不会撞到保护页；MAP_NORESERVE，没碰过的页不占内存
+    static constexpr size_t STACK_SIZE = 8 * 1024 * 1024;
+
+    /**
+     * @brief
+     *  脚本里拿到的任务/channel 句柄。最后一个引用消失时通知调度器：channel 直接删掉，
+     *  任务跑完了就删掉，没跑完就等它跑完再删。只能在创建它的线程上使用。
+     */
+    struct Ref : Handle {
+        Ref(Scheduler* sched, bool is_task, int64_t id)
+            : sched(sched), alive(sched->_alive), is_task(is_task), id(id) {}
+        ~Ref() override {
+            if (!alive.expired()) {
+                sched->_release(is_task, id);
+            }
+        }
+        Scheduler* sched;
+        std::weak_ptr<bool> alive; // 调度器析构后就不用再通知了
+        bool is_task;
+        int64_t id;
+    };
+
+    static Scheduler& instance(); // 每个线程一个
+
+    // 失败时返回空指针
+    _Ptr_Handle_t spawn(TaskFn&& fn);
+    Token await(int64_t task_id);
+    void yield();
+
+    _Ptr_Handle_t make_channel(size_t capacity);
+    bool send(int64_t channel_id, Token&& value);
+    Token recv(int64_t channel_id);
+
+    size_t live_tasks() const noexcept {
+        return _tasks.size();
+    }
+    size_t live_channels() const noexcept {
+        return _channels.size();
+    }
+
+    ~Scheduler();
+
+private:
+    struct Task {
+        int64_t id;
+        ucontext_t ctx;
+        void* stack = nullptr;
+        TaskFn fn;
+        Token result;
+        std::exception_ptr error;
+        bool done     = false;
+        bool detached = false; // 句柄都没了，跑完直接回收
+        std::deque<Task*> waiters; // 在 await 这个任务的其他任务
+        ProfileStack profile;
+    };
+    struct Channel {
+        size_t capacity;
+        std::deque<Token> buffer;
+        std::deque<Task*> send_waiters;
+        std::deque<Task*> recv_waiters;
+    };
+
+    static void _trampoline();
+
+    // 在主上下文里跑一个就绪任务，没有可跑的返回 false
+    bool _run_one();
+    // 当前任务挂起，切回主上下文
+    void _block();
+    void _wake(Task* task);
+    // 阻塞直到 ready() 为真：任务里就挂起，主上下文里就驱动调度循环
+    bool _wait_until(const std::function<bool()>& ready, std::deque<Task*>* wait_queue);
+
+    void* _alloc_stack();
+    void _free_stack(void* stack);
+    void _release(bool is_task, int64_t id);
+
+    std::unordered_map<int64_t, std::unique_ptr<Task>> _tasks;
+    std::unordered_map<int64_t, std::unique_ptr<Channel>> _channels;
+    std::deque<Task*> _ready;
+    std::vector<void*> _stack_pool;
+    Task* _current = nullptr;
+    ucontext_t _main_ctx;
+    int64_t _next_task    = 1;
+    int64_t _next_channel = 1;
+    std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+#ifndef _SEQ_HPP_
+#define _SEQ_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "env.hpp"
+#include "lexical.hpp"
+#include "lisp.hpp"
+#include "table.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  惰性序列：只记下怎么生成元素，取的时候才算，一条 range -> lazy-map -> lazy-filter -> take 的链
+ *  不管多长都只占常数内存。序列本身创建后不再修改，每次消费都从头开一个 SeqCursor，所以可以反复用。
+ */
+struct Seq : Handle {
+    enum Kind : uint8_t {
+        RANGE, // start, end, step；bounded 为 false 时没有终点
+        ITEMS, // 普通列表拆出来的元素
+        MAP, // fn, source
+        FILTER, // fn, source
+        TAKE, // count, source
+        ITERATE, // init, f(init), f(f(init)) ...
+        COLUMN, // 表的一列，取的时候才包成 Token
+    };
+
+    explicit Seq(Kind kind) : kind(kind) {}
+
+    Kind kind;
+    int64_t start = 0;
+    int64_t end   = 0;
+    int64_t step  = 1;
+    bool bounded  = true;
+    int64_t count = 0;
+    Token fn; // K_LAMBDA
+    Token init;
+    List items;
+    std::shared_ptr<const Seq> source;
+    std::shared_ptr<const Table> table;
+    size_t column = 0;
+};
+
+// 一次遍历的状态，跟着 Seq 的链一层层建
+struct SeqCursor {
+    explicit SeqCursor(const Seq& seq)
+        : seq(seq), next_int(seq.start), remaining(seq.count),
+          source(seq.source ? std::make_unique<SeqCursor>(*seq.source) : nullptr) {}
+
+    const Seq& seq;
+    int64_t next_int; // RANGE 的下一个值
+    size_t index = 0; // ITEMS/COLUMN 的下标
+    int64_t remaining; // TAKE 还能取几个
+    bool done    = false;
+    bool failed  = false; // 函数在某个元素上出错，消费者要报错而不是当成正常结束
+    Token current; // ITERATE 上一次给出的值
+    bool started = false;
+    std::unique_ptr<SeqCursor> source;
+};
+
+// 序列函数的输入可以是惰性序列也可以是普通列表；都不是返回 nullptr
+inline std::shared_ptr<const Seq> _seq_source(const Token& t) {
+    if (t.token_type == Tokens::SEQ) {
+        return std::static_pointer_cast<const Seq>(std::get<_Ptr_Handle_t>(t.value));
+    }
+    if (t.token_type == Tokens::LIST) {
+        auto seq   = std::make_shared<Seq>(Seq::ITEMS);
+        seq->items = Env::_list_items(*std::get<_Ptr_List_t>(t.value));
+        return seq;
+    }
+    return nullptr;
+}
+
+} // namespace austlisp
+
+#endif
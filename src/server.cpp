@@ -0,0 +1,182 @@
+#include "server.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+#include "eval.hpp"
+#include "output.hpp"
+#include "print.hpp"
+
+namespace austlisp {
+
+namespace {
+
+/**
+ * 会话线程把 std::cout/std::cerr 的输出收进自己的响应里，其他线程照常写到原来的地方。
+ * 没有缓冲区，每次写都直接进 overflow/xsputn，所以只看当前线程的 sink 就够了。
+ */
+class SessionOutput : public std::streambuf {
+public:
+    explicit SessionOutput(std::streambuf* fallback) : _fallback(fallback) {}
+
+    static inline thread_local std::string* sink = nullptr;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) {
+            return traits_type::not_eof(ch);
+        }
+        if (sink != nullptr) {
+            sink->push_back(traits_type::to_char_type(ch));
+            return ch;
+        }
+        return _fallback->sputc(traits_type::to_char_type(ch));
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (sink != nullptr) {
+            sink->append(s, size_t(n));
+            return n;
+        }
+        return _fallback->sputn(s, n);
+    }
+    int sync() override {
+        return sink != nullptr ? 0 : _fallback->pubsync();
+    }
+
+private:
+    std::streambuf* _fallback;
+};
+
+bool _read_all(int fd, char* buf, size_t n) {
+    while (n > 0) {
+        auto got = read(fd, buf, n);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        buf += got;
+        n -= size_t(got);
+    }
+    return true;
+}
+
+bool _write_all(int fd, const char* buf, size_t n) {
+    while (n > 0) {
+        // 客户端先断开的话不要被 SIGPIPE 杀掉整个服务
+        auto put = send(fd, buf, n, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return false;
+        }
+        buf += put;
+        n -= size_t(put);
+    }
+    return true;
+}
+
+bool _read_frame(int fd, std::string& out) {
+    unsigned char header[4];
+    if (!_read_all(fd, reinterpret_cast<char*>(header), 4)) {
+        return false;
+    }
+    uint32_t len = uint32_t(header[0]) << 24 | uint32_t(header[1]) << 16 | uint32_t(header[2]) << 8 | header[3];
+    if (len > Server::MAX_FRAME) {
+        std::cerr << "error!: 请求太长(" << len << " 字节)，断开连接.\n";
+        return false;
+    }
+    out.resize(len);
+    return _read_all(fd, out.data(), len);
+}
+
+bool _write_frame(int fd, const std::string& payload) {
+    uint32_t len            = uint32_t(payload.size());
+    unsigned char header[4] = {
+        (unsigned char) (len >> 24), (unsigned char) (len >> 16), (unsigned char) (len >> 8), (unsigned char) len};
+    return _write_all(fd, reinterpret_cast<const char*>(header), 4) && _write_all(fd, payload.data(), payload.size());
+}
+
+void _session(int fd, const Env* base) {
+    auto env = base->clone();
+    Eval e(env.get());
+    std::string request, response, line;
+    while (_read_frame(fd, request)) {
+        response.clear();
+        SessionOutput::sink = &response;
+        std::istringstream source(request);
+        size_t t = 0;
+        while (std::getline(source, line)) {
+            Tokenize tokenize(line);
+            auto ast = e.compile(tokenize.tokens_list, t);
+            t        = 0;
+            auto res = e.eval_top(ast);
+            e.clear_status();
+            print_info(res);
+            Output::local().flush(); // 和这一行的错误信息按顺序进响应
+        }
+        SessionOutput::sink = nullptr;
+        if (!_write_frame(fd, response)) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+} // namespace
+
+int Server::serve(const std::string& path, const Env& base) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "error!: 套接字路径太长: " << path << '\n';
+        return 1;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // 上次没清理掉的套接字文件直接删掉，别的文件不碰
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(listener, SOMAXCONN) != 0) {
+        std::cerr << "error!: 无法监听 " << path << ": " << std::strerror(errno) << '\n';
+        if (listener >= 0) {
+            close(listener);
+        }
+        return 1;
+    }
+
+    // 进程里只装一次，之后 std::cout/std::cerr 按线程分流
+    static SessionOutput out(std::cout.rdbuf()), err(std::cerr.rdbuf());
+    std::cout.flush();
+    std::cout.rdbuf(&out);
+    std::cerr.rdbuf(&err);
+
+    for (;;) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EINTR && errno != ECONNABORTED) {
+                std::cerr << "error!: accept 失败: " << std::strerror(errno) << '\n';
+            }
+            continue;
+        }
+        std::thread(_session, fd, &base).detach();
+    }
+}
+
+} // namespace austlisp
@@ -0,0 +1,31 @@
+#pragma once
+
+#ifndef _SERVER_HPP_
+#define _SERVER_HPP_
+
+#include <cstdint>
+#include <string>
+
+#include "env.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  --serve PATH：在 Unix 域套接字上常驻，省掉每个任务启动进程、加载预置代码、构造全局环境的开销。
+ *
+ *  协议：请求和响应都是一帧，4 字节大端长度 + 内容。请求的内容是源码，按行求值，和 -f 一样；
+ *  响应是这些行打印出来的东西(结果和错误信息)。一个连接就是一个会话，会话之间并发执行，
+ *  各自有一份从 base 复制出来的环境，同一个连接上的请求共用这份环境。
+ */
+class Server {
+public:
+    static constexpr uint32_t MAX_FRAME = 64u << 20; // 更长的请求直接断开
+
+    // 一直 accept，只在套接字建不起来时返回非 0
+    static int serve(const std::string& path, const Env& base);
+};
+
+} // namespace austlisp
+
+#endif
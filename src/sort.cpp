@@ -0,0 +1,86 @@
+#include "sort.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace austlisp {
+
+namespace {
+
+template <class K>
+using Keyed = std::vector<std::pair<K, size_t>>;
+
+template <class K>
+void _sort_keyed(Keyed<K>& keyed, bool descending) {
+    if (descending) {
+        parallel_sort<false>(keyed, [](const auto& a, const auto& b) {
+            return b.first < a.first || (!(a.first < b.first) && a.second < b.second);
+        });
+    } else {
+        parallel_sort<false>(keyed, [](const auto& a, const auto& b) {
+            return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+        });
+    }
+}
+
+template <class K>
+void _write_order(const Keyed<K>& keyed, std::vector<size_t>& order) {
+    for (size_t i = 0; i < keyed.size(); ++i) {
+        order[i] = keyed[i].second;
+    }
+}
+
+} // namespace
+
+bool sort_order(const List& keys, bool descending, std::vector<size_t>& order) {
+    bool ints = true, numbers = true, strings = true;
+    for (const auto& key : keys) {
+        ints    = ints && key.token_type == Tokens::INTEGER;
+        numbers = numbers && (key.token_type == Tokens::INTEGER || key.token_type == Tokens::DOUBLE);
+        strings = strings && key.token_type == Tokens::STRING;
+    }
+    order.resize(keys.size());
+    if (ints) {
+        Keyed<int64_t> keyed(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            keyed[i] = {std::get<int64_t>(keys[i].value), i};
+        }
+        _sort_keyed(keyed, descending);
+        _write_order(keyed, order);
+        return true;
+    }
+    if (numbers) {
+        // 和 do_compare 一样整数转成 double 比；NaN 和谁比都不成立，单独拿出来按原顺序放到最后
+        Keyed<double> keyed;
+        keyed.reserve(keys.size());
+        std::vector<size_t> nans;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            double v = keys[i].token_type == Tokens::DOUBLE ? std::get<double>(keys[i].value)
+                                                            : double(std::get<int64_t>(keys[i].value));
+            if (std::isnan(v)) {
+                nans.emplace_back(i);
+            } else {
+                keyed.emplace_back(v, i);
+            }
+        }
+        _sort_keyed(keyed, descending);
+        _write_order(keyed, order);
+        std::copy(nans.begin(), nans.end(), order.begin() + keyed.size());
+        return true;
+    }
+    if (strings) {
+        // 字符串按字节比较，和 do_compare 一样；view 指向 keys 里的 Str，排序期间一直有效
+        Keyed<std::string_view> keyed(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            keyed[i] = {std::get<Str>(keys[i].value).view(), i};
+        }
+        _sort_keyed(keyed, descending);
+        _write_order(keyed, order);
+        return true;
+    }
+    return false;
+}
+
+} // namespace austlisp
@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef _SORT_HPP_
+#define _SORT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "lexical.hpp"
+#include "lisp.hpp"
+#include "thread_pool.hpp"
+
+namespace austlisp {
+
+// 少于这么多个元素时直接在当前线程排，切块归并不划算
+inline constexpr size_t PARALLEL_SORT_MIN = 1 << 16;
+
+/**
+ * @brief
+ *  元素多时切成 2 的幂个块，在线程池里各自排好，再一轮一轮两两归并，每一轮的归并也并行。
+ *  Stable 为 false 时块内用 std::sort(introsort)，为 true 时用 std::stable_sort；
+ *  std::merge 遇到相等的元素先取左边的，所以 Stable 时整体也是稳定的。
+ *  less 抛出的异常在调用线程里重新抛出，这时 v 里的元素顺序是乱的，但都还在。
+ */
+template <bool Stable, class T, class Less>
+void parallel_sort(std::vector<T>& v, Less less) {
+    size_t n        = v.size();
+    auto sort_range = [&](size_t begin, size_t end) {
+        if constexpr (Stable) {
+            std::stable_sort(v.begin() + begin, v.begin() + end, less);
+        } else {
+            std::sort(v.begin() + begin, v.begin() + end, less);
+        }
+    };
+    if (n < PARALLEL_SORT_MIN) {
+        sort_range(0, n);
+        return;
+    }
+    auto& pool = ThreadPool::instance();
+    // 至少 4 块，单核机器上走的也是同一条路
+    size_t chunks = 4;
+    while (chunks < pool.size() * 4) {
+        chunks *= 2;
+    }
+    size_t width = (n + chunks - 1) / chunks;
+    pool.parallel_for(chunks, 1, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            sort_range(std::min(n, c * width), std::min(n, (c + 1) * width));
+        }
+    });
+    std::vector<T> buf(n);
+    for (; width < n; width *= 2) {
+        size_t pairs = (n + 2 * width - 1) / (2 * width);
+        pool.parallel_for(pairs, 1, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; ++p) {
+                size_t lo = p * 2 * width, mid = std::min(n, lo + width), hi = std::min(n, lo + 2 * width);
+                std::merge(std::make_move_iterator(v.begin() + lo), std::make_move_iterator(v.begin() + mid),
+                    std::make_move_iterator(v.begin() + mid), std::make_move_iterator(v.begin() + hi), buf.begin() + lo,
+                    less);
+            }
+        });
+        v.swap(buf);
+    }
+}
+
+/**
+ * @brief
+ *  keys 都是整数、都是数字或者都是字符串时按自然顺序(和 < 一样)排序，不回调解释器。
+ *  排的是 (key, 原下标)，key 相等时按原下标，所以结果稳定，也和切成几块无关。
+ *  order 是排好以后每个位置上元素原来的下标。NaN 不管升序降序都排在最后。
+ *  key 的类型不一致时返回 false。
+ */
+bool sort_order(const List& keys, bool descending, std::vector<size_t>& order);
+
+} // namespace austlisp
+
+#endif
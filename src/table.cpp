@@ -0,0 +1,300 @@
+#include "table.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "budget.hpp"
+
+namespace austlisp {
+
+namespace {
+
+// 只读映射整个文件，析构时解除
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            if (st.st_size == 0) {
+                _empty = true; // 空文件不能 mmap
+            } else if (void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); p != MAP_FAILED) {
+                madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+                _data = static_cast<const char*>(p);
+                _size = size_t(st.st_size);
+            }
+        }
+        int err = errno;
+        close(fd);
+        errno = err;
+    }
+    ~MappedFile() {
+        if (_data != nullptr) {
+            munmap(const_cast<char*>(_data), _size);
+        }
+    }
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok() const noexcept {
+        return _data != nullptr || _empty;
+    }
+    const char* begin() const noexcept {
+        return _data;
+    }
+    const char* end() const noexcept {
+        return _data + _size;
+    }
+
+private:
+    const char* _data = nullptr;
+    size_t _size      = 0;
+    bool _empty       = false;
+};
+
+struct Field {
+    std::string_view text; // 带引号的字段是引号里面的部分
+    bool quoted  = false;
+    bool escaped = false; // 里面有 "" 要还原成 "
+    bool last    = false; // 这一行的最后一个字段
+};
+
+// 按 RFC 4180 切字段：不带引号的字段一直扫到分隔符或换行，带引号的可以包含分隔符和换行
+class Scanner {
+public:
+    Scanner(const char* begin, const char* end, char sep) : _p(begin), _end(end), _sep(sep) {}
+
+    // 跳过空行，没有更多行了返回 false
+    bool next_row() {
+        while (_p < _end && (*_p == '\n' || *_p == '\r')) {
+            if (*_p == '\n') {
+                _line++;
+            }
+            _p++;
+        }
+        return _p < _end;
+    }
+
+    // 格式错误(引号没闭合、引号后面跟了别的字符)返回 false
+    bool next_field(Field& f) {
+        f = Field{};
+        const char* q;
+        if (_p < _end && *_p == '"') {
+            const char* start = ++_p;
+            for (;;) {
+                q = static_cast<const char*>(std::memchr(_p, '"', size_t(_end - _p)));
+                if (q == nullptr) {
+                    return false;
+                }
+                if (q + 1 < _end && q[1] == '"') {
+                    f.escaped = true;
+                    _p        = q + 2;
+                    continue;
+                }
+                break;
+            }
+            for (const char* c = start; c < q; ++c) {
+                _line += *c == '\n';
+            }
+            f.text   = std::string_view(start, size_t(q - start));
+            f.quoted = true;
+            q++;
+            if (q < _end && *q == '\r') {
+                q++;
+            }
+            if (q < _end && *q != _sep && *q != '\n') {
+                return false;
+            }
+        } else {
+            q = _p;
+            while (q < _end && *q != _sep && *q != '\n') {
+                q++;
+            }
+            const char* text_end = q;
+            if (text_end > _p && text_end[-1] == '\r') {
+                text_end--;
+            }
+            f.text = std::string_view(_p, size_t(text_end - _p));
+        }
+        f.last = q == _end || *q == '\n';
+        if (q < _end && *q == '\n') {
+            _line++;
+        }
+        _p = q < _end ? q + 1 : q;
+        return true;
+    }
+
+    size_t line() const noexcept {
+        return _line;
+    }
+
+private:
+    const char* _p;
+    const char* _end;
+    char _sep;
+    size_t _line = 1;
+};
+
+std::string _unescape(const Field& f) {
+    std::string out;
+    out.reserve(f.text.size());
+    for (size_t i = 0; i < f.text.size(); ++i) {
+        out += f.text[i];
+        if (f.text[i] == '"') {
+            i++; // "" -> "
+        }
+    }
+    return out;
+}
+
+Str _field_str(const Field& f) {
+    return f.escaped ? Str::from(_unescape(f)) : Str(f.text);
+}
+
+template <class T>
+bool _parse_whole(std::string_view s, T& v) {
+    auto res = std::from_chars(s.data(), s.data() + s.size(), v);
+    return res.ec == std::errc{} && res.ptr == s.data() + s.size();
+}
+
+// 第一遍扫描时每列见过的最宽类型
+struct ColumnState {
+    bool any_int    = false;
+    bool any_double = false;
+    bool any_string = false;
+    bool any_empty  = false;
+
+    void see(const Field& f) {
+        if (f.quoted) {
+            any_string = true;
+            return;
+        }
+        if (f.text.empty()) {
+            any_empty = true;
+            return;
+        }
+        if (any_string) {
+            return;
+        }
+        int64_t i;
+        double d;
+        if (!any_double && _parse_whole(f.text, i)) {
+            any_int = true;
+        } else if (_parse_whole(f.text, d)) {
+            any_double = true;
+        } else {
+            any_string = true;
+        }
+    }
+    Column::Type type() const {
+        if (any_string || !(any_int || any_double)) {
+            return Column::STRING;
+        }
+        // 整数列有空格子也只能放 NaN
+        return any_double || any_empty ? Column::DOUBLE : Column::INT;
+    }
+};
+
+} // namespace
+
+std::shared_ptr<Table> load_csv(const std::string& path, char sep) {
+    MappedFile file(path);
+    if (!file.ok()) {
+        std::cerr << "error!: 无法读取 " << path << ": " << std::strerror(errno) << '\n';
+        return nullptr;
+    }
+    Scanner header(file.begin(), file.end(), sep);
+    if (!header.next_row()) {
+        std::cerr << "error!: " << path << " 是空的，至少要有一行列名.\n";
+        return nullptr;
+    }
+    auto table = std::make_shared<Table>();
+    Field f;
+    do {
+        if (!header.next_field(f)) {
+            std::cerr << "error!: " << path << " 第" << header.line() << "行的引号不匹配.\n";
+            return nullptr;
+        }
+        table->columns.emplace_back().name = f.escaped ? _unescape(f) : std::string(f.text);
+    } while (!f.last);
+    size_t ncols = table->columns.size();
+
+    // 第一遍：数行数，定每列的类型
+    auto& budget = Budget::local();
+    std::vector<ColumnState> states(ncols);
+    Scanner scan = header;
+    while (scan.next_row()) {
+        budget.tick();
+        size_t line = scan.line();
+        size_t col  = 0;
+        do {
+            if (!scan.next_field(f)) {
+                std::cerr << "error!: " << path << " 第" << scan.line() << "行的引号不匹配.\n";
+                return nullptr;
+            }
+            if (col < ncols) {
+                states[col].see(f);
+            }
+            col++;
+        } while (!f.last);
+        if (col != ncols) {
+            std::cerr << "error!: " << path << " 第" << line << "行有" << col << "列，表头是" << ncols << "列.\n";
+            return nullptr;
+        }
+        table->rows++;
+    }
+
+    for (size_t c = 0; c < ncols; ++c) {
+        auto& column = table->columns[c];
+        column.type  = states[c].type();
+        switch (column.type) {
+        case Column::INT:
+            column.ints.reserve(table->rows);
+            break;
+        case Column::DOUBLE:
+            column.doubles.reserve(table->rows);
+            break;
+        case Column::STRING:
+            column.strs.reserve(table->rows);
+            break;
+        }
+    }
+
+    // 第二遍：格式已经检查过了，直接填
+    scan = header;
+    while (scan.next_row()) {
+        budget.tick();
+        for (auto& column : table->columns) {
+            scan.next_field(f);
+            switch (column.type) {
+            case Column::INT:
+                _parse_whole(f.text, column.ints.emplace_back());
+                break;
+            case Column::DOUBLE:
+                if (f.text.empty()) {
+                    column.doubles.push_back(std::numeric_limits<double>::quiet_NaN());
+                } else {
+                    _parse_whole(f.text, column.doubles.emplace_back());
+                }
+                break;
+            case Column::STRING:
+                column.strs.push_back(_field_str(f));
+                break;
+            }
+        }
+    }
+    return table;
+}
+
+} // namespace austlisp
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef _TABLE_HPP_
+#define _TABLE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lexical.hpp"
+#include "lisp.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  load-csv 读进来的表：按列存，每列是一个类型确定的数组，不为每个值建 Token。
+ *  整数列 8 字节一个值，浮点列也是，字符串列是 Str(短的不分配)。
+ *  取值的时候才包成 Token。表创建后不再修改。
+ */
+struct Column {
+    enum Type : uint8_t {
+        INT,
+        DOUBLE, // 空格子是 NaN
+        STRING,
+    };
+
+    std::string name;
+    Type type = STRING;
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    std::vector<Str> strs;
+
+    Token at(size_t row) const {
+        switch (type) {
+        case INT:
+            return Token{Tokens::INTEGER, ints[row]};
+        case DOUBLE:
+            return Token{Tokens::DOUBLE, doubles[row]};
+        default:
+            return Token{Tokens::STRING, strs[row]};
+        }
+    }
+};
+
+struct Table : Handle {
+    std::vector<Column> columns;
+    size_t rows = 0;
+
+    // 按列名找，找不到返回 -1
+    int find(std::string_view name) const {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (columns[i].name == name) {
+                return int(i);
+            }
+        }
+        return -1;
+    }
+};
+
+// mmap 整个文件解析，第一行是列名；出错时打印原因返回 nullptr
+std::shared_ptr<Table> load_csv(const std::string& path, char sep);
+
+} // namespace austlisp
+
+#endif
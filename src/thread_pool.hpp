@@ -0,0 +1,203 @@
+#pragma once
+
+#ifndef _THREAD_POOL_HPP_
+#define _THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "output.hpp"
+
+namespace austlisp {
+
+/**
+ * @brief
+ *  work-stealing 线程池。每个 worker 有自己的双端队列，从队头取自己的任务，
+ *  空了就从别人的队尾偷。提交任务的线程在等待时也会去偷任务来做，所以嵌套的
+ *  parallel_for 不会死锁。
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t n = std::max(1u, std::thread::hardware_concurrency())) : _queues(n) {
+        for (auto& q : _queues) {
+            q = std::make_unique<Queue>();
+        }
+        for (size_t i = 0; i < n; ++i) {
+            _workers.emplace_back([this, i] { _worker_loop(i); });
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+            _stop = true;
+        }
+        _sleep_cv.notify_all();
+        for (auto& w : _workers) {
+            w.join();
+        }
+    }
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& instance() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    size_t size() const noexcept {
+        return _workers.size();
+    }
+
+    /**
+     * @brief
+     *  把 [0, n) 按 grain 切块，fn(begin, end) 在线程池里执行，调用者一起干活直到全部完成。
+     *  任何一块抛出的异常会在调用线程里重新抛出。
+     *  每块的标准输出先各自收起来，全部完成后按块的顺序写进调用线程的 Output，
+     *  所以和顺序执行时的输出一样，也排在调用者之后的输出前面。
+     */
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+        if (n == 0) {
+            return;
+        }
+        grain              = std::max<size_t>(grain, 1);
+        size_t chunks      = (n + grain - 1) / grain;
+        auto remaining     = std::make_shared<std::atomic<size_t>>(chunks);
+        auto error         = std::make_shared<std::exception_ptr>();
+        auto error_mutex   = std::make_shared<std::mutex>();
+        auto outputs       = std::make_shared<std::vector<std::string>>(chunks);
+        size_t start_queue = _next_queue.fetch_add(1, std::memory_order_relaxed);
+
+        for (size_t c = 0; c < chunks; ++c) {
+            size_t begin = c * grain;
+            size_t end   = std::min(n, begin + grain);
+            _push((start_queue + c) % _queues.size(), [=, &fn] {
+                {
+                    Output::Capture capture;
+                    try {
+                        fn(begin, end);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(*error_mutex);
+                        if (!*error) {
+                            *error = std::current_exception();
+                        }
+                    }
+                    (*outputs)[c] = capture.take();
+                }
+                remaining->fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+        {
+            // 拿一下锁，防止 worker 检查完条件、还没睡下时错过通知
+            std::lock_guard<std::mutex> lock(_sleep_mutex);
+        }
+        _sleep_cv.notify_all();
+
+        // 等待期间自己也去偷任务
+        while (remaining->load(std::memory_order_acquire) != 0) {
+            Task task;
+            if (_steal(start_queue, task)) {
+                task();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        auto& out = Output::local();
+        for (auto& chunk : *outputs) {
+            out.buffer() += chunk;
+        }
+        out.commit();
+        if (*error) {
+            std::rethrow_exception(*error);
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    void _push(size_t index, Task&& task) {
+        auto& q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q.m);
+        q.tasks.emplace_back(std::move(task));
+        _pending.fetch_add(1, std::memory_order_release);
+    }
+
+    bool _pop_front(size_t index, Task& out) {
+        auto& q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (q.tasks.empty()) {
+            return false;
+        }
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        _pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool _pop_back(size_t index, Task& out) {
+        auto& q = *_queues[index];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (q.tasks.empty()) {
+            return false;
+        }
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        _pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    // 先看自己的队列，再从其他队列的尾部偷
+    bool _steal(size_t self, Task& out) {
+        size_t n = _queues.size();
+        if (_pop_front(self % n, out)) {
+            return true;
+        }
+        for (size_t i = 1; i < n; ++i) {
+            if (_pop_back((self + i) % n, out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _worker_loop(size_t self) {
+        for (;;) {
+            Task task;
+            if (_steal(self, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_sleep_mutex);
+            _sleep_cv.wait(lock, [this] { return _stop || _pending.load(std::memory_order_acquire) != 0; });
+            if (_stop) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+    std::atomic<size_t> _pending{0};
+    std::atomic<size_t> _next_queue{0};
+    std::mutex _sleep_mutex;
+    std::condition_variable _sleep_cv;
+    bool _stop = false;
+};
+
+} // namespace austlisp
+
+#endif
@@ -0,0 +1,176 @@
+#include "trace.hpp"
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+
+namespace austlisp::trace {
+
+namespace {
+
+struct Ring {
+    Record records[RING_SIZE];
+    std::atomic<uint64_t> head{0}; // 下一个要写的位置，只增不减
+    int thread_index;
+};
+
+// 登记所有线程的缓冲区，信号处理函数里只读这个数组
+static constexpr size_t MAX_THREADS = 256;
+std::atomic<Ring*> _rings[MAX_THREADS];
+std::atomic<size_t> _ring_count{0};
+
+// 栈溢出时信号处理函数没法在原来的栈上跑，每个线程要有自己的备用栈(任务的栈也跑在线程上，一起覆盖)
+void _install_altstack() noexcept {
+    static constexpr size_t ALT_STACK_SIZE = 64 * 1024;
+    stack_t old{};
+    if (sigaltstack(nullptr, &old) == 0 && (old.ss_flags & SS_DISABLE) == 0) {
+        return;
+    }
+    void* mem = mmap(nullptr, ALT_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        return;
+    }
+    stack_t ss{};
+    ss.ss_sp    = mem; // 和 Ring 一样不释放，线程退出时内核不会再用它
+    ss.ss_size  = ALT_STACK_SIZE;
+    ss.ss_flags = 0;
+    sigaltstack(&ss, nullptr);
+}
+
+Ring* _local() noexcept {
+    thread_local Ring* ring = [] {
+        _install_altstack();
+        auto r   = new Ring(); // 故意不释放，线程退出后事件还要能 dump
+        size_t i = _ring_count.fetch_add(1, std::memory_order_relaxed);
+        if (i < MAX_THREADS) {
+            r->thread_index = int(i);
+            _rings[i].store(r, std::memory_order_release);
+        }
+        return r;
+    }();
+    return ring;
+}
+
+const char* _event_name(Event kind) noexcept {
+    switch (kind) {
+    case Event::NODE:
+        return "node";
+    case Event::CALL:
+        return "call";
+    case Event::RETURN:
+        return "return";
+    case Event::DEFINE:
+        return "define";
+    case Event::SETQ:
+        return "setq";
+    case Event::BUILDIN:
+        return "buildin";
+    }
+    return "?";
+}
+
+// 不能用 printf 系列，自己拼
+size_t _append(char* buf, size_t pos, size_t cap, const char* s) noexcept {
+    while (*s != '\0' && pos < cap) {
+        buf[pos++] = *s++;
+    }
+    return pos;
+}
+
+size_t _append_u64(char* buf, size_t pos, size_t cap, uint64_t v) noexcept {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n > 0 && pos < cap) {
+        buf[pos++] = tmp[--n];
+    }
+    return pos;
+}
+
+void _on_signal(int sig) {
+    dump(STDERR_FILENO);
+    if (sig != SIGUSR1) {
+        raise(sig); // SA_RESETHAND 已经换回了默认处理，按原来的方式退出
+    }
+}
+
+void _set_handler(int sig, int flags) noexcept {
+    struct sigaction sa{};
+    sa.sa_handler = _on_signal;
+    sa.sa_flags   = SA_ONSTACK | flags;
+    sigemptyset(&sa.sa_mask);
+    sigaction(sig, &sa, nullptr);
+}
+
+std::terminate_handler _old_terminate = nullptr;
+
+void _on_terminate() {
+    dump(STDERR_FILENO);
+    if (_old_terminate != nullptr) {
+        _old_terminate();
+    }
+    std::abort();
+}
+
+} // namespace
+
+void record(Event kind, std::string_view name) noexcept {
+    Ring* r  = _local();
+    uint64_t h = r->head.load(std::memory_order_relaxed);
+    auto& rec  = r->records[h & (RING_SIZE - 1)];
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    rec.ts_ns  = uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    rec.kind   = kind;
+    size_t len = name.size() < sizeof(rec.name) - 1 ? name.size() : sizeof(rec.name) - 1;
+    std::memcpy(rec.name, name.data(), len);
+    rec.name[len] = '\0';
+    r->head.store(h + 1, std::memory_order_release);
+}
+
+void dump(int fd) noexcept {
+    char line[128];
+    size_t count = _ring_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count && i < MAX_THREADS; ++i) {
+        Ring* r = _rings[i].load(std::memory_order_acquire);
+        if (r == nullptr) {
+            continue;
+        }
+        uint64_t head  = r->head.load(std::memory_order_acquire);
+        uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+        size_t n       = _append(line, 0, sizeof(line), "--- austlisp trace, thread ");
+        n              = _append_u64(line, n, sizeof(line), i);
+        n              = _append(line, n, sizeof(line), " ---\n");
+        write(fd, line, n);
+        for (uint64_t k = first; k < head; ++k) {
+            const auto& rec = r->records[k & (RING_SIZE - 1)];
+            n               = _append_u64(line, 0, sizeof(line), rec.ts_ns);
+            n               = _append(line, n, sizeof(line), " ");
+            n               = _append(line, n, sizeof(line), _event_name(rec.kind));
+            n               = _append(line, n, sizeof(line), " ");
+            n               = _append(line, n, sizeof(line), rec.name);
+            n               = _append(line, n, sizeof(line), "\n");
+            write(fd, line, n);
+        }
+    }
+}
+
+void install_handlers() noexcept {
+    _install_altstack();
+    _set_handler(SIGUSR1, SA_RESTART);
+    _set_handler(SIGSEGV, SA_RESETHAND);
+    _set_handler(SIGBUS, SA_RESETHAND);
+    _set_handler(SIGABRT, SA_RESETHAND);
+    _old_terminate = std::set_terminate(_on_terminate);
+}
+
+} // namespace austlisp::trace
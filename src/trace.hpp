@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef _TRACE_HPP_
+#define _TRACE_HPP_
+
+#include <cstdint>
+#include <string_view>
+
+/**
+ * 求值过程的事件追踪，cmake -DAUSTLISP_TRACE=ON 时才编译进来。
+ * 每个线程一个固定大小的环形缓冲，只有本线程写，不加锁；出错(terminate、段错误)或者收到
+ * SIGUSR1 时把所有线程最近的事件打到 stderr。没打开时 AUSTLISP_TRACE_EVENT 展开为空，参数也不会求值。
+ */
+#ifdef AUSTLISP_TRACE
+#define AUSTLISP_TRACE_EVENT(kind, name) ::austlisp::trace::record(::austlisp::trace::Event::kind, (name))
+#else
+#define AUSTLISP_TRACE_EVENT(kind, name) ((void) 0)
+#endif
+
+namespace austlisp::trace {
+
+enum class Event : uint8_t {
+    NODE, // 进入一个 AST 节点
+    CALL, // 调用 lambda
+    RETURN, // lambda 返回
+    DEFINE,
+    SETQ,
+    BUILDIN, // 调用内建函数
+};
+
+struct Record {
+    uint64_t ts_ns;
+    Event kind;
+    char name[23]; // 名字截断存放，记录时不分配内存
+};
+
+static constexpr size_t RING_SIZE = 4096; // 必须是 2 的幂
+
+void record(Event kind, std::string_view name) noexcept;
+
+// 只用 async-signal-safe 的调用，信号处理函数里也能用
+void dump(int fd) noexcept;
+
+// SIGUSR1 时 dump；SIGSEGV/SIGBUS/SIGABRT/terminate 时 dump 后按原来的方式退出。
+// 处理函数跑在每个线程自己的 sigaltstack 上，栈溢出也能 dump
+void install_handlers() noexcept;
+
+} // namespace austlisp::trace
+
+#endif
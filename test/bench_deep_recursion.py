@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+# 比 JIT 的 MAX_DEPTH 深的递归，-O2 不能比 -O1 慢很多：机器码放弃以后下面的调用要直接解释执行，
+# 不能每一层都再跑 MAX_DEPTH 层机器码才放弃
+# python3 bench_deep_recursion.py <austlisp_bench>
+import json
+import subprocess
+import sys
+
+# 修之前 -O2 要慢十倍左右，留足余量防止机器抖动
+MAX_RATIO = 2.0
+
+
+def ns_per_op(bench, opt):
+    p = subprocess.run([bench, "-w", "deep_recursion", "-O", str(opt)], capture_output=True, text=True, timeout=120)
+    if p.returncode != 0:
+        print(p.stderr)
+        sys.exit(1)
+    return json.loads(p.stdout)["workloads"][0]["ns_per_op"]
+
+
+def main():
+    bench = sys.argv[1]
+    # 各跑三次取最快的
+    o1 = min(ns_per_op(bench, 1) for _ in range(3))
+    o2 = min(ns_per_op(bench, 2) for _ in range(3))
+    print(f"-O1 {o1:.0f} ns, -O2 {o2:.0f} ns")
+    if o2 > o1 * MAX_RATIO:
+        print(f"-O2 is {o2 / o1:.1f}x slower than -O1")
+        sys.exit(1)
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# --max-steps/--max-heap/--max-depth/--timeout：超限的那一行报错并返回 nil，后面的行照常求值
+# python3 budget_limits.py <austlisp>
+import subprocess
+import sys
+import tempfile
+
+SOURCE = """(define down (lambda (n) (if (equal n 0) 0 (+ 1 (down (- n 1))))))
+(define keep (lambda (n acc) (if (equal n 0) 0 (keep (- n 1) (make-bytevector 100000)))))
+(down 50)
+{form}
+(+ 1 2)
+"""
+
+# 最后一项：不加限制时也跑一遍，确认能算完；太大的就不跑了
+CASES = [
+    (["--max-steps", "100000"], "(dotimes (i 100000000) i)", "超出求值步数限制 100000", True),
+    (["--timeout", "100"], "(dotimes (i 100000000) i)", "超时 100 ms", True),
+    (["--max-depth", "100"], "(down 1000)", "超出调用深度限制 100", True),
+    (["--max-heap", "10000000"], "(keep 2000 0)", "超出内存限制 10000000 字节", True),
+    # 原生的内建函数里面也要受限制，不经过求值节点
+    (["--max-heap", "1000000"], "(length (collect (range 20000000)))", "超出内存限制 1000000 字节", False),
+    (["--max-heap", "1000000"], "(make-bytevector 2000000000)", "超出内存限制 1000000 字节", False),
+    (["--max-heap", "1000000"], "(length (sort (range 3000000)))", "超出内存限制 1000000 字节", True),
+    (["--timeout", "100"], "(length (collect (range 20000000)))", "超时 100 ms", False),
+    (["--timeout", "100"], "(length (sort (range 3000000)))", "超时 100 ms", True),
+]
+
+
+def run(exe, args, form):
+    with tempfile.NamedTemporaryFile("w", suffix=".lisp") as f:
+        f.write(SOURCE.format(form=form))
+        f.flush()
+        return subprocess.run([exe, "-f", f.name] + args, capture_output=True, text=True, timeout=60)
+
+
+def main():
+    exe, failed = sys.argv[1], False
+    for args, form, message, unlimited in CASES:
+        for opt in ("-O0", "-O2"):
+            p = run(exe, args + [opt], form)
+            if p.returncode != 0 or p.stdout != "50\n3\n" or f"error!: {message}." not in p.stderr:
+                print(f"{' '.join(args)} {opt} {form}: rc={p.returncode} stdout={p.stdout!r} stderr={p.stderr!r}")
+                failed = True
+        if not unlimited:
+            continue
+        # 没有限制时同样的表达式能算完
+        p = run(exe, [], form)
+        if p.returncode != 0 or p.stderr != "":
+            print(f"unlimited {form}: rc={p.returncode} stderr={p.stderr!r}")
+            failed = True
+    if failed:
+        sys.exit(1)
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
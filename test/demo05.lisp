@@ -0,0 +1,81 @@
+(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(fib 20)
+(fib 15.0)
+(define tak (lambda (x y z) (if (< y x) (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y)) z)))
+(tak 12 8 4)
+(define spin (lambda (n) (while (< n 1000) (setq n (+ n 1)))))
+(spin 0)
+(define sq (lambda (x) (* x x)))
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 3)
+(sq 1.5)
+(sq -4)
+(define half (lambda (a b) (/ a b)))
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 2)
+(half 7 0)
+(half -9223372036854775807 -1)
+(half 7.5 2)
+(half 1 0.5)
+(define lt (lambda (a b) (< a b)))
+(lt 1 2)
+(lt 2.5 1)
+(define cnt (lambda (n acc) (if (< n 1) acc (cnt (- n 1) (+ acc 0.5)))))
+(cnt 500 0.0)
+(cnt 5000 0.0)
+(define rec (lambda (n) (if (< n 1) 0 (+ 1 (rec (- n 1))))))
+(rec 3000)
+(rec 100)
+(define f (lambda (n) (if (< n 2) n (+ (f (- n 1)) 1))))
+(f 1)
+(f 2)
+(f 3)
+(f 4)
+(f 5)
+(f 6)
+(f 7)
+(f 8)
+(f 9)
+(f 10)
+(f 11)
+(f 12)
+(f 13)
+(f 14)
+(f 15)
+(f 16)
+(f 17)
+(f 18)
+(define h f)
+(setq f (lambda (n) (+ 100 0)))
+(h 5)
+(f 5)
@@ -0,0 +1,21 @@
+(define sq (lambda (x) (* x x)))
+(define add (lambda (a b) (+ a b)))
+(pmap sq '(1 2 3 4 5))
+(pmap sq '(1.5 2))
+(pmap (lambda (x) (< x 2)) '(1 2 3))
+(preduce add 0 '(1 2 3 4 5))
+(preduce add 0 (pmap sq '(1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59 60 61 62 63 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95 96 97 98 99 100)))
+(preduce add 0 '())
+(pfor-each sq '(1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59 60 61 62 63 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95 96 97 98 99 100))
+(define big (pmap sq '(1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30 31 32 33 34 35 36 37 38 39 40 41 42 43 44 45 46 47 48 49 50 51 52 53 54 55 56 57 58 59 60 61 62 63 64 65 66 67 68 69 70 71 72 73 74 75 76 77 78 79 80 81 82 83 84 85 86 87 88 89 90 91 92 93 94 95 96 97 98 99 100)))
+(car big)
+(pmap car '(1 2))
+(preduce add 0 '(1 "a" 2))
+(pmap sq 3)
+(pmap (lambda () (+ 1 0)) '(1 2))
+(preduce (lambda (x) (+ x 0)) 0 '(1 2))
+(pfor-each (lambda (a b) (+ a b)) '(1 2))
+(map (lambda () (+ 1 0)) '(1 2))
+(reduce (lambda (x) (+ x 0)) 0 '(1 2))
+(sq 1 2)
+(sq 3)
@@ -0,0 +1,21 @@
+(define loop (lambda (n) (if (< n 1) 0 (+ 1 (loop (- n 1))))))
+(define t1 (spawn loop 10))
+(define t2 (spawn loop 5000))
+(await t2)
+(await t1)
+(await t1)
+(define ch (channel 2))
+(define produce (lambda (c n) (while (< 0 n) (setq n (- n (if (send c n) 1 0))))))
+(define p (spawn produce ch 3))
+(recv ch)
+(recv ch)
+(recv ch)
+(await p)
+(define ch2 (channel 1))
+(send ch2 "hello")
+(recv ch2)
+(yield)
+(recv ch2)
+(spawn 1)
+ch
+t1
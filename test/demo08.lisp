@@ -0,0 +1,24 @@
+(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define mfib (memoize fib))
+(mfib 20)
+(mfib 20)
+(mfib 10)
+(memo-stats mfib)
+(memo-clear mfib)
+(memo-stats mfib)
+(mfib 20)
+(memo-stats mfib)
+(define cat (lambda (a b) (+ a b)))
+(define mcat (memoize cat))
+(mcat "ab" "cd")
+(mcat "ab" "cd")
+(memo-stats mcat)
+(memo-stats fib)
+(memoize 1)
+(define g (lambda (x) (+ x later)))
+(define mg (memoize g))
+(mg 1)
+(define later 10)
+(mg 1)
+(g 1)
+(memo-stats mg)
@@ -0,0 +1,10 @@
+(define s (runtime-stats))
+(car (car s))
+(car (car (cdr s)))
+(car (car (cdr (cdr s))))
+(car (car (cdr (cdr (cdr s)))))
+(car (car (cdr (cdr (cdr (cdr s))))))
+(car (car (cdr (cdr (cdr (cdr (cdr s)))))))
+(car (car (cdr (cdr (cdr (cdr (cdr (cdr s))))))))
+(define v (car (cdr (car s))))
+(< -1 v)
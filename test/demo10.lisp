@@ -0,0 +1,25 @@
+(+ 1 2)
+(* (+ 1 2) (- 10 4))
+(/ 7 2)
+(/ 7.0 2)
+(/ 1 0)
+(< 1 2)
+(> 1.5 2)
+(if (< 1 2) "then" "else")
+(if (> 1 2) "then" "else")
+(if (< 1 2) 1)
+(+ (if (< 1 2) 10 20) 3)
+(equal 1 1)
+(equal "a" "b")
+(eq 1 1.0)
+(define k (lambda (x) (+ x (* 2 3))))
+(k 1)
+(k 2.5)
+(define pick (lambda (x) (if (equal 1 1) (+ x 1) (- x 1))))
+(pick 5)
+(define shadow (lambda (equal) (equal 1 1)))
+(define no (lambda (a b) (< 1 0)))
+(shadow no)
+(setq equal no)
+(pick 5)
+(equal 1 1)
@@ -0,0 +1,22 @@
+(let ((x 1) (y 2)) (+ x y))
+(let* ((x 1) (y (+ x 10))) (* x y))
+(define x 100)
+(let ((x 1) (y x)) y)
+(let* ((x 1) (y x)) y)
+(let ((a 5)) (setq a (+ a 1)) a)
+(let ((a 1)) (let ((a 2) (b a)) (+ (* a 10) b)))
+(let ((s "hi")) (+ s " there"))
+(define f (lambda (n) (let ((sq (* n n)) (cube (* n (* n n)))) (+ sq cube))))
+(f 3)
+(f 2.5)
+(define mk (lambda (n) (let ((k (* n 2))) (lambda (x) (+ x k)))))
+(define add6 (mk 3))
+(add6 1)
+(define g (let ((base 10)) (lambda (x) (+ x base))))
+(g 5)
+(define sum (lambda (n acc) (if (< n 1) acc (let ((next (- n 1))) (sum next (+ acc n))))))
+(sum 100 0)
+(let ((i 0) (total 0)) (while (< i 10) (setq total (+ total (let ((j i)) (setq i (+ i 1)) j)))) total)
+(let ((equal 1)) (+ equal 1))
+(let x 1)
+x
@@ -0,0 +1,39 @@
+(define s 0)
+(dotimes (i 5) (setq s (+ s i)))
+s
+(define c 0)
+(for (k 10 0 -3) (setq c (+ (* c 100) k)))
+c
+(for (k 0 3) (setq k 100) (setq c (+ c 1)))
+c
+(define deep 3)
+deep
+(define sumto (lambda (n) (let ((acc 0)) (dotimes (i n) (setq acc (+ acc i))) acc)))
+(sumto 10)
+(sumto 10)
+(sumto 10)
+(dotimes (i 2.5) 1)
+(for (i 0 3 0) 1)
+(define sumto (lambda (n) (let ((acc 0)) (dotimes (i n) (setq acc (+ acc i))) acc)))
+(define down (lambda (n) (let* ((acc 0) (k 1.5)) (for (i n 0 -2) (setq acc (+ acc i)) (setq i 0)) (+ acc k))))
+(define nest (lambda (n) (let ((c 0)) (dotimes (i n) (for (j i n) (setq c (+ c 1)))) c)))
+(define w (lambda (n) (let ((c 0)) (while (< c n) (setq c (+ c 1))) c)))
+(define run (lambda (k) (if (< k 1) 0 (+ (+ (+ (sumto 100) (down 9)) (+ (nest 10) (w 5))) (run (- k 1))))))
+(run 1)
+(run 40)
+(sumto 100)
+(down 9)
+(nest 10)
+(w 5)
+(define i 0)
+(define n 0)
+(while (< i 3) (setq i (+ i 1)))
+i
+(dotimes (k 3) (setq n (+ n k)))
+n
+(define drop 7)
+drop
+(sumto 1000000)
+(define bigstep (lambda (n) (let ((s 0)) (for (i 0 n 3000000000) (setq s (+ s 1))) s)))
+(bigstep 10000000000)
+(bigstep 10000000000)
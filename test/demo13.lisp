@@ -0,0 +1,22 @@
+(collect (range 5))
+(collect (range 2 10 3))
+(collect (range 5 0 -2))
+(define sq (lambda (x) (* x x)))
+(define even (lambda (x) (equal (* (/ x 2) 2) x)))
+(define add (lambda (a b) (+ a b)))
+(collect (lazy-map sq (range 5)))
+(collect (lazy-filter even (lazy-map sq (range 10))))
+(collect (take 5 (iterate (lambda (x) (* x 2)) 1)))
+(reduce add 0 (range 101))
+(reduce add 0 '(1 2 3))
+(collect (lazy-map sq '(1 2 (3))))
+(define r (range 3))
+r
+(reduce add 0 r)
+(reduce add 0 r)
+(collect (take 3 (lazy-filter even (iterate (lambda (x) (+ x 1)) 1))))
+(collect (take 0 (range 10)))
+(range 1.5)
+(range 1 2 0)
+(reduce add 0 (lazy-map (lambda (x) (car x)) (range 3)))
+(reduce add 0 (lazy-map sq (range 100000)))
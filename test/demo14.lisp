@@ -0,0 +1,34 @@
+(define l '(1 (2 3) 4 (5 (6)) "s"))
+(length l)
+(length '())
+(nth 0 l)
+(nth 1 l)
+(nth 3 l)
+(nth 9 l)
+(nth -1 l)
+(append '(1 2) '((3)) '() '(4))
+(append)
+(reverse l)
+(reverse '())
+(define sq (lambda (x) (* x x)))
+(map sq '(1 2 3))
+(define big (lambda (x) (> x 2)))
+(filter big '(1 5 2 7 3))
+(filter big '())
+(reduce (lambda (a b) (+ a b)) 0 '(1 2 3 4))
+(member 4 l)
+(member '(2 3) l)
+(member 42 l)
+(member "s" l)
+(define al '((a 1) (b 2) ((c) 3)))
+(assoc 'b al)
+(assoc '(c) al)
+(assoc 'z al)
+(map car '((1 2)))
+(map sq '(1 a))
+(member 'a '(x a b))
+(define big-list (collect (range 100000)))
+(length big-list)
+(nth 99999 big-list)
+(length (reverse (map sq big-list)))
+(reduce (lambda (a b) (+ a b)) 0 (filter big big-list))
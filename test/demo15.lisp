@@ -0,0 +1,28 @@
+(define s "hello, world of lisp strings")
+s
+(string-length s)
+(substring s 7)
+(substring s 0 5)
+(substring s 7 12)
+(substring s 3 2)
+(substring "abc" 0 3)
+(+ s "!")
+(+ "ab" "cd")
+(< "abc" "abd")
+(equal "abc" "abc")
+(equal s (+ "hello, world of lisp" " strings"))
+(eq s s)
+(eq "x" "x")
+(define b (string-builder))
+(builder-append b "n=" 42 ", x=" 1.5 ", ok=" true)
+(builder-string b)
+(builder-append b '(1))
+(string-join '("a" "b" "c") ", ")
+(string-join '(1 2.5 "x"))
+(string-join '() "-")
+(define log-line (lambda (sb i) (builder-append sb "line " i "\n")))
+(define lb (string-builder))
+(dotimes (i 100000) (log-line lb i))
+(string-length (builder-string lb))
+(define acc "")
+(dotimes (i 2000) (setq acc (+ acc "0123456789")))
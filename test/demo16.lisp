@@ -0,0 +1,15 @@
+(print 1 2.5 "str" true false)
+(print '(1 (2 3) "a") 0.1 1234567.0 -7)
+(display "no newline, ")
+(display 42)
+(print)
+(format "x=~a, y=~a~%" 1 '(2 3))
+(format "~~ literal")
+(format "~a" 1 2)
+(format "~a")
+(define f (lambda (i) (print "i =" i (* i 1.5))))
+(dotimes (i 3) (f i))
+(string-length (format "~a-~a" 3.25 "z"))
+'(1 2 (3))
+(pfor-each (lambda (x) (print "item" x)) (collect (range 200)))
+(print "done")
@@ -0,0 +1,15 @@
+(define t (load-csv "demo17.csv"))
+t
+(table-rows t)
+(table-columns t)
+(table-ref t "name" 1)
+(table-ref t "note" 0)
+(table-ref t "note" 1)
+(table-ref t "price" 2)
+(table-ref t "id" 2)
+(table-ref t "qty" 1)
+(reduce (lambda (acc x) (+ acc x)) 0 (table-column t "id"))
+(collect (table-column t "name"))
+(table-ref t "nope" 0)
+(table-ref t "id" 3)
+(load-csv "missing.csv")
@@ -0,0 +1,37 @@
+(define bv (make-bytevector 24 0))
+(bytevector-length bv)
+(bytevector-u32-set bv 0 3735928559)
+(bytevector-u32-ref bv 0)
+(bytevector-u32-ref bv 0 "big")
+(bytevector-u8-ref bv 0)
+(bytevector-u8-ref bv 3)
+(bytevector-i64-set bv 8 -2 "big")
+(bytevector-i64-ref bv 8 "big")
+(bytevector-i64-ref bv 8)
+(bytevector-f64-set bv 16 2.5)
+(bytevector-f64-ref bv 16)
+(define s (bytevector-slice bv 16))
+(bytevector-length s)
+(bytevector-u8-set s 7 65)
+(bytevector-f64-ref bv 16)
+(bytevector-u8-set bv 0 256)
+(bytevector-u32-ref bv 21)
+(bytevector-u32-ref bv 0 "middle")
+(write-file-bytes "/tmp/austlisp-demo18.bin" bv)
+(define back (read-file-bytes "/tmp/austlisp-demo18.bin"))
+(bytevector-length back)
+(bytevector-u32-ref back 0)
+(define sum 0)
+(dotimes (i 3) (setq sum (+ sum (bytevector-u8-ref back (* i 8)))))
+sum
+(read-file-bytes "/tmp/austlisp-no-such-file")
+bv
+(write-file-bytes "/tmp/austlisp-demo18-big.bin" (make-bytevector 200000 7))
+(define big (read-file-bytes "/tmp/austlisp-demo18-big.bin"))
+(bytevector-u8-set big 150000 9)
+(write-file-bytes "/tmp/austlisp-demo18-big.bin" big)
+(bytevector-u8-ref big 199999)
+(define big2 (read-file-bytes "/tmp/austlisp-demo18-big.bin"))
+(bytevector-length big2)
+(bytevector-u8-ref big2 150000)
+(bytevector-u8-ref big2 199999)
@@ -0,0 +1,27 @@
+(define x 10)
+(define getx (lambda (unused) (+ x 0)))
+(getx 0)
+(setq x 20)
+(getx 0)
+(define shadow (lambda (x) (+ x 1)))
+(shadow 1)
+x
+(define bump (lambda (n) (setq x (+ x n))))
+(bump 3)
+x
+(define later (lambda (n) (+ y n)))
+(define y 41)
+(later 1)
+(define counter 0)
+(dotimes (i 1000) (setq counter (+ counter 1)))
+counter
+(define twice (lambda (f v) (f (f v))))
+(twice shadow 1)
+(define sq (lambda (v) (* v v)))
+(define apply-sq (lambda (v) (sq v)))
+(apply-sq 7)
+(setq sq (lambda (v) (+ v v)))
+(apply-sq 7)
+(define fact (lambda (n) (if (< n 2) 1 (* n (fact (- n 1))))))
+(fact 20)
+(let ((x 1)) (+ x (getx 0)))
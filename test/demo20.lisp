@@ -0,0 +1,6 @@
+(define down (lambda (n) (if (equal n 0) 0 (+ 1 (down (- n 1))))))
+(down 5000)
+(down 20000)
+(define count (lambda (n acc) (if (equal n 0) acc (count (- n 1) (+ acc 1)))))
+(count 30000 0)
+(+ 1 2)
@@ -0,0 +1,26 @@
+(define area (lambda ((w double) (h double)) (* w h)))
+(area 2 3)
+(area 1.5 2)
+(area "x" 2)
+(define sumsq (lambda ((n int)) (let ((acc 0)) (dotimes (i n) (setq acc (+ acc (* i i)))) acc)))
+(sumsq 10)
+(type-report sumsq)
+(define mixed (lambda (a (b int)) (+ (* b 2) (- a b))))
+(mixed 1 2)
+(mixed 1.5 2)
+(type-report mixed)
+(define widen (lambda ((n int)) (let ((x 0)) (dotimes (i n) (setq x (+ x 0.5))) x)))
+(widen 4)
+(type-report widen)
+(define halves (lambda ((a int) (b int)) (+ (/ a b) (/ a 2))))
+(halves 7 2)
+(halves 7 0)
+(type-report halves)
+(define mean (lambda ((a double) (b double)) (/ (+ a b) 2)))
+(mean 1 2)
+(type-report mean)
+(let ((x 1) (y 2.5)) (if (< x y) (* x y) 0))
+(let ((n 0)) (while (< n 10) (setq n (+ n 3))) n)
+(define fib (lambda ((n int)) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(fib 20)
+(type-report fib)
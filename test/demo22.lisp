@@ -0,0 +1,22 @@
+(sort '(3 1 2))
+(sort '(3 1.5 2 -7))
+(sort '("pear" "apple" "fig"))
+(sort '(3 1 2) (lambda (a b) (> a b)))
+(sort '(3 1 2) (lambda (a b) (< b a)))
+(sort '(10 -3 4 -20) (lambda (x) (* x x)))
+(sort '("ccc" "a" "bb" "d") (lambda (a b) (< (string-length a) (string-length b))))
+(sort '((2 "b") (1 "a") (2 "a")) (lambda (p) (nth 0 p)))
+(sort (range 0 10) (lambda (a b) (> a b)))
+(sort '())
+(sort '(1 "a"))
+(sort '(1 2) (lambda (a b) (+ a b)))
+(sort '(1 2) (lambda (a b c) (+ a b)))
+(sort '(1 2) (lambda (x) (string-length x)))
+(sort 5)
+(define big (sort (range 0 200000) (lambda (a b) (> a b))))
+(length big)
+(nth 0 big)
+(nth 199999 big)
+(define mod (sort (range 0 70000) (lambda (a b) (< (- a (* 7 (/ a 7))) (- b (* 7 (/ b 7)))))))
+(nth 1 mod)
+(nth 69999 mod)
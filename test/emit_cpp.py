@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# --emit-cpp：生成的 C++ 链接 libaustlisp_rt 编译出来以后，输出要和 austlisp -f 一模一样
+# python3 emit_cpp.py <austlisp> <c++ 编译器> <libaustlisp_rt.a> <src 目录>
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+SOURCE = """(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))
+(define area (lambda ((r double)) (* 3.14159 (* r r))))
+(define sum (lambda (n) (let ((s 0)) (dotimes (i n) (setq s (+ s i))) s)))
+(define countdown (lambda (n) (let ((k 0)) (while (< k n) (setq k (+ k 3))) k)))
+(define half (lambda (a b) (/ a b)))
+(define down (lambda (n) (if (< n 1) 0 (+ 1 (down (- n 1))))))
+(define big (lambda () (- 0 9223372036854775807)))
+(define greet (lambda (s) (string-length s)))
+(fib 25)
+(area 2)
+(sum 100000)
+(countdown 10)
+(half 7 2)
+(half 7 0)
+(half 2.5 2)
+(down 3000)
+(big)
+(greet "中文 and a\ttab")
+(print "\\ back slash")
+(fib 2.5)
+(define h fib)
+(h 10)
+(setq fib (lambda (n) (* n 100)))
+(fib 7)
+(h 10)
+(define t (spawn down 100))
+(await t)
+(dotimes (i 3) (print (area i)))
+(area "x")"""
+
+
+def main():
+    exe, cxx, rt, src = sys.argv[1:5]
+    with tempfile.TemporaryDirectory() as d:
+        script = os.path.join(d, "prog.lisp")
+        with open(script, "w", encoding="utf-8") as f:
+            f.write(SOURCE)
+        expected = subprocess.run([exe, "-f", script], capture_output=True, timeout=60)
+
+        p = subprocess.run([exe, "--emit-cpp", script], capture_output=True, text=True, timeout=60)
+        m = re.search(r"(\d+) 个函数翻译成了 C\+\+", p.stderr)
+        # fib area sum countdown half down big 都是数值函数，greet 不是
+        if p.returncode != 0 or m is None or int(m.group(1)) != 7:
+            print(f"emit: rc={p.returncode} stderr={p.stderr!r}")
+            sys.exit(1)
+        cpp, binary = os.path.join(d, "prog.cpp"), os.path.join(d, "prog")
+        with open(cpp, "w", encoding="utf-8") as f:
+            f.write(p.stdout)
+        c = subprocess.run([cxx, "-std=c++20", "-O2", f"-I{src}", cpp, rt, "-pthread", "-o", binary],
+                           capture_output=True, text=True, timeout=300)
+        if c.returncode != 0:
+            print(c.stderr)
+            sys.exit(1)
+
+        got = subprocess.run([binary], capture_output=True, timeout=60)
+        if (got.returncode, got.stdout, got.stderr) != (expected.returncode, expected.stdout, expected.stderr):
+            print(f"expected rc={expected.returncode} stdout={expected.stdout!r} stderr={expected.stderr!r}")
+            print(f"got      rc={got.returncode} stdout={got.stdout!r} stderr={got.stderr!r}")
+            sys.exit(1)
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+# 大于 Loader::PARALLEL_MIN_BYTES 的文件走并行解析，结果必须和逐行求值的顺序、内容一样
+# python3 load_large.py <austlisp>
+import os
+import subprocess
+import sys
+import tempfile
+
+
+def main():
+    exe = sys.argv[1]
+    lines, expected = ["(define sq (lambda (x) (* x x)))", "(define acc 0)"], []
+    acc = 0
+    for i in range(80000):
+        k = i % 4
+        if k == 0:
+            lines.append(f"(+ {i} (* 2 3))")
+            expected.append(f"{i + 6}")
+        elif k == 1:
+            lines.append(f"(sq {i})")
+            expected.append(f"{i * i}")
+        elif k == 2:
+            # 后面的行依赖前面的求值结果
+            lines.append(f"(setq acc (+ acc {i}))")
+            lines.append("acc")
+            acc += i
+            expected.append(f"{acc}")
+        else:
+            lines.append(f"'({i} \"s{i}\" (1.5 true))")
+            expected.append(f"( {i} s{i} ( 1.5 true ) ) ")
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "large.lisp")
+        with open(path, "w") as f:
+            f.write("\n".join(lines) + "\n")
+        out = subprocess.run([exe, "-f", path], capture_output=True, text=True, check=True).stdout
+    got = out.split("\n")[:-1]
+    if got != expected:
+        for n, (g, e) in enumerate(zip(got, expected)):
+            if g != e:
+                print(f"line {n}: got {g!r}, expected {e!r}")
+                break
+        print(f"{len(got)} lines, expected {len(expected)}")
+        sys.exit(1)
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,14 @@
+# 跑一个 demo 脚本，把标准输出和 .out 里的期望结果比较
+# cmake -DEXE=<austlisp> -DOPT=<0|1|2> -DSCRIPT=<demo.lisp> -DEXPECTED=<demo.out> -P run_demo.cmake
+execute_process(
+  COMMAND ${EXE} -O${OPT} -f ${SCRIPT}
+  OUTPUT_VARIABLE actual
+  RESULT_VARIABLE status
+  TIMEOUT 120)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "${SCRIPT} -O${OPT} exited with ${status}\n${actual}")
+endif()
+file(READ ${EXPECTED} expected)
+if(NOT actual STREQUAL expected)
+  message(FATAL_ERROR "${SCRIPT} -O${OPT} output mismatch\n--- expected\n${expected}--- actual\n${actual}")
+endif()
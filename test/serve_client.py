@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# --serve 的端到端测试：预加载文件、会话之间环境隔离、多个会话并发
+# python3 serve_client.py <austlisp> <prelude.lisp>
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+
+def request(sock, source):
+    data = source.encode()
+    sock.sendall(struct.pack(">I", len(data)) + data)
+    header = b""
+    while len(header) < 4:
+        chunk = sock.recv(4 - len(header))
+        if not chunk:
+            raise RuntimeError("server closed the connection")
+        header += chunk
+    (length,) = struct.unpack(">I", header)
+    body = b""
+    while len(body) < length:
+        chunk = sock.recv(length - len(body))
+        if not chunk:
+            raise RuntimeError("server closed the connection")
+        body += chunk
+    return body.decode()
+
+
+def connect(path):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(path)
+    return sock
+
+
+def expect(actual, expected, what):
+    if actual != expected:
+        raise AssertionError(f"{what}: expected {expected!r}, got {actual!r}")
+
+
+def main():
+    exe, prelude = sys.argv[1], sys.argv[2]
+    path = os.path.join(tempfile.mkdtemp(), "austlisp.sock")
+    server = subprocess.Popen([exe, "--serve", path, "-f", prelude], stdout=subprocess.DEVNULL)
+    try:
+        for _ in range(200):
+            if os.path.exists(path):
+                break
+            time.sleep(0.01)
+
+        a, b = connect(path), connect(path)
+        # 预加载的定义每个会话都有，改动只留在自己的会话里
+        expect(request(a, "(square 7)\n"), "49\n", "prelude")
+        expect(request(a, "(setq base 100)\n(bump 1)\n"), "101\n", "session state")
+        expect(request(b, "(bump 1)\n"), "11\n", "isolation")
+        expect(request(a, "(bump 2)\n"), "102\n", "state persists")
+        expect(request(b, "(undefined-thing 1)\n") != "", True, "errors are returned")
+        # 线程池里打印的也要回到发起的会话，排在后面的结果前面
+        items = "".join(f"item {i}\n" for i in range(100))
+        expect(request(a, "(pfor-each (lambda (x) (print \"item\" x)) (collect (range 100)))\n(print \"done\")\n"),
+               items + "done\n", "worker output")
+        a.close()
+        b.close()
+
+        results = {}
+
+        def worker(i):
+            with connect(path) as s:
+                results[i] = request(s, f"(define k {i})\n(sumto (* k 1000))\n")
+
+        threads = [threading.Thread(target=worker, args=(i,)) for i in range(8)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        for i in range(8):
+            n = i * 1000
+            expect(results[i], f"{n * (n - 1) // 2}\n", f"concurrent session {i}")
+    finally:
+        server.kill()
+        server.wait()
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
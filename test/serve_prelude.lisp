@@ -0,0 +1,4 @@
+(define square (lambda (x) (* x x)))
+(define base 10)
+(define bump (lambda (n) (+ base n)))
+(define sumto (lambda (n) (let ((acc 0)) (dotimes (i n) (setq acc (+ acc i))) acc)))